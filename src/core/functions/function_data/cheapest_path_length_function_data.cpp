@@ -35,6 +35,16 @@ unique_ptr<FunctionData> CheapestPathLengthFunctionData::CheapestPathLengthBind(
   return make_uniq<CheapestPathLengthFunctionData>(context, csr_id);
 }
 
+unique_ptr<FunctionData> CheapestPathLengthFunctionData::CheapestPathBind(
+    ClientContext &context, ScalarFunction &bound_function,
+    vector<unique_ptr<Expression>> &arguments) {
+  // The path has the same type for both weight types
+  auto path_type = bound_function.return_type;
+  auto result = CheapestPathLengthBind(context, bound_function, arguments);
+  bound_function.return_type = path_type;
+  return result;
+}
+
 unique_ptr<FunctionData> CheapestPathLengthFunctionData::Copy() const {
   return make_uniq<CheapestPathLengthFunctionData>(context, csr_id);
 }
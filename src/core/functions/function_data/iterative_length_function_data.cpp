@@ -9,12 +9,14 @@ namespace duckpgq {
 namespace core {
 
 unique_ptr<FunctionData> IterativeLengthFunctionData::Copy() const {
-  return make_uniq<IterativeLengthFunctionData>(context, csr_id);
+  return make_uniq<IterativeLengthFunctionData>(context, csr_id, reverse,
+                                                lower, upper);
 }
 
 bool IterativeLengthFunctionData::Equals(const FunctionData &other_p) const {
   auto &other = (const IterativeLengthFunctionData &)other_p;
-  return other.csr_id == csr_id;
+  return other.csr_id == csr_id && other.reverse == reverse &&
+         other.lower == lower && other.upper == upper;
 }
 
 unique_ptr<FunctionData> IterativeLengthFunctionData::IterativeLengthBind(
@@ -29,8 +31,78 @@ unique_ptr<FunctionData> IterativeLengthFunctionData::IterativeLengthBind(
   auto duckpgq_state = GetDuckPGQState(context);
   duckpgq_state->csr_to_delete.insert(csr_id);
 
+  // iterativelength and shortestpath take an optional constant BOOLEAN as
+  // their fifth argument, whether to follow the incoming edges
+  bool reverse = false;
+  idx_t bounds_idx = 4;
+  if (arguments.size() > 4 &&
+      arguments[4]->return_type == LogicalType::BOOLEAN) {
+    if (!arguments[4]->IsFoldable()) {
+      throw InvalidInputException("Reverse flag must be constant.");
+    }
+    reverse = ExpressionExecutor::EvaluateScalar(context, *arguments[4])
+                  .GetValue<bool>();
+    bounds_idx++;
+  }
+
+  // followed by the optional constant hop bounds of the path
+  int64_t lower = 0;
+  int64_t upper = NumericLimits<int64_t>::Maximum();
+  if (arguments.size() == bounds_idx + 2) {
+    if (!arguments[bounds_idx]->IsFoldable() ||
+        !arguments[bounds_idx + 1]->IsFoldable()) {
+      throw InvalidInputException("Path bounds must be constant.");
+    }
+    auto lower_value =
+        ExpressionExecutor::EvaluateScalar(context, *arguments[bounds_idx]);
+    auto upper_value = ExpressionExecutor::EvaluateScalar(
+        context, *arguments[bounds_idx + 1]);
+    if (lower_value.IsNull() || upper_value.IsNull()) {
+      throw InvalidInputException("Path bounds must not be NULL.");
+    }
+    lower = lower_value.GetValue<int64_t>();
+    upper = upper_value.GetValue<int64_t>();
+    if (lower < 0) {
+      throw ConstraintException("Lower bound must be non-negative");
+    }
+    if (lower > upper) {
+      throw ConstraintException("Lower bound greater than upper bound");
+    }
+  }
+
+  return make_uniq<IterativeLengthFunctionData>(context, csr_id, reverse,
+                                                lower, upper);
+}
 
-  return make_uniq<IterativeLengthFunctionData>(context, csr_id);
+unique_ptr<FunctionData> IterativeLengthFunctionData::BfsDistancesBind(
+    ClientContext &context, ScalarFunction &bound_function,
+    vector<unique_ptr<Expression>> &arguments) {
+  if (!arguments[0]->IsFoldable()) {
+    throw InvalidInputException("Id must be constant.");
+  }
+
+  int32_t csr_id = ExpressionExecutor::EvaluateScalar(context, *arguments[0])
+                       .GetValue<int32_t>();
+  auto duckpgq_state = GetDuckPGQState(context);
+  duckpgq_state->csr_to_delete.insert(csr_id);
+
+  int64_t upper = NumericLimits<int64_t>::Maximum();
+  if (arguments.size() == 4) {
+    if (!arguments[3]->IsFoldable()) {
+      throw InvalidInputException("Max depth must be constant.");
+    }
+    auto upper_value =
+        ExpressionExecutor::EvaluateScalar(context, *arguments[3]);
+    if (upper_value.IsNull()) {
+      throw InvalidInputException("Max depth must not be NULL.");
+    }
+    upper = upper_value.GetValue<int64_t>();
+    if (upper < 0) {
+      throw ConstraintException("Max depth must be non-negative");
+    }
+  }
+  return make_uniq<IterativeLengthFunctionData>(context, csr_id, false, 0,
+                                                upper);
 }
 
 } // namespace core
@@ -7,15 +7,30 @@ namespace duckpgq {
 namespace core {
 
 // Constructor
-PageRankFunctionData::PageRankFunctionData(ClientContext &ctx, int32_t csr)
-    : context(ctx), csr_id(csr), damping_factor(0.85),
-      convergence_threshold(1e-6), iteration_count(0), state_initialized(false),
-      converged(false) {}
+PageRankFunctionData::PageRankFunctionData(ClientContext &ctx, int32_t csr,
+                                           double_t damping_factor,
+                                           double_t convergence_threshold,
+                                           int64_t max_iterations)
+    : context(ctx), csr_id(csr), damping_factor(damping_factor),
+      convergence_threshold(convergence_threshold),
+      max_iterations(max_iterations), iteration_count(0), converged(false) {}
 
-unique_ptr<FunctionData>
-PageRankFunctionData::PageRankBind(ClientContext &context,
-                                   ScalarFunction &bound_function,
-                                   vector<unique_ptr<Expression>> &arguments) {
+// Evaluates a parameter of PageRank, which has to be a constant
+static Value GetPageRankParameter(ClientContext &context,
+                                  Expression &argument, const string &name) {
+  if (!argument.IsFoldable()) {
+    throw InvalidInputException(name + " must be constant.");
+  }
+  auto value = ExpressionExecutor::EvaluateScalar(context, argument);
+  if (value.IsNull()) {
+    throw InvalidInputException(name + " must not be NULL.");
+  }
+  return value;
+}
+
+// Evaluates the constant CSR id of PageRank, the first argument
+static int32_t GetPageRankCSRId(ClientContext &context,
+                                vector<unique_ptr<Expression>> &arguments) {
   if (!arguments[0]->IsFoldable()) {
     throw InvalidInputException("Id must be constant.");
   }
@@ -24,22 +39,77 @@ PageRankFunctionData::PageRankBind(ClientContext &context,
                        .GetValue<int32_t>();
   auto duckpgq_state = GetDuckPGQState(context);
   duckpgq_state->csr_to_delete.insert(csr_id);
+  return csr_id;
+}
 
-  return make_uniq<PageRankFunctionData>(context, csr_id);
+// Evaluates the damping factor at position first and the tolerance after it
+static void GetDampingAndTolerance(ClientContext &context,
+                                   vector<unique_ptr<Expression>> &arguments,
+                                   idx_t first, double_t &damping_factor,
+                                   double_t &convergence_threshold) {
+  damping_factor = GetPageRankParameter(context, *arguments[first], "Damping")
+                       .GetValue<double_t>();
+  convergence_threshold =
+      GetPageRankParameter(context, *arguments[first + 1], "Tolerance")
+          .GetValue<double_t>();
+  if (!(damping_factor >= 0 && damping_factor <= 1)) {
+    throw ConstraintException("Damping must be between 0 and 1");
+  }
+  if (!(convergence_threshold >= 0)) {
+    throw ConstraintException("Tolerance must be non-negative");
+  }
 }
 
-// Copy method
+unique_ptr<FunctionData>
+PageRankFunctionData::PageRankBind(ClientContext &context,
+                                   ScalarFunction &bound_function,
+                                   vector<unique_ptr<Expression>> &arguments) {
+  auto csr_id = GetPageRankCSRId(context, arguments);
+
+  double_t damping_factor = PAGERANK_DEFAULT_DAMPING;
+  double_t convergence_threshold = PAGERANK_DEFAULT_TOLERANCE;
+  int64_t max_iterations = PAGERANK_DEFAULT_MAX_ITERATIONS;
+  // The parameters are the last three arguments of both functions
+  if (arguments.size() >= 4) {
+    auto first = arguments.size() - 3;
+    GetDampingAndTolerance(context, arguments, first, damping_factor,
+                           convergence_threshold);
+    max_iterations =
+        GetPageRankParameter(context, *arguments[first + 2], "Max iterations")
+            .GetValue<int64_t>();
+    if (max_iterations < 0) {
+      throw ConstraintException("Max iterations must be non-negative");
+    }
+  }
+  return make_uniq<PageRankFunctionData>(context, csr_id, damping_factor,
+                                         convergence_threshold,
+                                         max_iterations);
+}
+
+unique_ptr<FunctionData> PageRankFunctionData::PersonalizedPageRankBind(
+    ClientContext &context, ScalarFunction &bound_function,
+    vector<unique_ptr<Expression>> &arguments) {
+  auto csr_id = GetPageRankCSRId(context, arguments);
+
+  double_t damping_factor = PAGERANK_DEFAULT_DAMPING;
+  double_t convergence_threshold = PERSONALIZED_PAGERANK_DEFAULT_TOLERANCE;
+  if (arguments.size() == 5) {
+    GetDampingAndTolerance(context, arguments, 3, damping_factor,
+                           convergence_threshold);
+    // Every push moves at least the tolerance, so it must not be zero
+    if (convergence_threshold == 0) {
+      throw ConstraintException("Tolerance must be positive");
+    }
+  }
+  return make_uniq<PageRankFunctionData>(context, csr_id, damping_factor,
+                                         convergence_threshold);
+}
+
+// Copy method, the copy computes the ranks again
 unique_ptr<FunctionData> PageRankFunctionData::Copy() const {
-  auto result = make_uniq<PageRankFunctionData>(context, csr_id);
-  result->rank = rank;           // Deep copy of rank vector
-  result->temp_rank = temp_rank; // Deep copy of temp_rank vector
-  result->damping_factor = damping_factor;
-  result->convergence_threshold = convergence_threshold;
-  result->iteration_count = iteration_count;
-  result->state_initialized = state_initialized;
-  result->converged = converged;
-  // Note: state_lock is not copied as mutexes are not copyable
-  return std::move(result);
+  return make_uniq<PageRankFunctionData>(context, csr_id, damping_factor,
+                                         convergence_threshold,
+                                         max_iterations);
 }
 
 // Equals method
@@ -48,29 +118,17 @@ bool PageRankFunctionData::Equals(const FunctionData &other_p) const {
   if (csr_id != other.csr_id) {
     return false;
   }
-  if (rank != other.rank) {
-    return false;
-  }
-  if (temp_rank != other.temp_rank) {
-    return false;
-  }
   if (damping_factor != other.damping_factor) {
     return false;
   }
   if (convergence_threshold != other.convergence_threshold) {
     return false;
   }
-  if (iteration_count != other.iteration_count) {
-    return false;
-  }
-  if (state_initialized != other.state_initialized) {
-    return false;
-  }
-  if (converged != other.converged) {
+  if (max_iterations != other.max_iterations) {
     return false;
   }
   return true;
 }
 } // namespace core
 
-} // namespace duckpgq
\ No newline at end of file
+} // namespace duckpgq
@@ -8,10 +8,7 @@ namespace core {
 
 WeaklyConnectedComponentFunctionData::WeaklyConnectedComponentFunctionData(
     ClientContext &context, int32_t csr_id)
-    : context(context), csr_id(csr_id) {
-  state_converged = false; // Initialize state
-  state_initialized = false;
-}
+    : context(context), csr_id(csr_id) {}
 
 unique_ptr<FunctionData>
 WeaklyConnectedComponentFunctionData::WeaklyConnectedComponentBind(
@@ -40,9 +37,6 @@ bool WeaklyConnectedComponentFunctionData::Equals(
   if (csr_id != other.csr_id) {
     return false;
   }
-  if (state_converged != other.state_converged) {
-    return false;
-  }
   return true;
 }
 
@@ -0,0 +1,205 @@
+#include "duckdb/main/client_data.hpp"
+#include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/functions/function_data/iterative_length_function_data.hpp"
+
+#include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+//! A vertex reached by a search, the number of hops from the source and the
+//! vertex it was first reached from, which is -1 for the source itself
+struct BfsReachedVertex {
+  int64_t vertex;
+  int64_t distance;
+  int64_t parent;
+};
+
+//! Appends the vertices a search reached as the list of a row
+static void AppendReachedVertices(Vector &result, idx_t row,
+                                  const vector<BfsReachedVertex> &reached) {
+  auto result_data = FlatVector::GetData<list_entry_t>(result);
+  auto offset = ListVector::GetListSize(result);
+  ListVector::Reserve(result, offset + reached.size());
+  auto &entries = StructVector::GetEntries(ListVector::GetEntry(result));
+  auto vertex_data = FlatVector::GetData<int64_t>(*entries[0]);
+  auto distance_data = FlatVector::GetData<int64_t>(*entries[1]);
+  auto parent_data = FlatVector::GetData<int64_t>(*entries[2]);
+  auto &parent_validity = FlatVector::Validity(*entries[2]);
+  for (idx_t i = 0; i < reached.size(); i++) {
+    vertex_data[offset + i] = reached[i].vertex;
+    distance_data[offset + i] = reached[i].distance;
+    parent_data[offset + i] = reached[i].parent;
+    if (reached[i].parent < 0) {
+      parent_validity.SetInvalid(offset + i);
+    }
+  }
+  result_data[row].offset = offset;
+  result_data[row].length = reached.size();
+  ListVector::SetListSize(result, offset + reached.size());
+}
+
+//! Runs the next searches, as many as fit in LANES lanes, and appends the
+//! vertices every search reaches within upper hops to the lists of its rows.
+//! After every step, the vertices of the level before push their lanes to the
+//! new level once more, in the order the step pushed its edges in, and the
+//! first one to reach a vertex for a lane is its parent.
+struct BfsDistancesBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        int64_t v_size, Vector &result, idx_t range_count,
+                        BfsFrontier &frontier, const PathSearches &searches,
+                        int64_t upper, ScratchPool &scratch,
+                        idx_t &started_searches) {
+    LaneBitsetArray<LANES> seen(scratch, v_size);
+    LaneBitsetArray<LANES> visit1(scratch, v_size);
+    LaneBitsetArray<LANES> visit2(scratch, v_size);
+    // The lanes of the vertices of the new level whose parent is not found
+    // yet, empty between steps
+    LaneBitsetArray<LANES> wanted(scratch, v_size);
+
+    auto lane_count =
+        MinValue<idx_t>(LANES, searches.sources.size() - started_searches);
+    auto first_search = started_searches;
+    started_searches += lane_count;
+    vector<vector<BfsReachedVertex>> reached(lane_count);
+    vector<int64_t> level;
+    for (idx_t lane = 0; lane < lane_count; lane++) {
+      auto source = searches.sources[first_search + lane];
+      visit1[source].set(lane);
+      seen[source].set(lane);
+      level.push_back(source);
+      reached[lane].push_back({source, 0, -1});
+    }
+    std::sort(level.begin(), level.end());
+    frontier.Start(level);
+
+    for (int64_t iter = 1; iter <= upper; iter++) {
+      auto &visit = (iter & 1) ? visit1 : visit2;
+      auto &next = (iter & 1) ? visit2 : visit1;
+      if (!BfsTopDownStep(context, v_size, range_count, csr, seen, visit, next,
+                          frontier)) {
+        break;
+      }
+      vector<int64_t> next_level;
+      if (frontier.IsListed()) {
+        next_level = frontier.Vertices();
+      } else {
+        for (int64_t v = 0; v < v_size; v++) {
+          if (next[v].any()) {
+            next_level.push_back(v);
+          }
+        }
+      }
+      for (auto v : next_level) {
+        wanted[v] = next[v];
+      }
+      for (auto v : level) {
+        auto &lanes = visit[v];
+        csr.ForEachNeighbor(v, [&](int64_t n, int64_t) {
+          auto found = lanes & wanted[n];
+          if (found.none()) {
+            return;
+          }
+          wanted[n] = wanted[n] & ~found;
+          found.ForEachLane([&](idx_t lane) {
+            reached[lane].push_back({n, iter, v});
+          });
+        });
+      }
+      level = std::move(next_level);
+    }
+
+    for (idx_t lane = 0; lane < lane_count; lane++) {
+      for (auto row : searches.rows[first_search + lane]) {
+        AppendReachedVertices(result, row, reached[lane]);
+      }
+    }
+  }
+};
+
+struct BfsDistancesOperation {
+  //! upper bounds the hops from the source, see IterativeLengthFunctionData
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result,
+                        int64_t upper) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto &result_validity = FlatVector::Validity(result);
+
+    UnifiedVectorFormat vdata_src;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    auto src_data = (int64_t *)vdata_src.data;
+
+    // rows with the same source share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_src, src_data, false);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // the steps of the search are split over the threads by vertex ranges
+    auto range_count = BfsRangeCount(context, v_size);
+    BfsFrontier frontier(context, v_size, range_count);
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<BfsDistancesBatch>(
+          searches.sources.size() - started_searches, csr, context, v_size,
+          result, range_count, frontier, searches, upper, scratch,
+          started_searches);
+    }
+  }
+};
+
+static void BfsDistancesFunction(DataChunk &args, ExpressionState &state,
+                                 Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  auto csr = duckpgq_state->GetCSR(info.csr_id);
+  if (!csr->initialized_v) {
+    throw ConstraintException(
+        "Need to initialize CSR before computing BFS distances");
+  }
+  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  TemplatedCSRDispatch<BfsDistancesOperation>(*csr, info.context, args, v_size,
+                                              result, info.upper);
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreScalarFunctions::RegisterBfsDistancesScalarFunction(
+    DatabaseInstance &db) {
+  auto reached_type = LogicalType::LIST(LogicalType::STRUCT(
+      {{"vertex_rowid", LogicalType::BIGINT},
+       {"distance", LogicalType::BIGINT},
+       {"parent_rowid", LogicalType::BIGINT}}));
+  ScalarFunctionSet set("bfs_distances");
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT},
+      reached_type, BfsDistancesFunction,
+      IterativeLengthFunctionData::BfsDistancesBind));
+  //! With the most hops from the source as the last argument
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      reached_type, BfsDistancesFunction,
+      IterativeLengthFunctionData::BfsDistancesBind));
+  ExtensionUtil::RegisterFunction(db, set);
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -0,0 +1,116 @@
+#include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/functions/function_data/cheapest_path_length_function_data.hpp"
+#include <duckpgq/core/functions/scalar.hpp>
+
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
+#include <duckpgq/core/utils/duckpgq_sssp.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+//! Runs delta-stepping once per distinct source of the rows, and appends the
+//! cheapest path to the target of every row to result
+template <typename T> struct CheapestPathOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t input_size, Vector &result,
+                        const vector<T> &weight_array, T max_weight) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto result_data = FlatVector::GetData<list_entry_t>(result);
+    auto &result_validity = FlatVector::Validity(result);
+
+    UnifiedVectorFormat vdata_src, vdata_target;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_target);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto target_data = (int64_t *)vdata_target.data;
+
+    auto grouped = GroupPathSearches(args.size(), vdata_src, src_data,
+                                     vdata_target, target_data, false);
+    // The searches collect the paths of their rows, which are appended to the
+    // result in row order afterwards
+    vector<vector<int64_t>> row_paths(args.size());
+    vector<uint8_t> row_found(args.size(), false);
+    SsspForEachSource(
+        context, csr, input_size, weight_array, max_weight, grouped.sources,
+        [&](idx_t idx, const SsspDeltaStepping<T> &sssp) {
+          for (auto i : grouped.rows[idx]) {
+            auto target = target_data[vdata_target.sel->get_index(i)];
+            if (sssp.Reached(target)) {
+              row_paths[i] = sssp.Path(csr, target);
+              row_found[i] = true;
+            }
+          }
+        });
+
+    int64_t total_len = 0;
+    for (idx_t i = 0; i < args.size(); i++) {
+      if (!row_found[i]) {
+        result_validity.SetInvalid(i);
+        continue;
+      }
+      auto output = make_uniq<Vector>(LogicalType::LIST(LogicalType::BIGINT));
+      for (auto val : row_paths[i]) {
+        Value value_to_insert = val;
+        ListVector::PushBack(*output, value_to_insert);
+      }
+      result_data[i].length = ListVector::GetListSize(*output);
+      result_data[i].offset = total_len;
+      ListVector::Append(result, ListVector::GetEntry(*output),
+                         ListVector::GetListSize(*output));
+      total_len += result_data[i].length;
+    }
+  }
+};
+
+template <typename T>
+static void CheapestPath(const CSR &csr, ClientContext &context,
+                         DataChunk &args, int64_t input_size, Vector &result,
+                         const vector<T> &weight_array) {
+  if (csr.negative_weight) {
+    throw ConstraintException("cheapest_path requires non-negative weights");
+  }
+  TemplatedCSRDispatch<CheapestPathOperation<T>>(
+      csr, context, args, input_size, result, weight_array,
+      csr.MaxWeight<T>());
+}
+
+static void CheapestPathFunction(DataChunk &args, ExpressionState &state,
+                                 Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (CheapestPathLengthFunctionData &)*func_expr.bind_info;
+  int64_t input_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  CSR *csr = duckpgq_state->GetCSR(info.csr_id);
+  if (csr->w.empty()) {
+    CheapestPath<double>(*csr, info.context, args, input_size, result,
+                         csr->w_double);
+  } else {
+    CheapestPath<int64_t>(*csr, info.context, args, input_size, result,
+                          csr->w);
+  }
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreScalarFunctions::RegisterCheapestPathScalarFunction(
+    DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(
+      db, ScalarFunction("cheapest_path",
+                         {LogicalType::INTEGER, LogicalType::BIGINT,
+                          LogicalType::BIGINT, LogicalType::BIGINT},
+                         LogicalType::LIST(LogicalType::BIGINT),
+                         CheapestPathFunction,
+                         CheapestPathLengthFunctionData::CheapestPathBind));
+}
+
+} // namespace core
+
+} // namespace duckpgq
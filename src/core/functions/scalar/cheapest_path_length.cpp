@@ -5,146 +5,286 @@
 #include <duckpgq/core/functions/scalar.hpp>
 #include <duckpgq_extension.hpp>
 
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
+#include <duckpgq/core/utils/duckpgq_sssp.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define DUCKPGQ_BELLMAN_FORD_X86
+#endif
+
 namespace duckpgq {
 
 namespace core {
 
-template <typename T, int16_t lane_limit>
-static int16_t InitialiseBellmanFord(const DataChunk &args, int64_t input_size,
-                                     const UnifiedVectorFormat &vdata_src,
-                                     const int64_t *src_data, idx_t result_size,
-                                     vector<vector<T>> &dists) {
-  dists.resize(input_size,
-               std::vector<T>(lane_limit, std::numeric_limits<T>::max() / 2));
-
-  int16_t lanes = 0;
-  for (idx_t i = result_size; i < args.size() && lanes < lane_limit; i++) {
-    auto src_index = vdata_src.sel->get_index(i);
-    if (vdata_src.validity.RowIsValid(src_index)) {
-      const int64_t &src_entry = src_data[src_index];
-      dists[src_entry][lanes] = 0;
-      lanes++;
-    }
+//! Most searches in a batch of Bellman-Ford, which bounds its distances to
+//! input_size x BELLMAN_FORD_LANE_LIMIT values
+static constexpr idx_t BELLMAN_FORD_LANE_LIMIT = 64;
+
+//! Tentative distances of a batch of Bellman-Ford searches in one flat array,
+//! with the lanes of every vertex next to each other. The array starts at a
+//! cache line and is reused by the following batches.
+template <typename T> class BellmanFordDistances {
+public:
+  //! Distance of the lanes that have not reached a vertex. Half the maximum,
+  //! so adding a weight to it does not overflow.
+  static constexpr T UNREACHED = std::numeric_limits<T>::max() / 2;
+
+  void Reset(int64_t input_size, idx_t lanes) {
+    static constexpr idx_t CACHE_LINE_VALUES = 64 / sizeof(T);
+    auto count = static_cast<idx_t>(input_size) * lanes;
+    storage.resize(count + CACHE_LINE_VALUES);
+    auto misalignment = reinterpret_cast<uintptr_t>(storage.data()) % 64;
+    data = storage.data() +
+           (misalignment ? (64 - misalignment) / sizeof(T) : 0);
+    std::fill(data, data + count, UNREACHED);
+    lane_count = lanes;
   }
-  return lanes;
-}
 
-template <typename T> int64_t UpdateOneLane(T &n_dist, T v_dist, T weight) {
-  T new_dist = v_dist + weight;
-  bool better = new_dist < n_dist;
-  T min = better ? new_dist : n_dist;
-  n_dist = min;
-  return better;
+  T *Lanes(int64_t v) { return data + v * lane_count; }
+
+private:
+  vector<T> storage;
+  T *data = nullptr;
+  idx_t lane_count = 0;
+};
+
+template <typename T> constexpr T BellmanFordDistances<T>::UNREACHED;
+
+//! Relaxes the edge from v to n with weight in all lanes. The loop has a fixed
+//! length and no branches, so the compiler vectorizes it into SIMD min
+//! operations. Returns whether any lane improved.
+template <typename T, idx_t LANES>
+static inline bool UpdateLanes(T *n_dists, const T *v_dists, T weight) {
+  int64_t changed = 0;
+  for (idx_t lane = 0; lane < LANES; lane++) {
+    // Lanes that did not reach v must not improve n, even with a negative
+    // weight
+    T v_dist = v_dists[lane];
+    T new_dist = v_dist == BellmanFordDistances<T>::UNREACHED
+                     ? BellmanFordDistances<T>::UNREACHED
+                     : v_dist + weight;
+    T old_dist = n_dists[lane];
+    bool better = new_dist < old_dist;
+    n_dists[lane] = better ? new_dist : old_dist;
+    changed |= better;
+  }
+  return changed != 0;
 }
 
-template <typename T>
-bool UpdateLanes(vector<vector<T>> &dists, T v, T n, T weight) {
-  std::vector<T> &v_dists = dists[v];
-  std::vector<T> &n_dists = dists[n];
-  size_t num_lanes = dists[v].size();
-  size_t lane_idx = 0;
-  bool xor_diff = false;
-  while (lane_idx < num_lanes) {
-    xor_diff |= UpdateOneLane<T>(n_dists[lane_idx], v_dists[lane_idx], weight);
-    ++lane_idx;
+//! One pass of Bellman-Ford over all edges. Returns whether any lane improved.
+template <typename T, idx_t LANES, class CSR_VIEW>
+static inline bool RelaxAllEdges(const CSR_VIEW &csr, int64_t input_size,
+                                 BellmanFordDistances<T> &dists,
+                                 const std::vector<T> &weight_array) {
+  bool changed = false;
+  //! For every v in the input
+  for (int64_t v = 0; v < input_size; v++) {
+    auto v_dists = dists.Lanes(v);
+    //! Loop through all the n neighbours of v
+    csr.ForEachNeighbor(v, [&](int64_t n, int64_t index) {
+      //! Get weight of (v,n)
+      changed |= UpdateLanes<T, LANES>(dists.Lanes(n), v_dists,
+                                       weight_array[index]);
+    });
   }
-  return xor_diff;
+  return changed;
+}
+
+#ifdef DUCKPGQ_BELLMAN_FORD_X86
+// The same pass compiled for AVX2, which has 64-bit compares and four lanes
+// per register. The baseline x86-64 target has neither.
+template <typename T, idx_t LANES, class CSR_VIEW>
+__attribute__((target("avx2"))) static bool
+RelaxAllEdgesAVX2(const CSR_VIEW &csr, int64_t input_size,
+                  BellmanFordDistances<T> &dists,
+                  const std::vector<T> &weight_array) {
+  return RelaxAllEdges<T, LANES>(csr, input_size, dists, weight_array);
+}
+
+//! Whether the CPU supports AVX2, checked once per process
+static bool BellmanFordUseAVX2() {
+  static const bool supported = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return supported;
 }
+#endif
+
+//! Runs the next searches, as many as fit in LANES lanes. Every search runs
+//! from a distinct source for all rows with that source.
+template <typename T> struct BellmanFordBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, int64_t input_size,
+                        BellmanFordDistances<T> &dists,
+                        const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_target,
+                        const int64_t *target_data,
+                        const std::vector<T> &weight_array, T *result_data,
+                        ValidityMask &result_validity,
+                        idx_t &started_searches) {
+    dists.Reset(input_size, LANES);
+    // maps lane to search, and the rows of that search. Rows whose target is
+    // their source are searched as well, as a negative cycle through the
+    // source makes their path undefined.
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    AssignPathSearchLanes<LANES>(searches, vdata_target, target_data,
+                                 started_searches, lane_search, lane_rows,
+                                 [](idx_t) { return false; });
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_search[lane] >= 0) {
+        dists.Lanes(searches.sources[lane_search[lane]])[lane] = 0;
+      }
+    }
 
-template <typename T, int16_t lane_limit>
-int16_t
-TemplatedBatchBellmanFord(CSR *csr, DataChunk &args, int64_t input_size,
-                          UnifiedVectorFormat &vdata_src, int64_t *src_data,
-                          const UnifiedVectorFormat &vdata_target,
-                          int64_t *target_data, std::vector<T> weight_array,
-                          int16_t result_size, T *result_data,
-                          ValidityMask &result_validity) {
-  vector<vector<T>> dists;
-  int16_t curr_batch_size = InitialiseBellmanFord<T, lane_limit>(
-      args, input_size, vdata_src, src_data, result_size, dists);
-  bool changed = true;
-  while (changed) {
-    changed = false;
-    //! For every v in the input
-    for (int64_t v = 0; v < input_size; v++) {
-      //! Loop through all the n neighbours of v
-      for (auto index = (int64_t)csr->v[v]; index < (int64_t)csr->v[v + 1];
-           index++) {
-        //! Get weight of (v,n)
-        changed = UpdateLanes<T>(dists, v, csr->e[index], weight_array[index]) |
-                  changed;
+    // Without negative cycles the distances settle within input_size passes
+    bool changed = true;
+    for (int64_t iter = 0; changed; iter++) {
+      if (iter > input_size) {
+        throw ConstraintException(
+            "Cheapest path is undefined due to a negative cycle");
+      }
+#ifdef DUCKPGQ_BELLMAN_FORD_X86
+      if (BellmanFordUseAVX2()) {
+        changed = RelaxAllEdgesAVX2<T, LANES>(csr, input_size, dists,
+                                              weight_array);
+        continue;
+      }
+#endif
+      changed = RelaxAllEdges<T, LANES>(csr, input_size, dists, weight_array);
+    }
+
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      for (auto row : lane_rows[lane]) {
+        auto target = target_data[vdata_target.sel->get_index(row)];
+        auto distance = dists.Lanes(target)[lane];
+        if (distance == BellmanFordDistances<T>::UNREACHED) {
+          result_validity.SetInvalid(row);
+        } else {
+          result_data[row] = distance;
+        }
       }
     }
   }
-  for (idx_t i = result_size; i < (idx_t)(result_size + curr_batch_size); i++) {
-    auto target_index = vdata_target.sel->get_index(i);
-    if (!vdata_target.validity.RowIsValid(target_index)) {
+};
+
+//! Runs a batch of searches as OP::Operation<LANES>(args...), with the widest
+//! lane width up to BELLMAN_FORD_LANE_LIMIT that the searches fill
+template <class OP, class... ARGS>
+static void BellmanFordLaneDispatch(idx_t searches, ARGS &&...args) {
+  static_assert(BELLMAN_FORD_LANE_LIMIT == 64,
+                "lane widths must end at BELLMAN_FORD_LANE_LIMIT");
+  if (searches >= 64) {
+    OP::template Operation<64>(std::forward<ARGS>(args)...);
+  } else if (searches >= 32) {
+    OP::template Operation<32>(std::forward<ARGS>(args)...);
+  } else if (searches >= 16) {
+    OP::template Operation<16>(std::forward<ARGS>(args)...);
+  } else if (searches >= 8) {
+    OP::template Operation<8>(std::forward<ARGS>(args)...);
+  } else if (searches >= 4) {
+    OP::template Operation<4>(std::forward<ARGS>(args)...);
+  } else if (searches >= 2) {
+    OP::template Operation<2>(std::forward<ARGS>(args)...);
+  } else {
+    OP::template Operation<1>(std::forward<ARGS>(args)...);
+  }
+}
+
+template <typename T> struct BellmanFordOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, DataChunk &args,
+                        int64_t input_size, Vector &result,
+                        UnifiedVectorFormat &vdata_src, int64_t *src_data,
+                        const UnifiedVectorFormat &vdata_target,
+                        int64_t *target_data,
+                        const std::vector<T> &weight_array) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto result_data = FlatVector::GetData<T>(result);
+    auto &result_validity = FlatVector::Validity(result);
+
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_target, target_data, false);
+    for (auto i : searches.null_rows) {
       result_validity.SetInvalid(i);
     }
+    // every batch takes the widest lanes the remaining searches fill, and
+    // reuses the distances of the previous batch
+    BellmanFordDistances<T> dists;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      auto remaining = searches.sources.size() - started_searches;
+      BellmanFordLaneDispatch<BellmanFordBatch<T>>(
+          remaining, csr, input_size, dists, searches, vdata_target,
+          target_data, weight_array, result_data, result_validity,
+          started_searches);
+    }
+  }
+};
 
-    const auto &target_entry = target_data[target_index];
-    auto resulting_distance = dists[target_entry][i % lane_limit];
+//! Runs delta-stepping once per distinct source of the rows
+template <typename T> struct DeltaSteppingOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t input_size, Vector &result,
+                        UnifiedVectorFormat &vdata_src, int64_t *src_data,
+                        const UnifiedVectorFormat &vdata_target,
+                        int64_t *target_data,
+                        const std::vector<T> &weight_array, T max_weight) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto result_data = FlatVector::GetData<T>(result);
+    auto &result_validity = FlatVector::Validity(result);
 
-    if (resulting_distance == std::numeric_limits<T>::max() / 2) {
+    auto grouped = GroupPathSearches(args.size(), vdata_src, src_data,
+                                     vdata_target, target_data, false);
+    // The searches fill in the rows of their source, and the validity is
+    // set afterwards, as its rows share words
+    vector<uint8_t> row_found(args.size(), false);
+    SsspForEachSource(
+        context, csr, input_size, weight_array, max_weight, grouped.sources,
+        [&](idx_t idx, const SsspDeltaStepping<T> &sssp) {
+          for (auto i : grouped.rows[idx]) {
+            auto target = target_data[vdata_target.sel->get_index(i)];
+            if (sssp.Reached(target)) {
+              result_data[i] = sssp.Distance(target);
+              row_found[i] = true;
+            }
+          }
+        });
+    for (auto i : grouped.null_rows) {
       result_validity.SetInvalid(i);
-    } else {
-      result_data[i] = resulting_distance;
+    }
+    for (auto &rows : grouped.rows) {
+      for (auto i : rows) {
+        if (!row_found[i]) {
+          result_validity.SetInvalid(i);
+        }
+      }
     }
   }
-  dists.clear();
-  return curr_batch_size;
-}
+};
 
+//! Delta-stepping requires non-negative weights, with negative weights the
+//! paths are found with Bellman-Ford
 template <typename T>
-void TemplatedBellmanFord(CSR *csr, DataChunk &args, int64_t input_size,
-                          Vector &result, UnifiedVectorFormat &vdata_src,
-                          int64_t *src_data,
-                          const UnifiedVectorFormat &vdata_target,
-                          int64_t *target_data, std::vector<T> weight_array) {
-  idx_t result_size = 0;
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-  auto result_data = FlatVector::GetData<T>(result);
-  auto &result_validity = FlatVector::Validity(result);
-  vector<vector<T>> final_dists(
-      input_size,
-      std::vector<T>(args.size(), std::numeric_limits<T>::max() / 2));
-
-  while (result_size < args.size()) {
-    if ((args.size() - result_size) / 256 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 256>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 128 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 128>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 64 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 64>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 16 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 16>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 8 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 8>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 4 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 4>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else if ((args.size() - result_size) / 2 >= 1) {
-      result_size += TemplatedBatchBellmanFord<T, 2>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    } else {
-      result_size += TemplatedBatchBellmanFord<T, 1>(
-          csr, args, input_size, vdata_src, src_data, vdata_target, target_data,
-          weight_array, result_size, result_data, result_validity);
-    }
+static void CheapestPathLength(const CSR &csr, ClientContext &context,
+                               DataChunk &args, int64_t input_size,
+                               Vector &result, UnifiedVectorFormat &vdata_src,
+                               int64_t *src_data,
+                               const UnifiedVectorFormat &vdata_target,
+                               int64_t *target_data,
+                               const std::vector<T> &weight_array) {
+  if (csr.negative_weight) {
+    TemplatedCSRDispatch<BellmanFordOperation<T>>(
+        csr, args, input_size, result, vdata_src, src_data, vdata_target,
+        target_data, weight_array);
+  } else {
+    TemplatedCSRDispatch<DeltaSteppingOperation<T>>(
+        csr, context, args, input_size, result, vdata_src, src_data,
+        vdata_target, target_data, weight_array, csr.MaxWeight<T>());
   }
 }
 
@@ -167,12 +307,13 @@ static void CheapestPathLengthFunction(DataChunk &args, ExpressionState &state,
   target.ToUnifiedFormat(args.size(), vdata_target);
   auto target_data = (int64_t *)vdata_target.data;
   if (csr->w.empty()) {
-    TemplatedBellmanFord<double>(csr, args, input_size, result, vdata_src,
-                                 src_data, vdata_target, target_data,
-                                 csr->w_double);
+    CheapestPathLength<double>(*csr, info.context, args, input_size, result,
+                               vdata_src, src_data, vdata_target, target_data,
+                               csr->w_double);
   } else {
-    TemplatedBellmanFord<int64_t>(csr, args, input_size, result, vdata_src,
-                                  src_data, vdata_target, target_data, csr->w);
+    CheapestPathLength<int64_t>(*csr, info.context, args, input_size, result,
+                                vdata_src, src_data, vdata_target, target_data,
+                                csr->w);
   }
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
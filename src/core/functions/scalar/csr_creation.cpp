@@ -1,10 +1,12 @@
-#include "duckdb/common/vector_operations/quaternary_executor.hpp"
+#include "duckdb/common/vector_operations/unary_executor.hpp"
 #include "duckdb/main/client_data.hpp"
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckpgq/common.hpp"
 #include "duckpgq/core/utils/compressed_sparse_row.hpp"
+#include <algorithm>
 #include <cmath>
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_parallel.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 #include <duckpgq_extension.hpp>
 #include <mutex>
@@ -13,6 +15,15 @@ namespace duckpgq {
 
 namespace core {
 
+//! Number of entries of a CSR array a single task processes, e.g. in the
+//! prefix sum over the degrees
+static constexpr idx_t CSR_BLOCK_SIZE = 1 << 16;
+//! Largest vertex id and offset a narrowed CSR can hold
+static constexpr int64_t CSR_NARROW_LIMIT = NumericLimits<uint32_t>::Maximum();
+//! Edge buffer partitions per thread, so idle threads can steal the remaining
+//! partitions when the edges are placed
+static constexpr idx_t CSR_PARTITIONS_PER_THREAD = 4;
+
 static void CsrInitializeVertex(DuckPGQState &context, int32_t id,
                                 int64_t v_size) {
   lock_guard<mutex> csr_init_lock(context.csr_lock);
@@ -24,7 +35,7 @@ static void CsrInitializeVertex(DuckPGQState &context, int32_t id,
     }
   }
   try {
-    auto csr = make_uniq<CSR>();
+    auto csr = make_shared_ptr<CSR>();
     // extra 2 spaces required for CSR padding
     // data contains a vector of elements so will need an anonymous function to
     // apply the first element id is repeated across, can I access the value
@@ -44,26 +55,119 @@ static void CsrInitializeVertex(DuckPGQState &context, int32_t id,
   }
 }
 
-static void CsrInitializeEdge(DuckPGQState &context, int32_t id, int64_t v_size,
-                              int64_t e_size) {
-  const lock_guard<mutex> csr_init_lock(context.csr_lock);
+// Turns the degrees written by create_csr_vertex (v[i + 2] holds the degree of
+// vertex i) into adjacency list offsets (v[i] holds the offset of vertex i)
+// using a blocked parallel prefix sum.
+static void CsrComputeOffsets(ClientContext &context, CSR &csr) {
+  const idx_t vsize = csr.vsize;
+  const idx_t block_count = (vsize + CSR_BLOCK_SIZE - 1) / CSR_BLOCK_SIZE;
+  auto degrees = csr.v;
+  auto degree = [&](idx_t i) -> int64_t {
+    return i + 2 < vsize ? degrees[i + 2].load(std::memory_order_relaxed) : 0;
+  };
 
-  auto csr_entry = context.csr_list.find(id);
-  if (csr_entry->second->initialized_e) {
-    return;
+  vector<int64_t> block_offsets(block_count + 1, 0);
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, vsize);
+    int64_t block_sum = 0;
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      block_sum += degree(i);
+    }
+    block_offsets[block_idx + 1] = block_sum;
+  });
+  for (idx_t block_idx = 0; block_idx < block_count; block_idx++) {
+    block_offsets[block_idx + 1] += block_offsets[block_idx];
   }
-  try {
-    csr_entry->second->e.resize(e_size, 0);
-    csr_entry->second->edge_ids.resize(e_size, 0);
-  } catch (std::bad_alloc const &) {
-    throw Exception(ExceptionType::INTERNAL,
-                    "Unable to initialize vector of size for csr edge table "
-                    "representation");
+
+  auto offsets = new std::atomic<int64_t>[vsize];
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, vsize);
+    auto offset = block_offsets[block_idx];
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      offsets[i].store(offset, std::memory_order_relaxed);
+      offset += degree(i);
+    }
+  });
+  csr.v = offsets;
+  delete[] degrees;
+}
+
+// Splits the source vertices into ranges holding roughly the same number of
+// edges, one partition of the edge buffer per range.
+static unique_ptr<CSREdgeBuffer> CsrCreateEdgeBuffer(ClientContext &context,
+                                                     const CSR &csr,
+                                                     int64_t e_size) {
+  auto v_size = static_cast<int64_t>(csr.vsize) - 2;
+  auto partition_count = MaxValue<idx_t>(
+      MinValue<idx_t>(GetThreadCount(context) * CSR_PARTITIONS_PER_THREAD,
+                      static_cast<idx_t>(v_size)),
+      1);
+
+  auto buffer = make_uniq<CSREdgeBuffer>();
+  buffer->bounds.resize(partition_count + 1);
+  buffer->bounds[0] = 0;
+  for (idx_t p = 1; p < partition_count; p++) {
+    // First vertex whose adjacency list starts at or after the target offset
+    auto target = static_cast<int64_t>(e_size * p / partition_count);
+    int64_t lower = buffer->bounds[p - 1];
+    int64_t upper = v_size;
+    while (lower < upper) {
+      auto middle = lower + (upper - lower) / 2;
+      if (csr.v[middle].load(std::memory_order_relaxed) < target) {
+        lower = middle + 1;
+      } else {
+        upper = middle;
+      }
+    }
+    buffer->bounds[p] = lower;
+  }
+  buffer->bounds[partition_count] = v_size;
+  for (idx_t p = 0; p < partition_count; p++) {
+    buffer->partitions.push_back(make_uniq<CSREdgeBuffer::Partition>());
+  }
+  return buffer;
+}
+
+// Returns the buffer the edges of the CSR are collected in. The first call
+// computes the adjacency list offsets and allocates the edge arrays. A call
+// on a CSR whose edges were placed already starts a rebuild of the edge
+// arrays, e.g. to add weights.
+static CSREdgeBuffer &CsrInitializeEdge(ClientContext &context,
+                                        DuckPGQState &duckpgq_state,
+                                        int32_t id, int64_t e_size) {
+  const lock_guard<mutex> csr_init_lock(duckpgq_state.csr_lock);
+
+  auto &csr = *duckpgq_state.csr_list.find(id)->second;
+  if (csr.edge_buffer) {
+    return *csr.edge_buffer;
   }
-  for (auto i = 1; i < v_size + 2; i++) {
-    csr_entry->second->v[i] += csr_entry->second->v[i - 1];
+  if (csr.initialized_e) {
+    // The rebuild places the edges into the 64-bit arrays and narrows again
+    csr.Widen();
+    csr.width = CSRWidth::WIDE;
+    csr.v_narrow = vector<uint32_t>();
+    csr.e_narrow = vector<uint32_t>();
+    csr.edge_ids_narrow = vector<uint32_t>();
+    csr.compressed = false;
+    csr.list_offsets = vector<uint64_t>();
+    csr.e_compressed = vector<data_t>();
+    csr.reverse.reset();
+    csr.symmetric = false;
+  } else {
+    try {
+      csr.e.resize(e_size, 0);
+      csr.edge_ids.resize(e_size, 0);
+    } catch (std::bad_alloc const &) {
+      throw Exception(ExceptionType::INTERNAL,
+                      "Unable to initialize vector of size for csr edge table "
+                      "representation");
+    }
+    CsrComputeOffsets(context, csr);
+    csr.initialized_e = true;
   }
-  csr_entry->second->initialized_e = true;
+  csr.inserted_edges = 0;
+  csr.edge_buffer = CsrCreateEdgeBuffer(context, csr, e_size);
+  return *csr.edge_buffer;
 }
 
 static void CsrInitializeWeight(DuckPGQState &context, int32_t id,
@@ -91,6 +195,432 @@ static void CsrInitializeWeight(DuckPGQState &context, int32_t id,
   csr_entry->second->initialized_w = true;
 }
 
+// Appends a chunk of edges to the edge buffer. The rows are grouped by
+// partition first, so the lock of every partition is taken at most once per
+// chunk. Returns the number of edges buffered so far.
+static int64_t CsrBufferEdges(CSREdgeBuffer &buffer, DataChunk &args,
+                              PhysicalType weight_type) {
+  auto count = args.size();
+  UnifiedVectorFormat vdata_src, vdata_dst, vdata_edge, vdata_weight;
+  args.data[4].ToUnifiedFormat(count, vdata_src);
+  args.data[5].ToUnifiedFormat(count, vdata_dst);
+  args.data[6].ToUnifiedFormat(count, vdata_edge);
+  auto src_data = (int64_t *)vdata_src.data;
+  auto dst_data = (int64_t *)vdata_dst.data;
+  auto edge_data = (int64_t *)vdata_edge.data;
+  if (weight_type != PhysicalType::INVALID) {
+    args.data[7].ToUnifiedFormat(count, vdata_weight);
+  }
+
+  auto partition_count = buffer.partitions.size();
+  vector<idx_t> row_partitions(count);
+  vector<idx_t> partition_offsets(partition_count + 1, 0);
+  for (idx_t i = 0; i < count; i++) {
+    auto src = src_data[vdata_src.sel->get_index(i)];
+    row_partitions[i] = buffer.GetPartition(src);
+    partition_offsets[row_partitions[i] + 1]++;
+  }
+  for (idx_t p = 0; p < partition_count; p++) {
+    partition_offsets[p + 1] += partition_offsets[p];
+  }
+  vector<idx_t> sorted_rows(count);
+  vector<idx_t> partition_cursors(partition_offsets.begin(),
+                                  partition_offsets.end() - 1);
+  for (idx_t i = 0; i < count; i++) {
+    sorted_rows[partition_cursors[row_partitions[i]]++] = i;
+  }
+
+  for (idx_t p = 0; p < partition_count; p++) {
+    if (partition_offsets[p] == partition_offsets[p + 1]) {
+      continue;
+    }
+    auto &partition = *buffer.partitions[p];
+    lock_guard<mutex> partition_lock(partition.lock);
+    for (idx_t k = partition_offsets[p]; k < partition_offsets[p + 1]; k++) {
+      auto row = sorted_rows[k];
+      partition.src.push_back(src_data[vdata_src.sel->get_index(row)]);
+      partition.dst.push_back(dst_data[vdata_dst.sel->get_index(row)]);
+      partition.edge_ids.push_back(edge_data[vdata_edge.sel->get_index(row)]);
+      if (weight_type == PhysicalType::INT64) {
+        partition.w.push_back(
+            ((int64_t *)vdata_weight.data)[vdata_weight.sel->get_index(row)]);
+      } else if (weight_type == PhysicalType::DOUBLE) {
+        partition.w_double.push_back(
+            ((double_t *)vdata_weight.data)[vdata_weight.sel->get_index(row)]);
+      }
+    }
+  }
+  return buffer.buffered_edges += static_cast<int64_t>(count);
+}
+
+// Places the buffered edges into e, edge_ids and the weights. Every partition
+// owns a disjoint range of source vertices, so each is placed by a single
+// thread with private insert positions and without atomics.
+static void CsrPlaceEdges(ClientContext &context, CSR &csr,
+                          PhysicalType weight_type) {
+  auto &buffer = *csr.edge_buffer;
+  ParallelFor(context, buffer.partitions.size(), [&](idx_t p) {
+    auto &partition = *buffer.partitions[p];
+    auto first_vertex = buffer.bounds[p];
+    vector<int64_t> positions(buffer.bounds[p + 1] - first_vertex);
+    for (idx_t i = 0; i < positions.size(); i++) {
+      positions[i] = csr.v[first_vertex + i].load(std::memory_order_relaxed);
+    }
+    for (idx_t k = 0; k < partition.src.size(); k++) {
+      auto pos = positions[partition.src[k] - first_vertex]++;
+      csr.e[pos] = partition.dst[k];
+      csr.edge_ids[pos] = partition.edge_ids[k];
+      if (weight_type == PhysicalType::INT64) {
+        csr.w[pos] = partition.w[k];
+      } else if (weight_type == PhysicalType::DOUBLE) {
+        csr.w_double[pos] = partition.w_double[k];
+      }
+    }
+    // Release the memory of the partition as soon as it is placed
+    partition.src = vector<int64_t>();
+    partition.dst = vector<int64_t>();
+    partition.edge_ids = vector<int64_t>();
+    partition.w = vector<int64_t>();
+    partition.w_double = vector<double>();
+  });
+  csr.inserted_edges = static_cast<int64_t>(csr.e.size());
+  csr.edge_buffer.reset();
+}
+
+// Whether every vertex has the same (neighbor, edge id) pairs in both CSRs,
+// so one can stand in for the other. Expects wide CSRs.
+static bool CsrIsTransposeOf(ClientContext &context, const CSR &csr,
+                             const CSR &rev) {
+  const idx_t v_size = csr.vsize - 2;
+  const idx_t block_count = (v_size + CSR_BLOCK_SIZE - 1) / CSR_BLOCK_SIZE;
+  atomic<bool> symmetric{true};
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, v_size);
+    vector<pair<int64_t, int64_t>> forward_edges, reverse_edges;
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end && symmetric;
+         i++) {
+      auto begin = csr.v[i].load();
+      auto end = csr.v[i + 1].load();
+      auto rev_begin = rev.v[i].load();
+      if (end - begin != rev.v[i + 1].load() - rev_begin) {
+        symmetric = false;
+        return;
+      }
+      forward_edges.clear();
+      reverse_edges.clear();
+      for (auto k = begin; k < end; k++) {
+        forward_edges.emplace_back(csr.e[k], csr.edge_ids[k]);
+        reverse_edges.emplace_back(rev.e[rev_begin + (k - begin)],
+                                   rev.edge_ids[rev_begin + (k - begin)]);
+      }
+      std::sort(forward_edges.begin(), forward_edges.end());
+      std::sort(reverse_edges.begin(), reverse_edges.end());
+      if (forward_edges != reverse_edges) {
+        symmetric = false;
+        return;
+      }
+    }
+  });
+  return symmetric;
+}
+
+// Builds the reverse CSR from the placed edges of csr, before it is narrowed.
+// The in-degrees are counted and the edges scattered with atomic increments.
+// Sorting every incoming list by source afterwards makes the result
+// deterministic: the forward positions of the edges of a list sort in the same
+// order as their sources, so both are sorted independently.
+static void CsrBuildReverse(ClientContext &context, CSR &csr) {
+  const idx_t vsize = csr.vsize;
+  const idx_t v_size = vsize - 2;
+  const idx_t edge_count = csr.e.size();
+  const idx_t block_count = (v_size + CSR_BLOCK_SIZE - 1) / CSR_BLOCK_SIZE;
+  auto reverse = make_uniq<CSR>();
+  auto &rev = *reverse;
+  rev.vsize = vsize;
+  rev.v = new std::atomic<int64_t>[vsize];
+  for (idx_t i = 0; i < vsize; i++) {
+    rev.v[i].store(0, std::memory_order_relaxed);
+  }
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, v_size);
+    auto begin = csr.v[block_idx * CSR_BLOCK_SIZE].load();
+    auto end = csr.v[block_end].load();
+    for (auto k = begin; k < end; k++) {
+      rev.v[csr.e[k] + 2].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  CsrComputeOffsets(context, rev);
+
+  try {
+    rev.e.resize(edge_count);
+    rev.edge_ids.resize(edge_count);
+    rev.w.resize(csr.w.size());
+    rev.w_double.resize(csr.w_double.size());
+  } catch (std::bad_alloc const &) {
+    throw Exception(ExceptionType::INTERNAL,
+                    "Unable to initialize vector of size for reverse csr edge "
+                    "table representation");
+  }
+  vector<int64_t> forward_positions(edge_count);
+  auto cursors = make_unsafe_uniq_array<std::atomic<int64_t>>(v_size);
+  for (idx_t i = 0; i < v_size; i++) {
+    cursors[i].store(rev.v[i].load(), std::memory_order_relaxed);
+  }
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, v_size);
+    for (idx_t src = block_idx * CSR_BLOCK_SIZE; src < block_end; src++) {
+      for (auto k = csr.v[src].load(); k < csr.v[src + 1].load(); k++) {
+        auto pos = cursors[csr.e[k]].fetch_add(1, std::memory_order_relaxed);
+        rev.e[pos] = static_cast<int64_t>(src);
+        forward_positions[pos] = k;
+      }
+    }
+  });
+
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end = MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, v_size);
+    for (idx_t dst = block_idx * CSR_BLOCK_SIZE; dst < block_end; dst++) {
+      auto begin = rev.v[dst].load();
+      auto end = rev.v[dst + 1].load();
+      std::sort(rev.e.begin() + begin, rev.e.begin() + end);
+      std::sort(forward_positions.begin() + begin,
+                forward_positions.begin() + end);
+      for (auto pos = begin; pos < end; pos++) {
+        auto k = forward_positions[pos];
+        rev.edge_ids[pos] = csr.edge_ids[k];
+        if (!csr.w.empty()) {
+          rev.w[pos] = csr.w[k];
+        }
+        if (!csr.w_double.empty()) {
+          rev.w_double[pos] = csr.w_double[k];
+        }
+      }
+    }
+  });
+  rev.initialized_v = true;
+  rev.initialized_e = true;
+  rev.initialized_w = csr.initialized_w;
+  rev.inserted_edges = static_cast<int64_t>(edge_count);
+
+  if (CsrIsTransposeOf(context, csr, rev)) {
+    // Traversing the incoming edges equals traversing the CSR itself
+    csr.symmetric = true;
+    return;
+  }
+  csr.reverse = std::move(reverse);
+}
+
+// Replaces the 64-bit arrays of a CSR whose edges are placed by 32-bit
+// copies: e if all vertex ids fit, and v and edge_ids as well if all offsets
+// and edge row ids fit. Halves the memory and the bandwidth of the kernels.
+static void CsrNarrow(ClientContext &context, CSR &csr) {
+  if (static_cast<int64_t>(csr.vsize) > CSR_NARROW_LIMIT) {
+    return;
+  }
+  const idx_t edge_count = csr.e.size();
+  bool narrow_offsets = static_cast<int64_t>(edge_count) <= CSR_NARROW_LIMIT;
+  try {
+    csr.e_narrow.resize(edge_count);
+    if (narrow_offsets) {
+      csr.edge_ids_narrow.resize(edge_count);
+    }
+  } catch (std::bad_alloc const &) {
+    // Keep the wide layout
+    csr.e_narrow = vector<uint32_t>();
+    csr.edge_ids_narrow = vector<uint32_t>();
+    return;
+  }
+
+  atomic<bool> edge_ids_fit{narrow_offsets};
+  const idx_t block_count = (edge_count + CSR_BLOCK_SIZE - 1) / CSR_BLOCK_SIZE;
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end =
+        MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, edge_count);
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      csr.e_narrow[i] = static_cast<uint32_t>(csr.e[i]);
+    }
+    if (!narrow_offsets) {
+      return;
+    }
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      auto edge_id = csr.edge_ids[i];
+      if (edge_id < 0 || edge_id > CSR_NARROW_LIMIT) {
+        edge_ids_fit = false;
+        return;
+      }
+      csr.edge_ids_narrow[i] = static_cast<uint32_t>(edge_id);
+    }
+  });
+  csr.e = vector<int64_t>();
+  if (!edge_ids_fit) {
+    csr.edge_ids_narrow = vector<uint32_t>();
+    csr.width = CSRWidth::NARROW_IDS;
+    return;
+  }
+
+  csr.v_narrow.resize(csr.vsize);
+  for (idx_t i = 0; i < csr.vsize; i++) {
+    csr.v_narrow[i] =
+        static_cast<uint32_t>(csr.v[i].load(std::memory_order_relaxed));
+  }
+  delete[] csr.v;
+  csr.v = nullptr;
+  csr.edge_ids = vector<int64_t>();
+  csr.width = CSRWidth::NARROW;
+}
+
+static bool CsrCompressionEnabled(ClientContext &context) {
+  Value compress;
+  return context.TryGetCurrentSetting("duckpgq_compress_csr", compress) &&
+         !compress.IsNull() && compress.GetValue<bool>();
+}
+
+static void CsrWriteVarint(vector<data_t> &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<data_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<data_t>(value));
+}
+
+// Reorders the entries [begin, end) of an edge array by order
+template <class T>
+static void CsrPermute(vector<T> &values, idx_t begin,
+                       const vector<idx_t> &order) {
+  if (values.empty()) {
+    return;
+  }
+  vector<T> sorted(order.size());
+  for (idx_t k = 0; k < order.size(); k++) {
+    sorted[k] = values[order[k]];
+  }
+  std::copy(sorted.begin(), sorted.end(), values.begin() + begin);
+}
+
+// Sorts the neighbor list [begin, end) of a narrowed CSR, together with its
+// edge ids and weights
+static void CsrSortNeighbors(CSR &csr, idx_t begin, idx_t end,
+                             vector<idx_t> &order) {
+  auto &e = csr.e_narrow;
+  if (std::is_sorted(e.begin() + begin, e.begin() + end)) {
+    return;
+  }
+  order.resize(end - begin);
+  for (idx_t k = 0; k < order.size(); k++) {
+    order[k] = begin + k;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](idx_t a, idx_t b) { return e[a] < e[b]; });
+  CsrPermute(e, begin, order);
+  CsrPermute(csr.edge_ids, begin, order);
+  CsrPermute(csr.edge_ids_narrow, begin, order);
+  CsrPermute(csr.w, begin, order);
+  CsrPermute(csr.w_double, begin, order);
+}
+
+// Encodes the sorted neighbor list [begin, end) in the format read by
+// CompressedCSRView::ForEachNeighbor
+static void CsrEncodeNeighbors(const vector<uint32_t> &e, idx_t begin,
+                               idx_t end, vector<data_t> &out) {
+  uint32_t gaps[CSR_COMPRESSION_GROUP_SIZE];
+  data_t packed[CSR_COMPRESSION_GROUP_SIZE * sizeof(uint32_t)];
+  uint32_t previous = 0;
+  for (idx_t group = begin; group < end; group += CSR_COMPRESSION_GROUP_SIZE) {
+    auto count = MinValue<idx_t>(CSR_COMPRESSION_GROUP_SIZE, end - group);
+    CsrWriteVarint(out, e[group] - previous);
+    uint32_t gap_bits = 0;
+    gaps[0] = 0;
+    for (idx_t k = 1; k < count; k++) {
+      gaps[k] = e[group + k] - e[group + k - 1];
+      gap_bits |= gaps[k];
+    }
+    for (idx_t k = count; k < CSR_COMPRESSION_GROUP_SIZE; k++) {
+      gaps[k] = 0;
+    }
+    bitpacking_width_t width = 0;
+    while (width < 32 && (gap_bits >> width) != 0) {
+      width++;
+    }
+    out.push_back(width);
+    if (width > 0) {
+      BitpackingPrimitives::PackBuffer<uint32_t, true>(
+          packed, gaps, CSR_COMPRESSION_GROUP_SIZE, width);
+      // The last group of a list is stored without padding
+      out.insert(out.end(), packed, packed + (count * width + 7) / 8);
+    }
+    previous = e[group + count - 1];
+  }
+}
+
+// Replaces e_narrow of a narrowed CSR by sorted, compressed neighbor lists,
+// see CompressedCSRView. Ranges of vertices are encoded in parallel into
+// private buffers, which are concatenated afterwards.
+static void CsrCompress(ClientContext &context, CSR &csr) {
+  D_ASSERT(csr.width != CSRWidth::WIDE);
+  const idx_t list_count = csr.vsize - 1;
+  const idx_t block_count = (list_count + CSR_BLOCK_SIZE - 1) / CSR_BLOCK_SIZE;
+  csr.list_offsets.resize(csr.vsize);
+  vector<vector<data_t>> block_data(block_count);
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end =
+        MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, list_count);
+    auto &out = block_data[block_idx];
+    vector<idx_t> order;
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      auto begin = static_cast<idx_t>(csr.GetOffset(i));
+      auto end = static_cast<idx_t>(csr.GetOffset(i + 1));
+      csr.list_offsets[i] = out.size();
+      CsrSortNeighbors(csr, begin, end, order);
+      CsrEncodeNeighbors(csr.e_narrow, begin, end, out);
+    }
+  });
+
+  vector<uint64_t> block_offsets(block_count + 1, 0);
+  for (idx_t block_idx = 0; block_idx < block_count; block_idx++) {
+    block_offsets[block_idx + 1] =
+        block_offsets[block_idx] + block_data[block_idx].size();
+  }
+  csr.e_compressed.resize(block_offsets[block_count]);
+  ParallelFor(context, block_count, [&](idx_t block_idx) {
+    auto block_end =
+        MinValue<idx_t>((block_idx + 1) * CSR_BLOCK_SIZE, list_count);
+    for (idx_t i = block_idx * CSR_BLOCK_SIZE; i < block_end; i++) {
+      csr.list_offsets[i] += block_offsets[block_idx];
+    }
+    auto &data = block_data[block_idx];
+    std::copy(data.begin(), data.end(),
+              csr.e_compressed.begin() + block_offsets[block_idx]);
+    data = vector<data_t>();
+  });
+  csr.list_offsets[list_count] = block_offsets[block_count];
+  csr.e_narrow = vector<uint32_t>();
+  csr.compressed = true;
+}
+
+template <typename T>
+static void CsrWeightStats(const vector<T> &weights, bool &negative,
+                           T &max_weight) {
+  negative = false;
+  max_weight = 0;
+  for (auto weight : weights) {
+    negative = negative || weight < 0;
+    max_weight = MaxValue<T>(max_weight, weight);
+  }
+}
+
+// Picks the layout the kernels read a CSR in once its edges are placed
+static void CsrFinalize(ClientContext &context, CSR &csr) {
+  if (!csr.w.empty()) {
+    CsrWeightStats(csr.w, csr.negative_weight, csr.max_w);
+  } else {
+    CsrWeightStats(csr.w_double, csr.negative_weight, csr.max_w_double);
+  }
+  CsrNarrow(context, csr);
+  if (csr.width != CSRWidth::WIDE && CsrCompressionEnabled(context)) {
+    CsrCompress(context, csr);
+  }
+}
+
 static void CreateCsrVertexFunction(DataChunk &args, ExpressionState &state,
                                     Vector &result) {
   auto &func_expr = (BoundFunctionExpression &)state.expr;
@@ -109,11 +639,16 @@ static void CreateCsrVertexFunction(DataChunk &args, ExpressionState &state,
     }
   }
 
+  // The degrees of a CSR whose offsets are computed already are not written
+  // again, e.g. when its edges are rebuilt with weights
+  auto write_degrees = !csr_entry->second->initialized_e;
   BinaryExecutor::Execute<int64_t, int64_t, int64_t>(
       args.data[2], args.data[3], result, args.size(),
       [&](int64_t src, int64_t cnt) {
         int64_t edge_count = 0;
-        csr_entry->second->v[src + 2] = cnt;
+        if (write_degrees) {
+          csr_entry->second->v[src + 2] = cnt;
+        }
         edge_count = edge_count + cnt;
         return edge_count;
       });
@@ -133,7 +668,19 @@ static void CreateCsrEdgeFunction(DataChunk &args, ExpressionState &state,
         "The DuckPGQ extension has not been loaded");
   }
 
-  int64_t vertex_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  if (args.ColumnCount() == 2) {
+    // The CSR was in the CSR cache when the statement was bound, see
+    // CreateCachedCSRCTE
+    if (!duckpgq_state->UseCachedCSR(info.cache_key, info.id)) {
+      throw InvalidInputException(
+          "CSR %s is no longer in the CSR cache, run the query again",
+          info.cache_key);
+    }
+    result.SetVectorType(VectorType::CONSTANT_VECTOR);
+    ConstantVector::GetData<int32_t>(result)[0] = 1;
+    return;
+  }
+
   int64_t edge_size = args.data[2].GetValue(0).GetValue<int64_t>();
   int64_t edge_size_count = args.data[3].GetValue(0).GetValue<int64_t>();
   if (edge_size != edge_size_count) {
@@ -141,50 +688,51 @@ static void CreateCsrEdgeFunction(DataChunk &args, ExpressionState &state,
     throw ConstraintException("Non-unique vertices detected. Make sure all "
                               "vertices are unique for path-finding queries.");
   }
-
-  auto csr_entry = duckpgq_state->csr_list.find(info.id);
-  if (!csr_entry->second->initialized_e) {
-    CsrInitializeEdge(*duckpgq_state, info.id, vertex_size, edge_size);
-  }
-  if (info.weight_type == LogicalType::SQLNULL) {
-    TernaryExecutor::Execute<int64_t, int64_t, int64_t, int32_t>(
-        args.data[4], args.data[5], args.data[6], result, args.size(),
-        [&](int64_t src, int64_t dst, int64_t edge_id) {
-          auto pos = ++csr_entry->second->v[src + 1];
-          csr_entry->second->e[(int64_t)pos - 1] = dst;
-          csr_entry->second->edge_ids[(int64_t)pos - 1] = edge_id;
-          return 1;
-        });
+  if (!info.cache_key.empty() &&
+      duckpgq_state->UseCachedCSR(info.cache_key, info.id)) {
+    // The cached CSR is complete and shared, it is never built into
+    result.SetVectorType(VectorType::CONSTANT_VECTOR);
+    ConstantVector::GetData<int32_t>(result)[0] = 1;
     return;
   }
-  auto weight_type = args.data[7].GetType().InternalType();
-  if (!csr_entry->second->initialized_w) {
-    CsrInitializeWeight(*duckpgq_state, info.id, edge_size, weight_type);
-  }
-  if (weight_type == PhysicalType::INT64) {
-    QuaternaryExecutor::Execute<int64_t, int64_t, int64_t, int64_t, int32_t>(
-        args.data[4], args.data[5], args.data[6], args.data[7], result,
-        args.size(),
-        [&](int64_t src, int64_t dst, int64_t edge_id, int64_t weight) {
-          auto pos = ++csr_entry->second->v[src + 1];
-          csr_entry->second->e[(int64_t)pos - 1] = dst;
-          csr_entry->second->edge_ids[(int64_t)pos - 1] = edge_id;
-          csr_entry->second->w[(int64_t)pos - 1] = weight;
-          return weight;
-        });
-    return;
+
+  auto &buffer = CsrInitializeEdge(info.context, *duckpgq_state, info.id,
+                                   edge_size);
+  auto &csr = *duckpgq_state->csr_list.find(info.id)->second;
+  auto weight_type = PhysicalType::INVALID;
+  if (info.weight_type != LogicalType::SQLNULL) {
+    weight_type = args.data[7].GetType().InternalType();
+    if (!csr.initialized_w) {
+      CsrInitializeWeight(*duckpgq_state, info.id, edge_size, weight_type);
+    }
   }
 
-  QuaternaryExecutor::Execute<int64_t, int64_t, int64_t, double_t, int32_t>(
-      args.data[4], args.data[5], args.data[6], args.data[7], result,
-      args.size(),
-      [&](int64_t src, int64_t dst, int64_t edge_id, double_t weight) {
-        auto pos = ++csr_entry->second->v[src + 1];
-        csr_entry->second->e[(int64_t)pos - 1] = dst;
-        csr_entry->second->edge_ids[(int64_t)pos - 1] = edge_id;
-        csr_entry->second->w_double[(int64_t)pos - 1] = weight;
-        return weight;
-      });
+  auto buffered_edges = CsrBufferEdges(buffer, args, weight_type);
+  if (buffered_edges == edge_size) {
+    // All edges have arrived, the thread that buffered the last ones places
+    // them into the CSR
+    CsrPlaceEdges(info.context, csr, weight_type);
+    if (info.build_reverse) {
+      CsrBuildReverse(info.context, csr);
+      if (csr.reverse) {
+        CsrFinalize(info.context, *csr.reverse);
+      }
+    }
+    CsrFinalize(info.context, csr);
+  }
+
+  if (weight_type == PhysicalType::INVALID) {
+    result.SetVectorType(VectorType::CONSTANT_VECTOR);
+    ConstantVector::GetData<int32_t>(result)[0] = 1;
+  } else if (weight_type == PhysicalType::INT64) {
+    UnaryExecutor::Execute<int64_t, int32_t>(
+        args.data[7], result, args.size(),
+        [&](int64_t weight) { return weight; });
+  } else {
+    UnaryExecutor::Execute<double_t, int32_t>(
+        args.data[7], result, args.size(),
+        [&](double_t weight) { return weight; });
+  }
 }
 
 ScalarFunctionSet GetCSRVertexFunction() {
@@ -209,6 +757,10 @@ ScalarFunctionSet GetCSREdgeFunction() {
    * 5. destination rowid
    * 6. edge rowid
    * 7. <optional> edge weight (INT OR DOUBLE)
+   * 8. <optional> constant BOOLEAN, whether to also build the reverse CSR
+   * 9. <optional> constant VARCHAR, the key of the CSR in the CSR cache
+   *
+   * create_csr_edge(CSR ID, key) only installs the CSR from the CSR cache
    */
 
   //! No edge weight
@@ -235,6 +787,51 @@ ScalarFunctionSet GetCSREdgeFunction() {
                                  LogicalType::INTEGER, CreateCsrEdgeFunction,
                                  CSRFunctionData::CSREdgeBind));
 
+  //! The same with the reverse CSR flag
+  set.AddFunction(ScalarFunction({LogicalType::INTEGER, LogicalType::BIGINT,
+                                  LogicalType::BIGINT, LogicalType::BIGINT,
+                                  LogicalType::BIGINT, LogicalType::BIGINT,
+                                  LogicalType::BIGINT, LogicalType::BOOLEAN},
+                                 LogicalType::INTEGER, CreateCsrEdgeFunction,
+                                 CSRFunctionData::CSREdgeBind));
+
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BOOLEAN},
+      LogicalType::INTEGER, CreateCsrEdgeFunction,
+      CSRFunctionData::CSREdgeBind));
+
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::DOUBLE, LogicalType::BOOLEAN},
+      LogicalType::INTEGER, CreateCsrEdgeFunction,
+      CSRFunctionData::CSREdgeBind));
+
+  //! The same with the key of the CSR in the CSR cache, see CreateCSRCTE
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::VARCHAR},
+      LogicalType::INTEGER, CreateCsrEdgeFunction,
+      CSRFunctionData::CSREdgeBind));
+
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN, LogicalType::VARCHAR},
+      LogicalType::INTEGER, CreateCsrEdgeFunction,
+      CSRFunctionData::CSREdgeBind));
+
+  //! Installs a cached CSR. It must not be folded into a constant, which
+  //! would install the CSR while the query is optimized.
+  ScalarFunction install_cached({LogicalType::INTEGER, LogicalType::VARCHAR},
+                                LogicalType::INTEGER, CreateCsrEdgeFunction,
+                                CSRFunctionData::CSREdgeBind);
+  install_cached.stability = FunctionStability::VOLATILE;
+  set.AddFunction(install_cached);
+
   return set;
 }
 
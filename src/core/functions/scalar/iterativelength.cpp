@@ -5,34 +5,349 @@
 #include "duckpgq/core/functions/function_data/iterative_length_function_data.hpp"
 
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 
 namespace core {
 
-static bool IterativeLength(int64_t v_size, int64_t *v, vector<int64_t> &e,
-                            vector<std::bitset<LANE_LIMIT>> &seen,
-                            vector<std::bitset<LANE_LIMIT>> &visit,
-                            vector<std::bitset<LANE_LIMIT>> &next) {
-  bool change = false;
-  for (auto i = 0; i < v_size; i++) {
-    next[i] = 0;
+//! Thresholds of direction-optimizing BFS (Beamer et al.): switch to
+//! bottom-up steps once the edges of the frontier exceed 1/alpha of the edges
+//! left to check, and back to top-down once the frontier holds fewer than
+//! 1/beta of the vertices
+static constexpr int64_t BFS_ALPHA = 14;
+static constexpr int64_t BFS_BETA = 24;
+
+//! Top-down step: pushes the frontier along the outgoing edges
+template <idx_t LANES, class CSR_VIEW>
+static void IterativeLengthTopDown(ClientContext &context, int64_t v_size,
+                                   idx_t range_count, const CSR_VIEW &csr,
+                                   LaneBitsetArray<LANES> &visit,
+                                   LaneBitsetArray<LANES> &next) {
+  BfsParallelRanges(context, v_size, range_count,
+                    [&](idx_t, int64_t begin, int64_t end) {
+                      for (auto i = begin; i < end; i++) {
+                        next[i].reset();
+                      }
+                    });
+  BfsPushFrontier(context, csr, v_size, range_count, visit,
+                  [&](int64_t v, int64_t n, int64_t) { next[n] |= visit[v]; });
+}
+
+//! Bottom-up step: every vertex not seen by all lanes pulls the frontier from
+//! its incoming edges, and stops once all its unseen lanes are reached
+template <idx_t LANES, class CSR_VIEW>
+static void IterativeLengthBottomUp(ClientContext &context, int64_t v_size,
+                                    idx_t range_count, const CSR_VIEW &in_csr,
+                                    const LaneBitset<LANES> &lanes,
+                                    LaneBitsetArray<LANES> &seen,
+                                    LaneBitsetArray<LANES> &visit,
+                                    LaneBitsetArray<LANES> &next) {
+  BfsParallelRanges(
+      context, v_size, range_count, [&](idx_t, int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; i++) {
+          auto unseen = lanes & ~seen[i];
+          next[i].reset();
+          if (unseen.none()) {
+            continue;
+          }
+          in_csr.AnyNeighbor(i, [&](int64_t n, int64_t) {
+            next[i] |= visit[n] & unseen;
+            return next[i] == unseen;
+          });
+        }
+      });
+}
+
+//! Marks the vertices reached by a step as seen. Returns whether any were
+//! reached, and collects what the direction of the next step is chosen by.
+template <idx_t LANES, class CSR_VIEW>
+static bool IterativeLengthFinishStep(
+    ClientContext &context, int64_t v_size, idx_t range_count,
+    const CSR_VIEW &csr, const CSR_VIEW *in_csr,
+    const LaneBitset<LANES> &lanes, LaneBitsetArray<LANES> &seen,
+    LaneBitsetArray<LANES> &next, int64_t &frontier_vertices,
+    int64_t &frontier_edges, int64_t &unexplored_edges) {
+  // Every range sums up its own counts, which are added up afterwards
+  vector<int64_t> range_vertices(range_count, 0);
+  vector<int64_t> range_edges(range_count, 0);
+  vector<int64_t> range_unexplored(range_count, 0);
+  BfsParallelRanges(
+      context, v_size, range_count,
+      [&](idx_t range_idx, int64_t begin, int64_t end) {
+        range_vertices[range_idx] = LaneBitsetMarkSeen(
+            next.data() + begin, seen.data() + begin, end - begin);
+        if (!in_csr) {
+          // The edge counts only matter for switching to bottom-up steps
+          return;
+        }
+        for (auto i = begin; i < end; i++) {
+          if (next[i].any()) {
+            range_edges[range_idx] += csr.Degree(i);
+          }
+          if ((seen[i] & lanes) != lanes) {
+            range_unexplored[range_idx] += in_csr->Degree(i);
+          }
+        }
+      });
+  frontier_vertices = 0;
+  frontier_edges = 0;
+  unexplored_edges = 0;
+  for (idx_t range_idx = 0; range_idx < range_count; range_idx++) {
+    frontier_vertices += range_vertices[range_idx];
+    frontier_edges += range_edges[range_idx];
+    unexplored_edges += range_unexplored[range_idx];
   }
-  for (auto i = 0; i < v_size; i++) {
-    if (visit[i].any()) {
-      for (auto offset = v[i]; offset < v[i + 1]; offset++) {
-        auto n = e[offset];
-        next[n] = next[n] | visit[i];
+  return frontier_vertices > 0;
+}
+
+//! Ends a sparse step, like IterativeLengthFinishStep does for dense steps.
+//! The unexplored edges are updated with the vertices that the step made seen
+//! by all lanes, which can only be vertices of the new frontier.
+template <idx_t LANES, class CSR_VIEW>
+static bool IterativeLengthFinishSparseStep(
+    BfsFrontier &frontier, const CSR_VIEW &csr, const CSR_VIEW *in_csr,
+    const LaneBitset<LANES> &lanes, LaneBitsetArray<LANES> &seen,
+    LaneBitsetArray<LANES> &next, int64_t &frontier_vertices,
+    int64_t &frontier_edges, int64_t &unexplored_edges) {
+  frontier_vertices = frontier.MarkSeen(next, seen);
+  frontier_edges = 0;
+  for (auto v : frontier.Vertices()) {
+    frontier_edges += csr.Degree(v);
+    if (in_csr && (seen[v] & lanes) == lanes &&
+        (seen[v] & ~next[v] & lanes) != lanes) {
+      unexplored_edges -= in_csr->Degree(v);
+    }
+  }
+  return frontier_vertices > 0;
+}
+
+//! Runs the next searches, as many as fit in LANES lanes. Every search runs
+//! from a distinct source for all rows with that source. The searches stop
+//! after upper steps, and report destinations reached in fewer than lower
+//! steps as not found.
+struct IterativeLengthBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, const CSR_VIEW *in_csr,
+                        ClientContext &context, int64_t v_size,
+                        Vector &result, idx_t range_count,
+                        BfsFrontier &frontier, int64_t total_in_edges,
+                        const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_dst,
+                        const int64_t *dst_data, int64_t lower, int64_t upper,
+                        ScratchPool &scratch, idx_t &started_searches) {
+    ValidityMask &result_validity = FlatVector::Validity(result);
+    auto result_data = FlatVector::GetData<int64_t>(result);
+
+    // create temp SIMD arrays
+    LaneBitsetArray<LANES> seen(scratch, v_size);
+    LaneBitsetArray<LANES> visit1(scratch, v_size);
+    LaneBitsetArray<LANES> visit2(scratch, v_size);
+
+    // maps lane to search, and to the rows of the search whose destination
+    // was not reached yet
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    AssignPathSearchLanes<LANES>(
+        searches, vdata_dst, dst_data, started_searches, lane_search,
+        lane_rows, [&](idx_t row) {
+          // path of length 0 does not require a search
+          result_data[row] = 0;
+          if (lower > 0) {
+            result_validity.SetInvalid(row);
+          }
+          return true;
+        });
+
+    // add search jobs to free lanes
+    uint64_t active = 0;
+    LaneBitset<LANES> lanes;
+    vector<int64_t> sources;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_search[lane] < 0) {
+        continue;
+      }
+      auto source = searches.sources[lane_search[lane]];
+      visit1[source].set(lane);
+      seen[source].set(lane);
+      lanes.set(lane);
+      sources.push_back(source);
+      active++;
+    }
+
+    frontier.Start(std::move(sources));
+    int64_t unexplored_edges = total_in_edges;
+    if (in_csr) {
+      for (auto v : frontier.Vertices()) {
+        if ((seen[v] & lanes) == lanes) {
+          unexplored_edges -= in_csr->Degree(v);
+        }
+      }
+    }
+
+    // make passes while a lane is still active
+    bool bottom_up = false;
+    int64_t frontier_vertices, frontier_edges;
+    for (int64_t iter = 1; active && iter <= upper; iter++) {
+      auto &visit = (iter & 1) ? visit1 : visit2;
+      auto &next = (iter & 1) ? visit2 : visit1;
+      bool reached;
+      if (!bottom_up && frontier.IsSparse()) {
+        frontier.Push(csr, next, [&](int64_t v, int64_t n, int64_t) {
+          next[n] |= visit[v];
+        });
+        reached = IterativeLengthFinishSparseStep(
+            frontier, csr, in_csr, lanes, seen, next, frontier_vertices,
+            frontier_edges, unexplored_edges);
+      } else {
+        if (bottom_up) {
+          IterativeLengthBottomUp(context, v_size, range_count, *in_csr, lanes,
+                                  seen, visit, next);
+        } else {
+          IterativeLengthTopDown(context, v_size, range_count, csr, visit,
+                                 next);
+        }
+        reached = IterativeLengthFinishStep(
+            context, v_size, range_count, csr, in_csr, lanes, seen, next,
+            frontier_vertices, frontier_edges, unexplored_edges);
+        frontier.DenseStepDone(next, frontier_vertices);
+      }
+      if (!reached) {
+        break;
+      }
+      if (in_csr) {
+        if (!bottom_up && frontier_edges > unexplored_edges / BFS_ALPHA) {
+          bottom_up = true;
+        } else if (bottom_up && frontier_vertices < v_size / BFS_BETA) {
+          bottom_up = false;
+        }
+      }
+      // detect rows whose destination was reached, and lanes that finished
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        auto &rows = lane_rows[lane];
+        if (rows.empty()) {
+          continue;
+        }
+        idx_t kept = 0;
+        for (auto row : rows) {
+          auto dst = dst_data[vdata_dst.sel->get_index(row)];
+          if (!seen[dst].test(lane)) {
+            rows[kept++] = row;
+            continue;
+          }
+          result_data[row] = iter; /* found at iter => iter = path length */
+          if (iter < lower) {
+            result_validity.SetInvalid(row);
+          }
+        }
+        rows.resize(kept);
+        if (rows.empty()) {
+          active--;
+        }
+      }
+    }
+
+    // no changes anymore or the upper bound was reached: any rows left have
+    // no path
+    for (auto &rows : lane_rows) {
+      for (auto row : rows) {
+        result_validity.SetInvalid(row);
+        result_data[row] = (int64_t)-1; /* no path */
       }
     }
   }
-  for (auto i = 0; i < v_size; i++) {
-    next[i] = next[i] & ~seen[i];
-    seen[i] = seen[i] | next[i];
-    change |= next[i].any();
+};
+
+struct IterativeLengthOperation {
+  //! incoming holds the incoming edges of csr for bottom-up steps, or is
+  //! nullptr to only take top-down steps. lower and upper bound the hops of
+  //! a path, see IterativeLengthFunctionData.
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result,
+                        const CSR *incoming, int64_t lower, int64_t upper) {
+    // create result vector
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+
+    CSR_VIEW in_view;
+    const CSR_VIEW *in_csr = nullptr;
+    if (incoming) {
+      in_view = incoming->GetViewAs<CSR_VIEW>();
+      in_csr = &in_view;
+    }
+
+    // the steps of the search are split over the threads by vertex ranges
+    auto range_count = BfsRangeCount(context, v_size);
+    BfsFrontier frontier(context, v_size, range_count);
+
+    // the edges bottom-up steps may have to check before any vertex is seen
+    int64_t total_in_edges = 0;
+    if (in_csr) {
+      for (int64_t i = 0; i < v_size; i++) {
+        total_in_edges += in_csr->Degree(i);
+      }
+    }
+
+    UnifiedVectorFormat vdata_src, vdata_dst;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto dst_data = (int64_t *)vdata_dst.data;
+
+    // rows with the same source share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_dst, dst_data, false);
+    auto &result_validity = FlatVector::Validity(result);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<IterativeLengthBatch>(
+          searches.sources.size() - started_searches, csr, in_csr, context,
+          v_size, result, range_count, frontier, total_in_edges, searches,
+          vdata_dst, dst_data, lower, upper, scratch, started_searches);
+    }
+  }
+};
+
+//! Looks the path lengths up in the distance index of the CSR instead of
+//! searching, with the same results as IterativeLengthOperation
+static void IterativeLengthFromIndex(const DistanceIndex &index,
+                                     DataChunk &args, Vector &result,
+                                     bool reverse, int64_t lower,
+                                     int64_t upper) {
+  result.SetVectorType(VectorType::FLAT_VECTOR);
+  auto result_data = FlatVector::GetData<int64_t>(result);
+  auto &result_validity = FlatVector::Validity(result);
+
+  UnifiedVectorFormat vdata_src, vdata_dst;
+  args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+  args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+  auto src_data = (int64_t *)vdata_src.data;
+  auto dst_data = (int64_t *)vdata_dst.data;
+  for (idx_t row = 0; row < args.size(); row++) {
+    auto src_idx = vdata_src.sel->get_index(row);
+    auto dst_idx = vdata_dst.sel->get_index(row);
+    if (!vdata_src.validity.RowIsValid(src_idx) ||
+        !vdata_dst.validity.RowIsValid(dst_idx)) {
+      result_validity.SetInvalid(row);
+      continue;
+    }
+    // Following the incoming edges from src is following the outgoing edges
+    // from dst
+    auto length = reverse ? index.Query(dst_data[dst_idx], src_data[src_idx])
+                          : index.Query(src_data[src_idx], dst_data[dst_idx]);
+    result_data[row] = length;
+    if (length < 0 || length < lower || length > upper) {
+      result_validity.SetInvalid(row);
+    }
   }
-  return change;
 }
 
 static void IterativeLengthFunction(DataChunk &args, ExpressionState &state,
@@ -57,99 +372,28 @@ static void IterativeLengthFunction(DataChunk &args, ExpressionState &state,
         "Need to initialize CSR before doing shortest path");
   }
   int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-
-  // get src and dst vectors for searches
-  auto &src = args.data[2];
-  auto &dst = args.data[3];
-  UnifiedVectorFormat vdata_src;
-  UnifiedVectorFormat vdata_dst;
-  src.ToUnifiedFormat(args.size(), vdata_src);
-  dst.ToUnifiedFormat(args.size(), vdata_dst);
-  auto src_data = (int64_t *)vdata_src.data;
-  auto dst_data = (int64_t *)vdata_dst.data;
-
-  ValidityMask &result_validity = FlatVector::Validity(result);
-
-  // create result vector
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-  auto result_data = FlatVector::GetData<int64_t>(result);
-
-  // create temp SIMD arrays
-  vector<std::bitset<LANE_LIMIT>> seen(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit1(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit2(v_size);
-
-  // maps lane to search number
-  short lane_to_num[LANE_LIMIT];
-  for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-    lane_to_num[lane] = -1; // inactive
+  auto &forward = *csr_entry->second;
+  if (duckpgq_state->UseDistanceIndex(info.csr_id)) {
+    IterativeLengthFromIndex(forward.GetDistanceIndex(info.context), args,
+                             result, info.reverse, info.lower, info.upper);
+    forward.distance_index_hits += args.size();
+    duckpgq_state->csr_to_delete.insert(info.csr_id);
+    return;
   }
-
-  idx_t started_searches = 0;
-  while (started_searches < args.size()) {
-
-    // empty visit vectors
-    for (auto i = 0; i < v_size; i++) {
-      seen[i] = 0;
-      visit1[i] = 0;
-    }
-
-    // add search jobs to free lanes
-    uint64_t active = 0;
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      lane_to_num[lane] = -1;
-      while (started_searches < args.size()) {
-        int64_t search_num = started_searches++;
-        int64_t src_pos = vdata_src.sel->get_index(search_num);
-        int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-        if (!vdata_src.validity.RowIsValid(src_pos)) {
-          result_validity.SetInvalid(search_num);
-          result_data[search_num] = (uint64_t)-1; /* no path */
-        } else if (src_data[src_pos] == dst_data[dst_pos]) {
-          result_data[search_num] =
-              (uint64_t)0; // path of length 0 does not require a search
-        } else {
-          visit1[src_data[src_pos]][lane] = true;
-          lane_to_num[lane] = search_num; // active lane
-          active++;
-          break;
-        }
-      }
-    }
-
-    // make passes while a lane is still active
-    for (int64_t iter = 1; active; iter++) {
-      if (!IterativeLength(v_size, v, e, seen, (iter & 1) ? visit1 : visit2,
-                           (iter & 1) ? visit2 : visit1)) {
-        break;
-      }
-      // detect lanes that finished
-      for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-        int64_t search_num = lane_to_num[lane];
-        if (search_num >= 0) { // active lane
-          int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-          if (seen[dst_data[dst_pos]][lane]) {
-            result_data[search_num] =
-                iter;               /* found at iter => iter = path length */
-            lane_to_num[lane] = -1; // mark inactive
-            active--;
-          }
-        }
-      }
-    }
-
-    // no changes anymore: any still active searches have no path
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      int64_t search_num = lane_to_num[lane];
-      if (search_num >= 0) { // active lane
-        result_validity.SetInvalid(search_num);
-        result_data[search_num] = (int64_t)-1; /* no path */
-        lane_to_num[lane] = -1;                // mark inactive
-      }
-    }
+  auto &csr = info.reverse ? forward.GetReverse() : forward;
+  // The incoming edges of the traversed CSR, for bottom-up steps
+  CSR *incoming = nullptr;
+  if (info.reverse) {
+    incoming = &forward;
+  } else if (forward.HasReverse()) {
+    incoming = &forward.GetReverse();
+  }
+  if (incoming && !incoming->SameLayout(csr)) {
+    incoming = nullptr;
   }
+  TemplatedCSRDispatch<IterativeLengthOperation>(csr, info.context, args,
+                                                 v_size, result, incoming,
+                                                 info.lower, info.upper);
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
 
@@ -158,12 +402,31 @@ static void IterativeLengthFunction(DataChunk &args, ExpressionState &state,
 //------------------------------------------------------------------------------
 void CoreScalarFunctions::RegisterIterativeLengthScalarFunction(
     DatabaseInstance &db) {
-  ExtensionUtil::RegisterFunction(
-      db, ScalarFunction("iterativelength",
-                         {LogicalType::INTEGER, LogicalType::BIGINT,
-                          LogicalType::BIGINT, LogicalType::BIGINT},
-                         LogicalType::BIGINT, IterativeLengthFunction,
-                         IterativeLengthFunctionData::IterativeLengthBind));
+  ScalarFunctionSet set("iterativelength");
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::BIGINT, IterativeLengthFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! Following the incoming edges if the last argument is true
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN},
+      LogicalType::BIGINT, IterativeLengthFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! With the fewest and most hops of the path as the last two arguments
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT},
+      LogicalType::BIGINT, IterativeLengthFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::BIGINT, IterativeLengthFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  ExtensionUtil::RegisterFunction(db, set);
 }
 
 } // namespace core
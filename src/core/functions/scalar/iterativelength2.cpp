@@ -6,136 +6,175 @@
 #include <duckpgq_extension.hpp>
 
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 
 namespace core {
 
-static bool IterativeLength2(int64_t v_size, int64_t *V, vector<int64_t> &E,
-                             vector<std::bitset<LANE_LIMIT>> &seen,
-                             vector<std::bitset<LANE_LIMIT>> &visit,
-                             vector<std::bitset<LANE_LIMIT>> &next) {
-  std::bitset<LANE_LIMIT> change;
+template <idx_t LANES, class CSR_VIEW>
+static bool IterativeLength2(int64_t v_size, const CSR_VIEW &csr,
+                             LaneBitsetArray<LANES> &seen,
+                             LaneBitsetArray<LANES> &visit,
+                             LaneBitsetArray<LANES> &next,
+                             BfsFrontier &frontier) {
+  if (frontier.IsSparse()) {
+    for (auto v : frontier.Vertices()) {
+      seen[v] |= visit[v];
+    }
+    frontier.Push(csr, next, [&](int64_t v, int64_t n, int64_t) {
+      next[n] |= visit[v] & ~seen[n];
+    });
+    return frontier.Advance() > 0;
+  }
+  idx_t reached = 0;
   for (auto v = 0; v < v_size; v++) {
     seen[v] |= visit[v];
-    next[v] = 0;
+    next[v].reset();
   }
   for (auto v = 0; v < v_size; v++) {
     if (visit[v].any()) {
-      for (auto e = V[v]; e < V[v + 1]; e++) {
-        auto n = E[e];
+      csr.ForEachNeighbor(v, [&](int64_t n, int64_t) {
         auto unseen = visit[v] & ~seen[n];
+        if (next[n].none() && unseen.any()) {
+          reached++;
+        }
         next[n] |= unseen;
-        change |= unseen;
-      }
+      });
     }
   }
-  return change.any();
+  frontier.DenseStepDone(next, reached);
+  return reached > 0;
 }
 
-static void IterativeLength2Function(DataChunk &args, ExpressionState &state,
-                                     Vector &result) {
-  auto &func_expr = (BoundFunctionExpression &)state.expr;
-  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
-
-  auto duckpgq_state = GetDuckPGQState(info.context);
-
-  D_ASSERT(duckpgq_state->csr_list[info.csr_id]);
-  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-
-  // get src and dst vectors for searches
-  auto &src = args.data[2];
-  auto &dst = args.data[3];
-  UnifiedVectorFormat vdata_src;
-  UnifiedVectorFormat vdata_dst;
-  src.ToUnifiedFormat(args.size(), vdata_src);
-  dst.ToUnifiedFormat(args.size(), vdata_dst);
-  auto src_data = (int64_t *)vdata_src.data;
-  auto dst_data = (int64_t *)vdata_dst.data;
-
-  // create result vector
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-  auto result_data = FlatVector::GetData<int64_t>(result);
-
-  ValidityMask &result_validity = FlatVector::Validity(result);
-
-  // create temp SIMD arrays
-  vector<std::bitset<LANE_LIMIT>> seen(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit1(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit2(v_size);
-
-  // maps lane to search number
-  short lane_to_num[LANE_LIMIT];
-  for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-    lane_to_num[lane] = -1; // inactive
-  }
-
-  idx_t started_searches = 0;
-  while (started_searches < args.size()) {
-
-    // empty visit vectors
-    for (auto i = 0; i < v_size; i++) {
-      seen[i] = 0;
-      visit1[i] = 0;
-    }
+//! Runs the next searches, as many as fit in LANES lanes. Every search runs
+//! from a distinct source for all rows with that source.
+struct IterativeLength2Batch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, int64_t v_size, Vector &result,
+                        BfsFrontier &frontier, const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_dst,
+                        const int64_t *dst_data, ScratchPool &scratch,
+                        idx_t &started_searches) {
+    auto result_data = FlatVector::GetData<int64_t>(result);
+    ValidityMask &result_validity = FlatVector::Validity(result);
+
+    // create temp SIMD arrays
+    LaneBitsetArray<LANES> seen(scratch, v_size);
+    LaneBitsetArray<LANES> visit1(scratch, v_size);
+    LaneBitsetArray<LANES> visit2(scratch, v_size);
+
+    // maps lane to search, and to the rows of the search whose destination
+    // was not reached yet
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    AssignPathSearchLanes<LANES>(
+        searches, vdata_dst, dst_data, started_searches, lane_search,
+        lane_rows, [&](idx_t row) {
+          // path of length 0 does not require a search
+          result_data[row] = 0;
+          return true;
+        });
 
     // add search jobs to free lanes
     uint64_t active = 0;
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      lane_to_num[lane] = -1;
-      while (started_searches < args.size()) {
-        int64_t search_num = started_searches++;
-        int64_t src_pos = vdata_src.sel->get_index(search_num);
-        int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-        if (!vdata_src.validity.RowIsValid(src_pos)) {
-          result_validity.SetInvalid(search_num);
-          result_data[search_num] = (uint64_t)-1; // no path
-        } else if (src_data[src_pos] == dst_data[dst_pos]) {
-          result_data[search_num] =
-              (uint64_t)0; // path of length 0 does not require a search
-        } else {
-          visit1[src_data[src_pos]][lane] = 1;
-          lane_to_num[lane] = search_num; // active lane
-          active++;
-          break;
-        }
+    vector<int64_t> sources;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_search[lane] < 0) {
+        continue;
       }
+      auto source = searches.sources[lane_search[lane]];
+      visit1[source].set(lane);
+      sources.push_back(source);
+      active++;
     }
 
+    frontier.Start(std::move(sources));
+
     // make passes while a lane is still active
     for (int64_t iter = 1; active; iter++) {
-      if (!IterativeLength2(v_size, v, e, seen, (iter & 1) ? visit1 : visit2,
-                            (iter & 1) ? visit2 : visit1)) {
+      auto &next = (iter & 1) ? visit2 : visit1;
+      if (!IterativeLength2(v_size, csr, seen, (iter & 1) ? visit1 : visit2,
+                            next, frontier)) {
         break;
       }
-      // detect lanes that finished
-      for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-        int64_t search_num = lane_to_num[lane];
-        if (search_num >= 0) { // active lane
-          int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-          if ((iter & 1) ? visit2[dst_data[dst_pos]][lane]
-                         : visit1[dst_data[dst_pos]][lane]) {
-            result_data[search_num] =
-                iter;               /* found at iter => iter = path length */
-            lane_to_num[lane] = -1; // mark inactive
-            active--;
+      // detect rows whose destination was reached, and lanes that finished
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        auto &rows = lane_rows[lane];
+        if (rows.empty()) {
+          continue;
+        }
+        idx_t kept = 0;
+        for (auto row : rows) {
+          if (next[dst_data[vdata_dst.sel->get_index(row)]].test(lane)) {
+            result_data[row] = iter; /* found at iter => iter = path length */
+          } else {
+            rows[kept++] = row;
           }
         }
+        rows.resize(kept);
+        if (rows.empty()) {
+          active--;
+        }
       }
     }
-    // no changes anymore: any still active searches have no path
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      int64_t search_num = lane_to_num[lane];
-      if (search_num >= 0) { // active lane
-        result_validity.SetInvalid(search_num);
-        result_data[search_num] = (int64_t)-1; /* no path */
-        lane_to_num[lane] = -1;                // mark inactive
+    // no changes anymore: any rows left have no path
+    for (auto &rows : lane_rows) {
+      for (auto row : rows) {
+        result_validity.SetInvalid(row);
+        result_data[row] = (int64_t)-1; /* no path */
       }
     }
   }
+};
+
+struct IterativeLength2Operation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result) {
+    // create result vector
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    BfsFrontier frontier(context, v_size, 1);
+
+    UnifiedVectorFormat vdata_src, vdata_dst;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto dst_data = (int64_t *)vdata_dst.data;
+
+    // rows with the same source share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_dst, dst_data, false);
+    auto &result_validity = FlatVector::Validity(result);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<IterativeLength2Batch>(
+          searches.sources.size() - started_searches, csr, v_size, result,
+          frontier, searches, vdata_dst, dst_data, scratch, started_searches);
+    }
+  }
+};
+
+static void IterativeLength2Function(DataChunk &args, ExpressionState &state,
+                                     Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
+
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  D_ASSERT(duckpgq_state->csr_list[info.csr_id]);
+  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  CSR *csr = duckpgq_state->GetCSR(info.csr_id);
+  TemplatedCSRDispatch<IterativeLength2Operation>(*csr, info.context, args,
+                                                  v_size, result);
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
 
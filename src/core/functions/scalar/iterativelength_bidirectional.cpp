@@ -5,162 +5,201 @@
 #include "duckpgq/core/functions/function_data/iterative_length_function_data.hpp"
 
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 
 namespace core {
 
-static bool
-IterativeLengthBidirectional(int64_t v_size, int64_t *V, vector<int64_t> &E,
-                             vector<std::bitset<LANE_LIMIT>> &seen,
-                             vector<std::bitset<LANE_LIMIT>> &visit,
-                             vector<std::bitset<LANE_LIMIT>> &next) {
-  bool change = false;
+template <idx_t LANES>
+static LaneBitset<LANES>
+InterSectFronteers(int64_t v_size, LaneBitsetArray<LANES> &src_seen,
+                   LaneBitsetArray<LANES> &dst_seen) {
+  return LaneBitsetIntersect(src_seen.data(), dst_seen.data(), v_size);
+}
+
+//! One step of the search from one side. done is set to the lanes whose
+//! searches from both sides have met.
+template <idx_t LANES, class CSR_VIEW>
+static bool IterativeLengthBidirectional(
+    int64_t v_size, const CSR_VIEW &csr, LaneBitsetArray<LANES> &seen,
+    LaneBitsetArray<LANES> &visit, LaneBitsetArray<LANES> &next,
+    BfsFrontier &frontier, LaneBitsetArray<LANES> &other_seen,
+    LaneBitset<LANES> &done) {
+  if (frontier.IsSparse()) {
+    frontier.Push(csr, next, [&](int64_t v, int64_t n, int64_t) {
+      next[n] |= visit[v];
+    });
+    if (frontier.MarkSeen(next, seen) == 0) {
+      return false;
+    }
+    // Lanes that met before are finished, new meetings are on the frontier
+    done.reset();
+    for (auto v : frontier.Vertices()) {
+      done |= next[v] & other_seen[v];
+    }
+    return true;
+  }
   for (auto v = 0; v < v_size; v++) {
-    next[v] = 0;
+    next[v].reset();
   }
   for (auto v = 0; v < v_size; v++) {
     if (visit[v].any()) {
-      for (auto e = V[v]; e < V[v + 1]; e++) {
-        auto n = E[e];
+      csr.ForEachNeighbor(v, [&](int64_t n, int64_t) {
         next[n] = next[n] | visit[v];
-      }
+      });
     }
   }
-  for (auto v = 0; v < v_size; v++) {
-    next[v] = next[v] & ~seen[v];
-    seen[v] = seen[v] | next[v];
-    change |= next[v].any();
+  auto reached = LaneBitsetMarkSeen(next.data(), seen.data(), v_size);
+  frontier.DenseStepDone(next, reached);
+  if (reached == 0) {
+    return false;
   }
-  return change;
-}
-static std::bitset<LANE_LIMIT>
-InterSectFronteers(int64_t v_size, vector<std::bitset<LANE_LIMIT>> &src_seen,
-                   vector<std::bitset<LANE_LIMIT>> &dst_seen) {
-  std::bitset<LANE_LIMIT> result;
-  for (auto v = 0; v < v_size; v++) {
-    result |= src_seen[v] & dst_seen[v];
-  }
-  return result;
+  done = InterSectFronteers(v_size, seen, other_seen);
+  return true;
 }
 
-static void IterativeLengthBidirectionalFunction(DataChunk &args,
-                                                 ExpressionState &state,
-                                                 Vector &result) {
-  auto &func_expr = (BoundFunctionExpression &)state.expr;
-  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
-
-  auto duckpgq_state = GetDuckPGQState(info.context);
-
-  D_ASSERT(duckpgq_state->csr_list[info.csr_id]);
-  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-
-  // get src and dst vectors for searches
-  auto &src = args.data[2];
-  auto &dst = args.data[3];
-  UnifiedVectorFormat vdata_src;
-  UnifiedVectorFormat vdata_dst;
-  src.ToUnifiedFormat(args.size(), vdata_src);
-  dst.ToUnifiedFormat(args.size(), vdata_dst);
-  auto src_data = (int64_t *)vdata_src.data;
-  auto dst_data = (int64_t *)vdata_dst.data;
-
-  // create result vector
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-  ValidityMask &result_validity = FlatVector::Validity(result);
-  auto result_data = FlatVector::GetData<int64_t>(result);
-
-  // create temp SIMD arrays
-  vector<std::bitset<LANE_LIMIT>> src_seen(v_size);
-  vector<std::bitset<LANE_LIMIT>> src_visit1(v_size);
-  vector<std::bitset<LANE_LIMIT>> src_visit2(v_size);
-  vector<std::bitset<LANE_LIMIT>> dst_seen(v_size);
-  vector<std::bitset<LANE_LIMIT>> dst_visit1(v_size);
-  vector<std::bitset<LANE_LIMIT>> dst_visit2(v_size);
-
-  // maps lane to search number
-  int16_t lane_to_num[LANE_LIMIT];
-  for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-    lane_to_num[lane] = -1; // inactive
-  }
-
-  idx_t started_searches = 0;
-  while (started_searches < args.size()) {
-
-    // empty visit vectors
-    for (auto i = 0; i < v_size; i++) {
-      src_seen[i] = 0;
-      dst_seen[i] = 0;
-      src_visit1[i] = 0;
-      dst_visit1[i] = 0;
-    }
+//! Runs the next searches, as many as fit in LANES lanes. Every search runs
+//! between a distinct pair of source and destination for all rows with that
+//! pair.
+struct IterativeLengthBidirectionalBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, int64_t v_size, Vector &result,
+                        BfsFrontier &src_frontier, BfsFrontier &dst_frontier,
+                        const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_dst,
+                        const int64_t *dst_data, ScratchPool &scratch,
+                        idx_t &started_searches) {
+    ValidityMask &result_validity = FlatVector::Validity(result);
+    auto result_data = FlatVector::GetData<int64_t>(result);
+
+    // create temp SIMD arrays
+    LaneBitsetArray<LANES> src_seen(scratch, v_size);
+    LaneBitsetArray<LANES> src_visit1(scratch, v_size);
+    LaneBitsetArray<LANES> src_visit2(scratch, v_size);
+    LaneBitsetArray<LANES> dst_seen(scratch, v_size);
+    LaneBitsetArray<LANES> dst_visit1(scratch, v_size);
+    LaneBitsetArray<LANES> dst_visit2(scratch, v_size);
+
+    // maps lane to search, and to the rows of the search
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    AssignPathSearchLanes<LANES>(
+        searches, vdata_dst, dst_data, started_searches, lane_search,
+        lane_rows, [&](idx_t row) {
+          // path of length 0 does not require a search
+          result_data[row] = 0;
+          return true;
+        });
 
     // add search jobs to free lanes
     uint64_t active = 0;
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      lane_to_num[lane] = -1;
-      while (started_searches < args.size()) {
-        int64_t search_num = started_searches++;
-        int64_t src_pos = vdata_src.sel->get_index(search_num);
-        int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-        if (!vdata_src.validity.RowIsValid(src_pos)) {
-          result_validity.SetInvalid(search_num);
-          result_data[search_num] = (uint64_t)-1; // no path
-        } else if (src_data[src_pos] == dst_data[dst_pos]) {
-          result_data[search_num] =
-              (uint64_t)0; // path of length 0 does not require a search
-        } else {
-          src_visit1[src_data[src_pos]][lane] = true;
-          dst_visit1[dst_data[dst_pos]][lane] = true;
-          src_seen[src_data[src_pos]][lane] = true;
-          dst_seen[dst_data[dst_pos]][lane] = true;
-          lane_to_num[lane] = search_num; // active lane
-          active++;
-          break;
-        }
+    vector<int64_t> sources, destinations;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_search[lane] < 0) {
+        continue;
       }
+      auto source = searches.sources[lane_search[lane]];
+      auto destination = searches.destinations[lane_search[lane]];
+      src_visit1[source].set(lane);
+      dst_visit1[destination].set(lane);
+      src_seen[source].set(lane);
+      dst_seen[destination].set(lane);
+      sources.push_back(source);
+      destinations.push_back(destination);
+      active++;
     }
 
+    src_frontier.Start(std::move(sources));
+    dst_frontier.Start(std::move(destinations));
+
     // make passes while a lane is still active
+    LaneBitset<LANES> done;
     for (int64_t iter = 0; active; iter++) {
       if (!IterativeLengthBidirectional(
-              v_size, v, e, (iter & 1) ? dst_seen : src_seen,
+              v_size, csr, (iter & 1) ? dst_seen : src_seen,
               (iter & 2)   ? (iter & 1) ? dst_visit2 : src_visit2
               : (iter & 1) ? dst_visit1
                            : src_visit1,
               (iter & 2)   ? (iter & 1) ? dst_visit1 : src_visit1
               : (iter & 1) ? dst_visit2
-                           : src_visit2)) {
+                           : src_visit2,
+              (iter & 1) ? dst_frontier : src_frontier,
+              (iter & 1) ? src_seen : dst_seen, done)) {
         break;
       }
-      std::bitset<LANE_LIMIT> done =
-          InterSectFronteers(v_size, src_seen, dst_seen);
       // detect lanes that finished
-      for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-        if (done[lane]) {
-          int64_t search_num = lane_to_num[lane];
-          if (search_num >= 0) {
-            result_data[search_num] =
-                iter + 1;           /* found at iter => iter = path length */
-            lane_to_num[lane] = -1; // mark inactive
-            active--;
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        if (done.test(lane) && !lane_rows[lane].empty()) {
+          for (auto row : lane_rows[lane]) {
+            // found at iter => iter + 1 = path length
+            result_data[row] = iter + 1;
           }
+          lane_rows[lane].clear(); // mark inactive
+          active--;
         }
       }
     }
     // no changes anymore: any still active searches have no path
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      int64_t search_num = lane_to_num[lane];
-      if (search_num >= 0) {
-        result_validity.SetInvalid(search_num);
-        result_data[search_num] = (int64_t)-1; /* no path */
-        lane_to_num[lane] = -1;                // mark inactive
+    for (auto &rows : lane_rows) {
+      for (auto row : rows) {
+        result_validity.SetInvalid(row);
+        result_data[row] = (int64_t)-1; /* no path */
       }
     }
   }
+};
+
+struct IterativeLengthBidirectionalOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result) {
+    // create result vector
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    BfsFrontier src_frontier(context, v_size, 1);
+    BfsFrontier dst_frontier(context, v_size, 1);
+
+    UnifiedVectorFormat vdata_src, vdata_dst;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto dst_data = (int64_t *)vdata_dst.data;
+
+    // rows with the same source and destination share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_dst, dst_data, true);
+    auto &result_validity = FlatVector::Validity(result);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<IterativeLengthBidirectionalBatch>(
+          searches.sources.size() - started_searches, csr, v_size, result,
+          src_frontier, dst_frontier, searches, vdata_dst, dst_data, scratch,
+          started_searches);
+    }
+  }
+};
+
+static void IterativeLengthBidirectionalFunction(DataChunk &args,
+                                                 ExpressionState &state,
+                                                 Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
+
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  D_ASSERT(duckpgq_state->csr_list[info.csr_id]);
+  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  CSR *csr = duckpgq_state->GetCSR(info.csr_id);
+  TemplatedCSRDispatch<IterativeLengthBidirectionalOperation>(
+      *csr, info.context, args, v_size, result);
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
 
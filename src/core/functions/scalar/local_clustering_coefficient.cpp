@@ -1,7 +1,7 @@
 #include "duckdb/planner/expression/bound_function_expression.hpp"
 #include "duckpgq/common.hpp"
 #include "duckpgq/core/functions/function_data/local_clustering_coefficient_function_data.hpp"
-#include "duckpgq/core/utils/duckpgq_bitmap.hpp"
+#include "duckpgq/core/utils/duckpgq_sorted_adjacency.hpp"
 #include "duckpgq/core/utils/duckpgq_utils.hpp"
 
 #include <duckpgq/core/functions/scalar.hpp>
@@ -10,6 +10,28 @@ namespace duckpgq {
 
 namespace core {
 
+// Number of edges from the neighbors of vertex back into its neighbors. Every
+// distinct neighbor intersects its list with the list of vertex once, and
+// counts for all edges to it.
+static int64_t CountNeighborEdges(const SortedAdjacency &adjacency,
+                                  int64_t vertex) {
+  auto neighbors = adjacency.Begin(vertex);
+  auto neighbors_end = adjacency.End(vertex);
+  int64_t count = 0;
+  for (auto n = neighbors; n < neighbors_end;) {
+    auto neighbor = *n;
+    int64_t edges_to_neighbor = 0;
+    for (; n < neighbors_end && *n == neighbor; n++) {
+      edges_to_neighbor++;
+    }
+    count += edges_to_neighbor *
+             static_cast<int64_t>(CountContained(adjacency.Begin(neighbor),
+                                                 adjacency.End(neighbor),
+                                                 neighbors, neighbors_end));
+  }
+  return count;
+}
+
 static void LocalClusteringCoefficientFunction(DataChunk &args,
                                                ExpressionState &state,
                                                Vector &result) {
@@ -26,9 +48,13 @@ static void LocalClusteringCoefficientFunction(DataChunk &args,
     throw ConstraintException(
         "Need to initialize CSR before doing local clustering coefficient.");
   }
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-  size_t v_size = duckpgq_state->csr_list[info.csr_id]->vsize;
+  auto &csr = *csr_entry->second;
+  info.computation.Run([&]() {
+    info.adjacency.Build(info.context, csr, info.computation);
+  });
+  auto &adjacency = info.adjacency;
+  auto vertex_count = static_cast<int64_t>(adjacency.VertexCount());
+
   // get src and dst vectors for searches
   auto &src = args.data[1];
   UnifiedVectorFormat vdata_src;
@@ -40,35 +66,25 @@ static void LocalClusteringCoefficientFunction(DataChunk &args,
   result.SetVectorType(VectorType::FLAT_VECTOR);
   auto result_data = FlatVector::GetData<float>(result);
 
-  DuckPGQBitmap neighbors(v_size);
-
   for (idx_t n = 0; n < args.size(); n++) {
     auto src_sel = vdata_src.sel->get_index(n);
     if (!vdata_src.validity.RowIsValid(src_sel)) {
       result_validity.SetInvalid(n);
+      continue;
     }
     int64_t src_node = src_data[src_sel];
-    int64_t number_of_edges = v[src_node + 1] - v[src_node];
+    if (src_node < 0 || src_node >= vertex_count) {
+      result_validity.SetInvalid(n);
+      continue;
+    }
+    int64_t number_of_edges = adjacency.Degree(src_node);
     if (number_of_edges < 2) {
       result_data[n] = static_cast<float>(0.0);
       continue;
     }
-    neighbors.reset();
-    for (int64_t offset = v[src_node]; offset < v[src_node + 1]; offset++) {
-      neighbors.set(e[offset]);
-    }
 
     // Count connections between neighbors
-    int64_t count = 0;
-    for (int64_t offset = v[src_node]; offset < v[src_node + 1]; offset++) {
-      int64_t neighbor = e[offset];
-      for (int64_t offset2 = v[neighbor]; offset2 < v[neighbor + 1];
-           offset2++) {
-        int is_connected = neighbors.test(e[offset2]);
-        count += is_connected; // Add 1 if connected, 0 otherwise
-      }
-    }
-
+    int64_t count = CountNeighborEdges(adjacency, src_node);
     float local_result =
         static_cast<float>(count) / (number_of_edges * (number_of_edges - 1));
     result_data[n] = local_result;
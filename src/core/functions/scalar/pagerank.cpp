@@ -3,89 +3,150 @@
 #include "duckpgq/core/functions/function_data/pagerank_function_data.hpp"
 #include <duckpgq/core/functions/scalar.hpp>
 #include <duckpgq/core/functions/table/pagerank.hpp>
-#include <duckpgq/core/utils/duckpgq_bitmap.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 namespace core {
 
-static void PageRankFunction(DataChunk &args, ExpressionState &state,
-                             Vector &result) {
-  auto &func_expr = (BoundFunctionExpression &)state.expr;
-  auto &info = (PageRankFunctionData &)*func_expr.bind_info;
-  auto duckpgq_state = GetDuckPGQState(info.context);
-
-  // Locate the CSR representation of the graph
-  auto csr_entry = duckpgq_state->csr_list.find((uint64_t)info.csr_id);
-  if (csr_entry == duckpgq_state->csr_list.end()) {
-    throw ConstraintException("CSR not found. Is the graph populated?");
-  }
-
-  if (!(csr_entry->second->initialized_v && csr_entry->second->initialized_e)) {
-    throw ConstraintException(
-        "Need to initialize CSR before running PageRank.");
-  }
-
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-  size_t v_size = duckpgq_state->csr_list[info.csr_id]->vsize;
-
-  // State initialization (only once)
-  if (!info.state_initialized) {
-    info.rank.resize(v_size, 1.0 / v_size); // Initial rank for each node
-    info.temp_rank.resize(v_size,
-                          0.0); // Temporary storage for ranks during iteration
-    info.damping_factor = 0.85; // Typical damping factor
-    info.convergence_threshold = 1e-6; // Convergence threshold
-    info.state_initialized = true;
-    info.converged = false;
-    info.iteration_count = 0;
-  }
-
-  // Check if already converged
-  if (!info.converged) {
-    std::lock_guard<std::mutex> guard(info.state_lock); // Thread safety
-
-    bool continue_iteration = true;
-    while (continue_iteration) {
-      fill(info.temp_rank.begin(), info.temp_rank.end(), 0.0);
-
-      double total_dangling_rank = 0.0; // For dangling nodes
-
-      for (size_t i = 0; i < v_size; i++) {
-        int64_t start_edge = v[i];
-        int64_t end_edge =
-            (i + 1 < v_size) ? v[i + 1] : e.size(); // Adjust end_edge
-        if (end_edge > start_edge) {
-          double rank_contrib = info.rank[i] / (end_edge - start_edge);
-          for (int64_t j = start_edge; j < end_edge; j++) {
-            int64_t neighbor = e[j];
-            info.temp_rank[neighbor] += rank_contrib;
+//! Power iteration that pulls the rank of every vertex from its incoming
+//! edges. The vertices are split into ranges that every thread writes its own
+//! of, so the threads need no synchronization within an iteration. If pull is
+//! false, edges holds the outgoing instead of the incoming edges, along which
+//! the ranks are pushed first.
+struct PageRankOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &edges, const CSR &csr,
+                        PageRankFunctionData &info, bool pull) {
+    auto &context = info.context;
+    // The CSR pads its offsets with two slots that are not vertices
+    auto v_size = static_cast<int64_t>(csr.vsize) - 2;
+    auto range_count = BfsRangeCount(context, v_size);
+    auto range_size = BfsRangeSize(v_size, range_count);
+    auto parallel_ranges =
+        [&](const std::function<void(idx_t, int64_t, int64_t)> &function) {
+          info.computation.ParallelFor(context, range_count, [&](idx_t idx) {
+            auto begin =
+                MinValue<int64_t>(static_cast<int64_t>(idx) * range_size,
+                                  v_size);
+            function(idx, begin, MinValue<int64_t>(begin + range_size, v_size));
+          });
+        };
+
+    vector<int64_t> out_degree(v_size, 0);
+    parallel_ranges([&](idx_t, int64_t begin, int64_t end) {
+      for (auto i = begin; i < end; i++) {
+        out_degree[i] = csr.GetOffset(i + 1) - csr.GetOffset(i);
+      }
+    });
+
+    info.rank.assign(v_size, 1.0 / v_size);
+    info.temp_rank.assign(v_size, 0.0);
+    vector<double_t> contribution(v_size, 0.0);
+    vector<double_t> pushed_rank(pull ? 0 : v_size);
+    vector<double_t> range_dangling(range_count);
+    vector<double_t> range_delta(range_count);
+    while (info.iteration_count < info.max_iterations) {
+      // Every vertex spreads its rank over its outgoing edges, and dangling
+      // vertices over all vertices
+      parallel_ranges([&](idx_t range_idx, int64_t begin, int64_t end) {
+        double_t dangling_rank = 0.0;
+        for (auto i = begin; i < end; i++) {
+          if (out_degree[i] > 0) {
+            contribution[i] = info.rank[i] / out_degree[i];
+          } else {
+            dangling_rank += info.rank[i];
           }
-        } else {
-          total_dangling_rank += info.rank[i];
+        }
+        range_dangling[range_idx] = dangling_rank;
+      });
+      double_t total_dangling_rank = 0.0;
+      for (auto dangling_rank : range_dangling) {
+        total_dangling_rank += dangling_rank;
+      }
+
+      if (!pull) {
+        // Adds the contributions in the order of their sources, like pulling
+        // them from the sorted incoming edges does
+        std::fill(pushed_rank.begin(), pushed_rank.end(), 0.0);
+        for (int64_t i = 0; i < v_size; i++) {
+          edges.ForEachNeighbor(i, [&](int64_t neighbor, int64_t) {
+            pushed_rank[neighbor] += contribution[i];
+          });
         }
       }
 
       // Apply damping factor and handle dangling node ranks
-      double correction_factor = total_dangling_rank / v_size;
-      double max_delta = 0.0;
-      for (size_t i = 0; i < v_size; i++) {
-        info.temp_rank[i] =
-            (1 - info.damping_factor) / v_size +
-            info.damping_factor * (info.temp_rank[i] + correction_factor);
-        max_delta =
-            std::max(max_delta, std::abs(info.temp_rank[i] - info.rank[i]));
+      double_t correction_factor = total_dangling_rank / v_size;
+      parallel_ranges([&](idx_t range_idx, int64_t begin, int64_t end) {
+        double_t max_delta = 0.0;
+        for (auto i = begin; i < end; i++) {
+          double_t incoming_rank = 0.0;
+          if (!pull) {
+            incoming_rank = pushed_rank[i];
+          } else {
+            edges.ForEachNeighbor(i, [&](int64_t neighbor, int64_t) {
+              incoming_rank += contribution[neighbor];
+            });
+          }
+          info.temp_rank[i] =
+              (1 - info.damping_factor) / v_size +
+              info.damping_factor * (incoming_rank + correction_factor);
+          max_delta =
+              std::max(max_delta, std::abs(info.temp_rank[i] - info.rank[i]));
+        }
+        range_delta[range_idx] = max_delta;
+      });
+      double_t max_delta = 0.0;
+      for (auto delta : range_delta) {
+        max_delta = std::max(max_delta, delta);
       }
 
       info.rank.swap(info.temp_rank);
       info.iteration_count++;
+      info.residuals.push_back(max_delta);
       if (max_delta < info.convergence_threshold) {
         info.converged = true;
-        continue_iteration = false;
+        break;
       }
     }
   }
+};
+
+// Computes the ranks once, all threads evaluating the function take part
+static CSR &ComputePageRank(PageRankFunctionData &info) {
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  // Locate the CSR representation of the graph
+  auto csr_entry = duckpgq_state->csr_list.find((uint64_t)info.csr_id);
+  if (csr_entry == duckpgq_state->csr_list.end()) {
+    throw ConstraintException("CSR not found. Is the graph populated?");
+  }
+
+  if (!(csr_entry->second->initialized_v && csr_entry->second->initialized_e)) {
+    throw ConstraintException(
+        "Need to initialize CSR before running PageRank.");
+  }
+
+  auto &csr = *csr_entry->second;
+  info.computation.Run([&]() {
+    if (csr.HasReverse()) {
+      TemplatedCSRDispatch<PageRankOperation>(csr.GetReverse(), csr, info,
+                                              true);
+    } else {
+      // E.g. a CSR built by create_csr_edge without the reverse flag
+      TemplatedCSRDispatch<PageRankOperation>(csr, csr, info, false);
+    }
+  });
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+  return csr;
+}
+
+static void PageRankFunction(DataChunk &args, ExpressionState &state,
+                             Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (PageRankFunctionData &)*func_expr.bind_info;
+  size_t v_size = ComputePageRank(info).vsize - 2;
 
   // Get the source vector for the current DataChunk
   auto &src = args.data[1];
@@ -112,19 +173,67 @@ static void PageRankFunction(DataChunk &args, ExpressionState &state,
     }
     result_data[i] = info.rank[node_id];
   }
+}
 
-  duckpgq_state->csr_to_delete.insert(info.csr_id);
+// The largest change of a rank in the given iteration, NULL for iterations
+// after PageRank stopped
+static void PageRankResidualFunction(DataChunk &args, ExpressionState &state,
+                                     Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (PageRankFunctionData &)*func_expr.bind_info;
+  ComputePageRank(info);
+
+  UnifiedVectorFormat vdata_iteration;
+  args.data[1].ToUnifiedFormat(args.size(), vdata_iteration);
+  auto iteration_data = (int64_t *)vdata_iteration.data;
+
+  ValidityMask &result_validity = FlatVector::Validity(result);
+  result.SetVectorType(VectorType::FLAT_VECTOR);
+  auto result_data = FlatVector::GetData<double_t>(result);
+  for (idx_t i = 0; i < args.size(); i++) {
+    auto iteration_pos = vdata_iteration.sel->get_index(i);
+    if (!vdata_iteration.validity.RowIsValid(iteration_pos)) {
+      result_validity.SetInvalid(i);
+      continue;
+    }
+    auto iteration = iteration_data[iteration_pos];
+    if (iteration < 1 || iteration > (int64_t)info.residuals.size()) {
+      result_validity.SetInvalid(i);
+      continue;
+    }
+    result_data[i] = info.residuals[iteration - 1];
+  }
 }
 
 //------------------------------------------------------------------------------
 // Register functions
 //------------------------------------------------------------------------------
 void CoreScalarFunctions::RegisterPageRankScalarFunction(DatabaseInstance &db) {
-  ExtensionUtil::RegisterFunction(
-      db,
-      ScalarFunction("pagerank", {LogicalType::INTEGER, LogicalType::BIGINT},
+  ScalarFunctionSet set("pagerank");
+  set.AddFunction(
+      ScalarFunction({LogicalType::INTEGER, LogicalType::BIGINT},
                      LogicalType::DOUBLE, PageRankFunction,
                      PageRankFunctionData::PageRankBind));
+  //! With the damping factor, tolerance and most iterations as the last
+  //! three arguments
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::DOUBLE,
+       LogicalType::DOUBLE, LogicalType::BIGINT},
+      LogicalType::DOUBLE, PageRankFunction,
+      PageRankFunctionData::PageRankBind));
+  ExtensionUtil::RegisterFunction(db, set);
+
+  ScalarFunctionSet residual_set("pagerank_residual");
+  residual_set.AddFunction(
+      ScalarFunction({LogicalType::INTEGER, LogicalType::BIGINT},
+                     LogicalType::DOUBLE, PageRankResidualFunction,
+                     PageRankFunctionData::PageRankBind));
+  residual_set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::DOUBLE,
+       LogicalType::DOUBLE, LogicalType::BIGINT},
+      LogicalType::DOUBLE, PageRankResidualFunction,
+      PageRankFunctionData::PageRankBind));
+  ExtensionUtil::RegisterFunction(db, residual_set);
 }
 
 } // namespace core
@@ -0,0 +1,276 @@
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/functions/function_data/pagerank_function_data.hpp"
+
+#include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_parallel.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
+#include <duckpgq/core/utils/duckpgq_scratch.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+//! Number of seeds whose pushes share one pass over the touched vertices
+#define PERSONALIZED_PAGERANK_LANES 16
+
+//! The approximate personalized PageRank of a vertex for a seed
+struct PersonalizedRank {
+  int64_t vertex;
+  double_t rank;
+};
+
+//! Appends the ranks of a seed as the list of a row
+static void AppendPersonalizedRanks(Vector &result, idx_t row,
+                                    const vector<PersonalizedRank> &ranks) {
+  auto result_data = FlatVector::GetData<list_entry_t>(result);
+  auto offset = ListVector::GetListSize(result);
+  ListVector::Reserve(result, offset + ranks.size());
+  auto &entries = StructVector::GetEntries(ListVector::GetEntry(result));
+  auto vertex_data = FlatVector::GetData<int64_t>(*entries[0]);
+  auto rank_data = FlatVector::GetData<double_t>(*entries[1]);
+  for (idx_t i = 0; i < ranks.size(); i++) {
+    vertex_data[offset + i] = ranks[i].vertex;
+    rank_data[offset + i] = ranks[i].rank;
+  }
+  result_data[row].offset = offset;
+  result_data[row].length = ranks.size();
+  ListVector::SetListSize(result, offset + ranks.size());
+}
+
+//! Forward push of Andersen, Chung and Lang for the seeds of one batch, one
+//! lane each. Only the vertices the pushes reach get a slot, which holds the
+//! rank and the residual of every lane, so a batch costs time in the size of
+//! the neighborhood it touches. A vertex pushes the residual of all its lanes
+//! that reach the tolerance per out-edge in one pass over its edges. The
+//! residual of a vertex without out-edges goes back to the seed.
+class PersonalizedPageRankBatch {
+public:
+  //! slots maps every vertex to its slot plus one, or 0, and is left so,
+  //! also if a batch throws
+  PersonalizedPageRankBatch(ScratchArray<idx_t> &slots, double_t damping,
+                            double_t tolerance)
+      : slots(slots), damping(damping), tolerance(tolerance) {}
+  ~PersonalizedPageRankBatch() {
+    for (auto vertex : touched) {
+      slots[vertex] = 0;
+    }
+  }
+
+  template <class CSR_VIEW>
+  void Run(const CSR_VIEW &csr, const int64_t *seeds, idx_t lane_count,
+           vector<PersonalizedRank> *ranks) {
+    static constexpr idx_t LANES = PERSONALIZED_PAGERANK_LANES;
+    for (idx_t lane = 0; lane < lane_count; lane++) {
+      auto slot = GetSlot(seeds[lane]);
+      residual[slot * LANES + lane] = 1.0;
+      Enqueue(csr, seeds[lane], slot);
+    }
+
+    double_t pushed[LANES];
+    for (idx_t head = 0; head < queue.size(); head++) {
+      auto u = queue[head];
+      auto u_slot = slots[u] - 1;
+      queued[u_slot] = false;
+      auto degree = csr.Degree(u);
+      auto threshold = tolerance * MaxValue<int64_t>(degree, 1);
+      bool any_pushed = false;
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        auto r = residual[u_slot * LANES + lane];
+        if (r < threshold || r == 0) {
+          pushed[lane] = 0;
+          continue;
+        }
+        rank[u_slot * LANES + lane] += (1 - damping) * r;
+        residual[u_slot * LANES + lane] = 0;
+        pushed[lane] = damping * r;
+        any_pushed = true;
+      }
+      if (!any_pushed) {
+        continue;
+      }
+      if (degree == 0) {
+        for (idx_t lane = 0; lane < lane_count; lane++) {
+          if (pushed[lane] != 0) {
+            Push(csr, seeds[lane], lane, pushed[lane]);
+          }
+        }
+        continue;
+      }
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        pushed[lane] /= degree;
+      }
+      csr.ForEachNeighbor(u, [&](int64_t neighbor, int64_t) {
+        auto slot = GetSlot(neighbor);
+        for (idx_t lane = 0; lane < LANES; lane++) {
+          residual[slot * LANES + lane] += pushed[lane];
+        }
+        Enqueue(csr, neighbor, slot);
+      });
+    }
+
+    for (idx_t slot = 0; slot < touched.size(); slot++) {
+      for (idx_t lane = 0; lane < lane_count; lane++) {
+        if (rank[slot * LANES + lane] > 0) {
+          ranks[lane].push_back({touched[slot], rank[slot * LANES + lane]});
+        }
+      }
+      slots[touched[slot]] = 0;
+    }
+    for (idx_t lane = 0; lane < lane_count; lane++) {
+      std::sort(ranks[lane].begin(), ranks[lane].end(),
+                [](const PersonalizedRank &a, const PersonalizedRank &b) {
+                  return a.vertex < b.vertex;
+                });
+    }
+    touched.clear();
+    rank.clear();
+    residual.clear();
+    queued.clear();
+    queue.clear();
+  }
+
+private:
+  idx_t GetSlot(int64_t vertex) {
+    if (slots[vertex] == 0) {
+      touched.push_back(vertex);
+      slots[vertex] = touched.size();
+      rank.resize(rank.size() + PERSONALIZED_PAGERANK_LANES, 0.0);
+      residual.resize(residual.size() + PERSONALIZED_PAGERANK_LANES, 0.0);
+      queued.push_back(false);
+    }
+    return slots[vertex] - 1;
+  }
+
+  //! Queues the vertex once any of its lanes has a residual to push
+  template <class CSR_VIEW>
+  void Enqueue(const CSR_VIEW &csr, int64_t vertex, idx_t slot) {
+    if (queued[slot]) {
+      return;
+    }
+    auto threshold = tolerance * MaxValue<int64_t>(csr.Degree(vertex), 1);
+    for (idx_t lane = 0; lane < PERSONALIZED_PAGERANK_LANES; lane++) {
+      if (residual[slot * PERSONALIZED_PAGERANK_LANES + lane] >= threshold &&
+          residual[slot * PERSONALIZED_PAGERANK_LANES + lane] > 0) {
+        queued[slot] = true;
+        queue.push_back(vertex);
+        return;
+      }
+    }
+  }
+
+  template <class CSR_VIEW>
+  void Push(const CSR_VIEW &csr, int64_t vertex, idx_t lane, double_t value) {
+    auto slot = GetSlot(vertex);
+    residual[slot * PERSONALIZED_PAGERANK_LANES + lane] += value;
+    Enqueue(csr, vertex, slot);
+  }
+
+  ScratchArray<idx_t> &slots;
+  double_t damping;
+  double_t tolerance;
+  //! The vertex of every slot
+  vector<int64_t> touched;
+  //! Rank and residual of every lane of every slot
+  vector<double_t> rank;
+  vector<double_t> residual;
+  vector<bool> queued;
+  vector<int64_t> queue;
+};
+
+struct PersonalizedPageRankOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, PageRankFunctionData &info,
+                        DataChunk &args, int64_t v_size, Vector &result) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto &result_validity = FlatVector::Validity(result);
+
+    UnifiedVectorFormat vdata_src;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    auto src_data = (int64_t *)vdata_src.data;
+
+    // rows with the same seed share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_src, src_data, false);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // the batches are split over the threads, which keep their slot map
+    // from one batch to the next. The slot maps are left zeroed, so the
+    // next chunks of the query take them from the pool without clearing
+    // them again.
+    auto search_count = searches.sources.size();
+    auto batch_count = (search_count + PERSONALIZED_PAGERANK_LANES - 1) /
+                       PERSONALIZED_PAGERANK_LANES;
+    auto &scratch = *GetDuckPGQState(info.context)->scratch_pool;
+    vector<vector<PersonalizedRank>> ranks(search_count);
+    atomic<idx_t> next_batch{0};
+    auto worker_count =
+        MinValue<idx_t>(GetThreadCount(info.context), batch_count);
+    ParallelFor(info.context, worker_count, [&](idx_t) {
+      ScratchArray<idx_t> slots(scratch, v_size, true);
+      PersonalizedPageRankBatch batch(slots, info.damping_factor,
+                                      info.convergence_threshold);
+      for (auto batch_idx = next_batch++; batch_idx < batch_count;
+           batch_idx = next_batch++) {
+        auto first = batch_idx * PERSONALIZED_PAGERANK_LANES;
+        auto lane_count = MinValue<idx_t>(PERSONALIZED_PAGERANK_LANES,
+                                          search_count - first);
+        batch.Run(csr, searches.sources.data() + first, lane_count,
+                  ranks.data() + first);
+      }
+    });
+
+    for (idx_t search = 0; search < search_count; search++) {
+      for (auto row : searches.rows[search]) {
+        AppendPersonalizedRanks(result, row, ranks[search]);
+      }
+    }
+  }
+};
+
+static void PersonalizedPageRankFunction(DataChunk &args,
+                                         ExpressionState &state,
+                                         Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (PageRankFunctionData &)*func_expr.bind_info;
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  auto csr = duckpgq_state->GetCSR(info.csr_id);
+  if (!(csr->initialized_v && csr->initialized_e)) {
+    throw ConstraintException(
+        "Need to initialize CSR before running personalized PageRank.");
+  }
+  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  TemplatedCSRDispatch<PersonalizedPageRankOperation>(*csr, info, args, v_size,
+                                                      result);
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreScalarFunctions::RegisterPersonalizedPageRankScalarFunction(
+    DatabaseInstance &db) {
+  auto ranks_type = LogicalType::LIST(
+      LogicalType::STRUCT({{"vertex_rowid", LogicalType::BIGINT},
+                           {"pagerank", LogicalType::DOUBLE}}));
+  ScalarFunctionSet set("personalized_pagerank");
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT},
+      ranks_type, PersonalizedPageRankFunction,
+      PageRankFunctionData::PersonalizedPageRankBind));
+  //! With the damping factor and tolerance as the last two arguments
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::DOUBLE, LogicalType::DOUBLE},
+      ranks_type, PersonalizedPageRankFunction,
+      PageRankFunctionData::PersonalizedPageRankBind));
+  ExtensionUtil::RegisterFunction(db, set);
+}
+
+} // namespace core
+
+} // namespace duckpgq
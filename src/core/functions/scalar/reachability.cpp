@@ -6,6 +6,7 @@
 #include <duckpgq_extension.hpp>
 
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
@@ -14,17 +15,18 @@ namespace core {
 
 typedef enum { NO_ARRAY, ARRAY, INTERMEDIATE } msbfs_modes_t;
 
+template <idx_t LANES>
 static int16_t InitialiseBfs(
     idx_t curr_batch, idx_t size, int64_t *src_data,
     const SelectionVector *src_sel, const ValidityMask &src_validity,
-    vector<std::bitset<LANE_LIMIT>> &seen,
-    vector<std::bitset<LANE_LIMIT>> &visit,
-    vector<std::bitset<LANE_LIMIT>> &visit_next,
+    LaneBitsetArray<LANES> &seen, LaneBitsetArray<LANES> &visit,
+    LaneBitsetArray<LANES> &visit_next,
     unordered_map<int64_t, pair<int16_t, vector<int64_t>>> &lane_map) {
   int16_t lanes = 0;
   int16_t curr_batch_size = 0;
 
-  for (idx_t i = curr_batch; i < size && lanes < LANE_LIMIT; i++) {
+  for (idx_t i = curr_batch; i < size && static_cast<idx_t>(lanes) < LANES;
+       i++) {
     auto src_index = src_sel->get_index(i);
 
     if (src_validity.RowIsValid(src_index)) {
@@ -32,8 +34,8 @@ static int16_t InitialiseBfs(
       auto entry = lane_map.find(src_entry);
       if (entry == lane_map.end()) {
         lane_map[src_entry].first = lanes;
-        seen[src_entry][lanes] = true;
-        visit[src_entry][lanes] = true;
+        seen[src_entry].set(lanes);
+        visit[src_entry].set(lanes);
         lanes++;
       }
       lane_map[src_entry].second.push_back(i);
@@ -43,21 +45,21 @@ static int16_t InitialiseBfs(
   return curr_batch_size;
 }
 
-static bool BfsWithoutArrayVariant(bool exit_early, CSR *csr,
+template <idx_t LANES, class CSR_VIEW>
+static bool BfsWithoutArrayVariant(bool exit_early, const CSR_VIEW &csr,
                                    int64_t input_size,
-                                   vector<std::bitset<LANE_LIMIT>> &seen,
-                                   vector<std::bitset<LANE_LIMIT>> &visit,
-                                   vector<std::bitset<LANE_LIMIT>> &visit_next,
+                                   LaneBitsetArray<LANES> &seen,
+                                   LaneBitsetArray<LANES> &visit,
+                                   LaneBitsetArray<LANES> &visit_next,
                                    vector<int64_t> &visit_list) {
   for (int64_t i = 0; i < input_size; i++) {
     if (!visit[i].any()) {
       continue;
     }
 
-    for (auto index = (int64_t)csr->v[i]; index < csr->v[i + 1]; index++) {
-      auto n = csr->e[index];
+    csr.ForEachNeighbor(i, [&](int64_t n, int64_t) {
       visit_next[n] = visit_next[n] | visit[i];
-    }
+    });
   }
 
   for (int64_t i = 0; i < input_size; i++) {
@@ -76,51 +78,43 @@ static bool BfsWithoutArrayVariant(bool exit_early, CSR *csr,
   return exit_early;
 }
 
-static bool BfsWithoutArray(bool exit_early, CSR *csr, int64_t input_size,
-                            vector<std::bitset<LANE_LIMIT>> &seen,
-                            vector<std::bitset<LANE_LIMIT>> &visit,
-                            vector<std::bitset<LANE_LIMIT>> &visit_next) {
-  for (int64_t i = 0; i < input_size; i++) {
-    if (!visit[i].any()) {
-      continue;
-    }
-
-    for (auto index = (int64_t)csr->v[i]; index < (int64_t)csr->v[i + 1];
-         index++) {
-      auto n = csr->e[index];
-      visit_next[n] = visit_next[n] | visit[i];
-    }
-  }
-
-  for (int64_t i = 0; i < input_size; i++) {
-    if (visit_next[i].none()) {
-      continue;
-    }
-    visit_next[i] = visit_next[i] & ~seen[i];
-    seen[i] = seen[i] | visit_next[i];
-    if (exit_early && visit_next[i].any()) {
-      exit_early = false;
-    }
-  }
-  return exit_early;
+template <idx_t LANES, class CSR_VIEW>
+static bool BfsWithoutArray(ClientContext &context, idx_t range_count,
+                            bool exit_early, const CSR_VIEW &csr,
+                            int64_t input_size, LaneBitsetArray<LANES> &seen,
+                            LaneBitsetArray<LANES> &visit,
+                            LaneBitsetArray<LANES> &visit_next) {
+  BfsPushFrontier(context, csr, input_size, range_count, visit,
+                  [&](int64_t i, int64_t n, int64_t) {
+                    visit_next[n] = visit_next[n] | visit[i];
+                  });
+
+  atomic<bool> changed{false};
+  BfsParallelRanges(context, input_size, range_count,
+                    [&](idx_t, int64_t begin, int64_t end) {
+                      if (LaneBitsetMarkSeen(visit_next.data() + begin,
+                                             seen.data() + begin,
+                                             end - begin) > 0) {
+                        changed = true;
+                      }
+                    });
+  return exit_early && !changed;
 }
 
+template <idx_t LANES, class CSR_VIEW>
 static pair<bool, size_t>
-BfsTempStateVariant(bool exit_early, CSR *csr, int64_t input_size,
-                    vector<std::bitset<LANE_LIMIT>> &seen,
-                    vector<std::bitset<LANE_LIMIT>> &visit,
-                    vector<std::bitset<LANE_LIMIT>> &visit_next) {
+BfsTempStateVariant(bool exit_early, const CSR_VIEW &csr, int64_t input_size,
+                    LaneBitsetArray<LANES> &seen, LaneBitsetArray<LANES> &visit,
+                    LaneBitsetArray<LANES> &visit_next) {
   size_t num_nodes_to_visit = 0;
   for (int64_t i = 0; i < input_size; i++) {
     if (!visit[i].any()) {
       continue;
     }
 
-    for (auto index = (int64_t)csr->v[i]; index < (int64_t)csr->v[i + 1];
-         index++) {
-      auto n = csr->e[index];
+    csr.ForEachNeighbor(i, [&](int64_t n, int64_t) {
       visit_next[n] = visit_next[n] | visit[i];
-    }
+    });
   }
 
   for (int64_t i = 0; i < input_size; i++) {
@@ -139,19 +133,18 @@ BfsTempStateVariant(bool exit_early, CSR *csr, int64_t input_size,
   return pair<bool, size_t>(exit_early, num_nodes_to_visit);
 }
 
-static bool BfsWithArrayVariant(bool exit_early, CSR *csr,
-                                vector<std::bitset<LANE_LIMIT>> &seen,
-                                vector<std::bitset<LANE_LIMIT>> &visit,
-                                vector<std::bitset<LANE_LIMIT>> &visit_next,
+template <idx_t LANES, class CSR_VIEW>
+static bool BfsWithArrayVariant(bool exit_early, const CSR_VIEW &csr,
+                                LaneBitsetArray<LANES> &seen,
+                                LaneBitsetArray<LANES> &visit,
+                                LaneBitsetArray<LANES> &visit_next,
                                 vector<int64_t> &visit_list) {
   unordered_set<int64_t> neighbours_set;
   for (int64_t i : visit_list) {
-    for (auto index = (int64_t)csr->v[i]; index < (int64_t)csr->v[i + 1];
-         index++) {
-      auto n = csr->e[index];
+    csr.ForEachNeighbor(i, [&](int64_t n, int64_t) {
       visit_next[n] = visit_next[n] | visit[i];
       neighbours_set.insert(n);
-    }
+    });
   }
   visit_list.clear();
   for (int64_t i : neighbours_set) {
@@ -179,40 +172,34 @@ static int FindMode(int mode, size_t visit_list_len, size_t visit_limit,
   return mode;
 }
 
-static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
-                                 Vector &result) {
-  auto &func_expr = (BoundFunctionExpression &)state.expr;
-  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
-
-  bool is_variant = args.data[1].GetValue(0).GetValue<bool>();
-  int64_t input_size = args.data[2].GetValue(0).GetValue<int64_t>();
-
-  auto &src = args.data[3];
+//! Runs the searches of the next rows, from as many distinct sources as fit
+//! in LANES lanes
+struct ReachabilityBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, bool is_variant, int64_t input_size,
+                        Vector &result, idx_t range_count,
+                        ScratchPool &scratch, idx_t &result_size) {
+    auto &src = args.data[3];
 
-  UnifiedVectorFormat vdata_src, vdata_target;
-  src.ToUnifiedFormat(args.size(), vdata_src);
+    UnifiedVectorFormat vdata_src, vdata_target;
+    src.ToUnifiedFormat(args.size(), vdata_src);
 
-  auto src_data = (int64_t *)vdata_src.data;
+    auto src_data = (int64_t *)vdata_src.data;
 
-  auto &target = args.data[4];
-  target.ToUnifiedFormat(args.size(), vdata_target);
-  auto target_data = (int64_t *)vdata_target.data;
+    auto &target = args.data[4];
+    target.ToUnifiedFormat(args.size(), vdata_target);
+    auto target_data = (int64_t *)vdata_target.data;
 
-  idx_t result_size = 0;
-  vector<int64_t> visit_list;
-  size_t visit_limit = input_size / VISIT_SIZE_DIVISOR;
-  size_t num_nodes_to_visit = 0;
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-
-  auto result_data = FlatVector::GetData<bool>(result);
-  auto duckpgq_state = GetDuckPGQState(info.context);
+    vector<int64_t> visit_list;
+    size_t visit_limit = input_size / VISIT_SIZE_DIVISOR;
+    size_t num_nodes_to_visit = 0;
 
-  CSR *csr = duckpgq_state->GetCSR(info.csr_id);
+    auto result_data = FlatVector::GetData<bool>(result);
 
-  while (result_size < args.size()) {
-    vector<std::bitset<LANE_LIMIT>> seen(input_size);
-    vector<std::bitset<LANE_LIMIT>> visit(input_size);
-    vector<std::bitset<LANE_LIMIT>> visit_next(input_size);
+    LaneBitsetArray<LANES> seen(scratch, input_size);
+    LaneBitsetArray<LANES> visit(scratch, input_size);
+    LaneBitsetArray<LANES> visit_next(scratch, input_size);
 
     //! mapping of src_value ->  (bfs_num/lane, vector of indices in src_data)
     unordered_map<int64_t, pair<int16_t, vector<int64_t>>> lane_map;
@@ -224,16 +211,17 @@ static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
     while (!exit_early) {
       exit_early = true;
       if (is_variant) {
-        mode =
-            FindMode(mode, visit_list.size(), visit_limit, num_nodes_to_visit);
+        mode = FindMode(mode, visit_list.size(), visit_limit,
+                        num_nodes_to_visit);
         switch (mode) {
         case 1:
           exit_early = BfsWithArrayVariant(exit_early, csr, seen, visit,
                                            visit_next, visit_list);
           break;
         case 0:
-          exit_early = BfsWithoutArrayVariant(exit_early, csr, input_size, seen,
-                                              visit, visit_next, visit_list);
+          exit_early =
+              BfsWithoutArrayVariant(exit_early, csr, input_size, seen, visit,
+                                     visit_next, visit_list);
           break;
         case 2: {
           auto return_pair = BfsTempStateVariant(exit_early, csr, input_size,
@@ -247,14 +235,17 @@ static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
                           "Unknown reachability mode encountered");
         }
       } else {
-        exit_early = BfsWithoutArray(exit_early, csr, input_size, seen, visit,
-                                     visit_next);
+        exit_early = BfsWithoutArray(context, range_count, exit_early, csr,
+                                     input_size, seen, visit, visit_next);
       }
 
-      visit = visit_next;
-      for (auto i = 0; i < input_size; i++) {
-        visit_next[i] = 0;
-      }
+      BfsParallelRanges(context, input_size, range_count,
+                        [&](idx_t, int64_t begin, int64_t end) {
+                          for (auto i = begin; i < end; i++) {
+                            visit[i] = visit_next[i];
+                            visit_next[i].reset();
+                          }
+                        });
     }
 
     for (const auto &iter : lane_map) {
@@ -263,7 +254,8 @@ static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
       auto pos = iter.second.second;
       for (auto index : pos) {
         auto target_index = vdata_target.sel->get_index(index);
-        if (seen[target_data[target_index]][bfs_num] && seen[value][bfs_num]) {
+        if (seen[target_data[target_index]].test(bfs_num) &&
+            seen[value].test(bfs_num)) {
           // if(is_bit_set(seen[target_data[index]], bfs_num) &
           // is_bit_set(seen[value], bfs_num) ) {
           result_data[index] = true;
@@ -274,6 +266,42 @@ static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
     }
     result_size = result_size + curr_batch_size;
   }
+};
+
+struct ReachabilityOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, bool is_variant, int64_t input_size,
+                        Vector &result) {
+    // the steps of the search are split over the threads by vertex ranges,
+    // the variants with a visit list run on a single thread
+    auto range_count = is_variant ? 1 : BfsRangeCount(context, input_size);
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+
+    // every batch takes the narrowest lanes that hold the remaining rows
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    idx_t result_size = 0;
+    while (result_size < args.size()) {
+      LaneWidthDispatch<ReachabilityBatch>(args.size() - result_size, csr,
+                                           context, args, is_variant,
+                                           input_size, result, range_count,
+                                           scratch, result_size);
+    }
+  }
+};
+
+static void ReachabilityFunction(DataChunk &args, ExpressionState &state,
+                                 Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
+
+  bool is_variant = args.data[1].GetValue(0).GetValue<bool>();
+  int64_t input_size = args.data[2].GetValue(0).GetValue<int64_t>();
+  auto duckpgq_state = GetDuckPGQState(info.context);
+  CSR *csr = duckpgq_state->GetCSR(info.csr_id);
+
+  TemplatedCSRDispatch<ReachabilityOperation>(*csr, info.context, args,
+                                              is_variant, input_size, result);
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
 
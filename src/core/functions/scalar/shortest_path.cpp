@@ -6,48 +6,181 @@
 #include "duckpgq/core/functions/function_data/iterative_length_function_data.hpp"
 
 #include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 
 namespace core {
 
-static bool IterativeLength(int64_t v_size, int64_t *V, vector<int64_t> &E,
-                            vector<int64_t> &edge_ids,
-                            vector<std::vector<int64_t>> &parents_v,
-                            vector<std::vector<int64_t>> &parents_e,
-                            vector<std::bitset<LANE_LIMIT>> &seen,
-                            vector<std::bitset<LANE_LIMIT>> &visit,
-                            vector<std::bitset<LANE_LIMIT>> &next) {
-  bool change = false;
-  for (auto v = 0; v < v_size; v++) {
-    next[v] = 0;
-  }
-  //! Keep track of edge id through which the node was reached
-  for (auto v = 0; v < v_size; v++) {
-    if (visit[v].any()) {
-      for (auto e = V[v]; e < V[v + 1]; e++) {
-        auto n = E[e];
-        auto edge_id = edge_ids[e];
-        next[n] = next[n] | visit[v];
-        for (auto l = 0; l < LANE_LIMIT; l++) {
-          parents_v[n][l] =
-              ((parents_v[n][l] == -1) && visit[v][l]) ? v : parents_v[n][l];
-          parents_e[n][l] = ((parents_e[n][l] == -1) && visit[v][l])
-                                ? edge_id
-                                : parents_e[n][l];
+//! Runs the next searches, as many as fit in LANES lanes, and appends the
+//! paths of their rows to result. Every search runs from a distinct source for
+//! all rows with that source. Instead of the parent of every vertex per lane,
+//! the search keeps the vertices every level reached, and the paths are
+//! rebuilt from them afterwards. The searches stop after upper steps, and
+//! report destinations reached in fewer than lower steps as not found.
+struct ShortestPathBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        int64_t v_size, Vector &result, idx_t range_count,
+                        BfsFrontier &frontier, const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_dst,
+                        const int64_t *dst_data, int64_t lower, int64_t upper,
+                        ScratchPool &scratch, int64_t &total_len,
+                        idx_t &started_searches) {
+    auto result_data = FlatVector::GetData<list_entry_t>(result);
+    ValidityMask &result_validity = FlatVector::Validity(result);
+
+    // Appends a path to the list of a row
+    auto append_path = [&](idx_t row, const vector<int64_t> &path) {
+      auto output = make_uniq<Vector>(LogicalType::LIST(LogicalType::BIGINT));
+      for (auto val : path) {
+        Value value_to_insert = val;
+        ListVector::PushBack(*output, value_to_insert);
+      }
+      result_data[row].length = ListVector::GetListSize(*output);
+      result_data[row].offset = total_len;
+      ListVector::Append(result, ListVector::GetEntry(*output),
+                         ListVector::GetListSize(*output));
+      total_len += result_data[row].length;
+    };
+
+    // create temp SIMD arrays
+    LaneBitsetArray<LANES> seen(scratch, v_size);
+    LaneBitsetArray<LANES> visit1(scratch, v_size);
+    LaneBitsetArray<LANES> visit2(scratch, v_size);
+
+    // maps lane to search, and to the rows of the search whose destination
+    // was not reached yet
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    AssignPathSearchLanes<LANES>(
+        searches, vdata_dst, dst_data, started_searches, lane_search,
+        lane_rows, [&](idx_t row) {
+          // the path of length 0 does not require a search
+          if (lower > 0) {
+            result_validity.SetInvalid(row);
+          } else {
+            append_path(row, {dst_data[vdata_dst.sel->get_index(row)]});
+          }
+          return true;
+        });
+
+    // add search jobs to free lanes
+    uint64_t active = 0;
+    vector<int64_t> sources;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_search[lane] < 0) {
+        continue;
+      }
+      auto source = searches.sources[lane_search[lane]];
+      visit1[source].set(lane);
+      seen[source].set(lane);
+      sources.push_back(source);
+      active++;
+    }
+
+    frontier.Start(std::move(sources));
+    vector<BfsLevel<LANES>> levels;
+    BfsAddLevel(context, v_size, range_count, frontier, visit1, levels);
+
+    //! make passes while a lane is still active
+    vector<BfsPathEnd> ends;
+    vector<idx_t> end_rows;
+    for (int64_t iter = 1; active && iter <= upper; iter++) {
+      auto &next = (iter & 1) ? visit2 : visit1;
+      //! Perform one step of bfs exploration
+      if (!BfsTopDownStep(context, v_size, range_count, csr, seen,
+                          (iter & 1) ? visit1 : visit2, next, frontier)) {
+        break;
+      }
+      BfsAddLevel(context, v_size, range_count, frontier, next, levels);
+      // detect rows whose destination was reached, and lanes that finished
+      for (idx_t lane = 0; lane < LANES; lane++) {
+        auto &rows = lane_rows[lane];
+        if (rows.empty()) {
+          continue;
+        }
+        idx_t kept = 0;
+        for (auto row : rows) {
+          auto dst = dst_data[vdata_dst.sel->get_index(row)];
+          if (!next[dst].test(lane)) {
+            rows[kept++] = row;
+          } else if (iter < lower) {
+            result_validity.SetInvalid(row);
+          } else {
+            ends.push_back({lane, dst, iter});
+            end_rows.push_back(row);
+          }
+        }
+        rows.resize(kept);
+        if (rows.empty()) {
+          active--;
         }
       }
     }
+
+    // any rows left have no path
+    for (auto &rows : lane_rows) {
+      for (auto row : rows) {
+        result_validity.SetInvalid(row);
+      }
+    }
+
+    //! Reconstruct the paths
+    vector<vector<int64_t>> paths(ends.size());
+    auto &wanted = visit1;
+    for (auto &lanes : wanted) {
+      lanes.reset();
+    }
+    BfsReconstructPaths(csr, levels, ends, wanted, paths);
+    for (idx_t i = 0; i < ends.size(); i++) {
+      std::reverse(paths[i].begin(), paths[i].end());
+      append_path(end_rows[i], paths[i]);
+    }
   }
+};
+
+struct ShortestPathOperation {
+  //! lower and upper bound the hops of a path, see
+  //! IterativeLengthFunctionData.
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result,
+                        int64_t lower, int64_t upper) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    ValidityMask &result_validity = FlatVector::Validity(result);
+
+    UnifiedVectorFormat vdata_src, vdata_dst;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto dst_data = (int64_t *)vdata_dst.data;
+
+    // rows with the same source share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_dst, dst_data, false);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
 
-  for (auto v = 0; v < v_size; v++) {
-    next[v] = next[v] & ~seen[v];
-    seen[v] = seen[v] | next[v];
-    change |= next[v].any();
+    // the steps of the search are split over the threads by vertex ranges
+    auto range_count = BfsRangeCount(context, v_size);
+    BfsFrontier frontier(context, v_size, range_count);
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    int64_t total_len = 0;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<ShortestPathBatch>(
+          searches.sources.size() - started_searches, csr, context, v_size,
+          result, range_count, frontier, searches, vdata_dst, dst_data, lower,
+          upper, scratch, total_len, started_searches);
+    }
   }
-  return change;
-}
+};
 
 static void ShortestPathFunction(DataChunk &args, ExpressionState &state,
                                  Vector &result) {
@@ -67,167 +200,9 @@ static void ShortestPathFunction(DataChunk &args, ExpressionState &state,
         "Need to initialize CSR before doing shortest path");
   }
   int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
-
-  auto *v = (int64_t *)csr->v;
-  vector<int64_t> &e = csr->e;
-  vector<int64_t> &edge_ids = csr->edge_ids;
-
-  auto &src = args.data[2];
-  auto &target = args.data[3];
-
-  UnifiedVectorFormat vdata_src, vdata_dst;
-  src.ToUnifiedFormat(args.size(), vdata_src);
-  target.ToUnifiedFormat(args.size(), vdata_dst);
-
-  auto src_data = (int64_t *)vdata_src.data;
-  auto dst_data = (int64_t *)vdata_dst.data;
-
-  result.SetVectorType(VectorType::FLAT_VECTOR);
-  auto result_data = FlatVector::GetData<list_entry_t>(result);
-  ValidityMask &result_validity = FlatVector::Validity(result);
-
-  // create temp SIMD arrays
-  vector<std::bitset<LANE_LIMIT>> seen(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit1(v_size);
-  vector<std::bitset<LANE_LIMIT>> visit2(v_size);
-  vector<std::vector<int64_t>> parents_v(v_size,
-                                         std::vector<int64_t>(LANE_LIMIT, -1));
-  vector<std::vector<int64_t>> parents_e(v_size,
-                                         std::vector<int64_t>(LANE_LIMIT, -1));
-
-  // maps lane to search number
-  int16_t lane_to_num[LANE_LIMIT];
-  for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-    lane_to_num[lane] = -1; // inactive
-  }
-  int64_t total_len = 0;
-
-  idx_t started_searches = 0;
-  while (started_searches < args.size()) {
-
-    // empty visit vectors
-    for (auto i = 0; i < v_size; i++) {
-      seen[i] = 0;
-      visit1[i] = 0;
-      for (auto j = 0; j < LANE_LIMIT; j++) {
-        parents_v[i][j] = -1;
-        parents_e[i][j] = -1;
-      }
-    }
-
-    // add search jobs to free lanes
-    uint64_t active = 0;
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      lane_to_num[lane] = -1;
-      while (started_searches < args.size()) {
-        int64_t search_num = started_searches++;
-        int64_t src_pos = vdata_src.sel->get_index(search_num);
-        if (!vdata_src.validity.RowIsValid(src_pos)) {
-          result_validity.SetInvalid(search_num);
-        } else {
-          visit1[src_data[src_pos]][lane] = true;
-          parents_v[src_data[src_pos]][lane] =
-              src_data[src_pos]; // Mark source with source id
-          parents_e[src_data[src_pos]][lane] =
-              -2; // Mark the source with -2, there is no incoming edge for the
-                  // source.
-          lane_to_num[lane] = search_num; // active lane
-          active++;
-          break;
-        }
-      }
-    }
-
-    //! make passes while a lane is still active
-    for (int64_t iter = 1; active; iter++) {
-      //! Perform one step of bfs exploration
-      if (!IterativeLength(v_size, v, e, edge_ids, parents_v, parents_e, seen,
-                           (iter & 1) ? visit1 : visit2,
-                           (iter & 1) ? visit2 : visit1)) {
-        break;
-      }
-      int64_t finished_searches = 0;
-      // detect lanes that finished
-      for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-        int64_t search_num = lane_to_num[lane];
-        if (search_num >= 0) { // active lane
-          //! Check if dst for a source has been seen
-          int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-          if (seen[dst_data[dst_pos]][lane]) {
-            finished_searches++;
-          }
-        }
-      }
-      if (finished_searches == LANE_LIMIT) {
-        break;
-      }
-    }
-    //! Reconstruct the paths
-    for (int64_t lane = 0; lane < LANE_LIMIT; lane++) {
-      int64_t search_num = lane_to_num[lane];
-      if (search_num == -1) { // empty lanes
-        continue;
-      }
-
-      //! Searches that have stopped have found a path
-      int64_t src_pos = vdata_src.sel->get_index(search_num);
-      int64_t dst_pos = vdata_dst.sel->get_index(search_num);
-      if (src_data[src_pos] == dst_data[dst_pos]) { // Source == destination
-        unique_ptr<Vector> output =
-            make_uniq<Vector>(LogicalType::LIST(LogicalType::BIGINT));
-        ListVector::PushBack(*output, src_data[src_pos]);
-        ListVector::Append(result, ListVector::GetEntry(*output),
-                           ListVector::GetListSize(*output));
-        result_data[search_num].length = ListVector::GetListSize(*output);
-        result_data[search_num].offset = total_len;
-        total_len += result_data[search_num].length;
-        continue;
-      }
-      std::vector<int64_t> output_vector;
-      std::vector<int64_t> output_edge;
-      auto source_v = src_data[src_pos]; // Take the source
-
-      auto parent_vertex =
-          parents_v[dst_data[dst_pos]]
-                   [lane]; // Take the parent vertex of the destination vertex
-      auto parent_edge =
-          parents_e[dst_data[dst_pos]]
-                   [lane]; // Take the parent edge of the destination vertex
-
-      output_vector.push_back(dst_data[dst_pos]); // Add destination vertex
-      output_vector.push_back(parent_edge);
-      while (parent_vertex != source_v) { // Continue adding vertices until we
-                                          // have reached the source vertex
-        //! -1 is used to signify no parent
-        if (parent_vertex == -1 ||
-            parent_vertex == parents_v[parent_vertex][lane]) {
-          result_validity.SetInvalid(search_num);
-          break;
-        }
-        output_vector.push_back(parent_vertex);
-        parent_edge = parents_e[parent_vertex][lane];
-        parent_vertex = parents_v[parent_vertex][lane];
-        output_vector.push_back(parent_edge);
-      }
-
-      if (!result_validity.RowIsValid(search_num)) {
-        continue;
-      }
-      output_vector.push_back(source_v);
-      std::reverse(output_vector.begin(), output_vector.end());
-      auto output = make_uniq<Vector>(LogicalType::LIST(LogicalType::BIGINT));
-      for (auto val : output_vector) {
-        Value value_to_insert = val;
-        ListVector::PushBack(*output, value_to_insert);
-      }
-
-      result_data[search_num].length = ListVector::GetListSize(*output);
-      result_data[search_num].offset = total_len;
-      ListVector::Append(result, ListVector::GetEntry(*output),
-                         ListVector::GetListSize(*output));
-      total_len += result_data[search_num].length;
-    }
-  }
+  TemplatedCSRDispatch<ShortestPathOperation>(
+      info.reverse ? csr->GetReverse() : *csr, info.context, args, v_size,
+      result, info.lower, info.upper);
   duckpgq_state->csr_to_delete.insert(info.csr_id);
 }
 
@@ -236,13 +211,31 @@ static void ShortestPathFunction(DataChunk &args, ExpressionState &state,
 //------------------------------------------------------------------------------
 void CoreScalarFunctions::RegisterShortestPathScalarFunction(
     DatabaseInstance &db) {
-  ExtensionUtil::RegisterFunction(
-      db, ScalarFunction("shortestpath",
-                         {LogicalType::INTEGER, LogicalType::BIGINT,
-                          LogicalType::BIGINT, LogicalType::BIGINT},
-                         LogicalType::LIST(LogicalType::BIGINT),
-                         ShortestPathFunction,
-                         IterativeLengthFunctionData::IterativeLengthBind));
+  ScalarFunctionSet set("shortestpath");
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! Following the incoming edges if the last argument is true
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! With the fewest and most hops of the path as the last two arguments
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  ExtensionUtil::RegisterFunction(db, set);
 }
 
 } // namespace core
@@ -0,0 +1,313 @@
+#include "duckdb/main/client_data.hpp"
+#include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/functions/function_data/iterative_length_function_data.hpp"
+
+#include <duckpgq/core/functions/scalar.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
+#include <duckpgq/core/utils/duckpgq_path_searches.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+//! Runs the next searches, as many as fit in LANES lanes, from the source
+//! along the outgoing edges and from the destination along the incoming
+//! edges. Every search serves all rows with its source and destination. Every
+//! step expands the side with the smaller frontier. Both sides keep the
+//! vertices every level reached, and once the sides of a lane meet, its path
+//! is rebuilt from both halves and joined at the meeting vertex. The searches
+//! stop once the levels of both sides add up to upper, and report paths
+//! shorter than lower as not found.
+struct ShortestPathBidirectionalBatch {
+  template <idx_t LANES, class CSR_VIEW>
+  static void Operation(const CSR_VIEW &out_csr, const CSR_VIEW &in_csr,
+                        ClientContext &context, int64_t v_size,
+                        Vector &result, idx_t range_count,
+                        BfsFrontier &src_frontier, BfsFrontier &dst_frontier,
+                        const PathSearches &searches,
+                        const UnifiedVectorFormat &vdata_dst,
+                        const int64_t *dst_data, int64_t lower, int64_t upper,
+                        ScratchPool &scratch, int64_t &total_len,
+                        idx_t &started_searches) {
+    auto result_data = FlatVector::GetData<list_entry_t>(result);
+    ValidityMask &result_validity = FlatVector::Validity(result);
+
+    // Appends a path to the list of a row
+    auto append_path = [&](idx_t row, const vector<int64_t> &path) {
+      auto output = make_uniq<Vector>(LogicalType::LIST(LogicalType::BIGINT));
+      for (auto val : path) {
+        Value value_to_insert = val;
+        ListVector::PushBack(*output, value_to_insert);
+      }
+      result_data[row].length = ListVector::GetListSize(*output);
+      result_data[row].offset = total_len;
+      ListVector::Append(result, ListVector::GetEntry(*output),
+                         ListVector::GetListSize(*output));
+      total_len += result_data[row].length;
+    };
+
+    // create temp SIMD arrays for both sides
+    LaneBitsetArray<LANES> src_seen(scratch, v_size);
+    LaneBitsetArray<LANES> src_visit1(scratch, v_size);
+    LaneBitsetArray<LANES> src_visit2(scratch, v_size);
+    LaneBitsetArray<LANES> dst_seen(scratch, v_size);
+    LaneBitsetArray<LANES> dst_visit1(scratch, v_size);
+    LaneBitsetArray<LANES> dst_visit2(scratch, v_size);
+
+    // maps lane to search and its rows, and to the vertex where both sides
+    // met and the level each side reached it at
+    int64_t lane_search[LANES];
+    vector<vector<idx_t>> lane_rows(LANES);
+    int64_t lane_meet[LANES];
+    int64_t lane_src_level[LANES];
+    int64_t lane_dst_level[LANES];
+    AssignPathSearchLanes<LANES>(
+        searches, vdata_dst, dst_data, started_searches, lane_search,
+        lane_rows, [&](idx_t row) {
+          // the path of length 0 does not require a search
+          if (lower > 0) {
+            result_validity.SetInvalid(row);
+          } else {
+            append_path(row, {dst_data[vdata_dst.sel->get_index(row)]});
+          }
+          return true;
+        });
+
+    // add search jobs to free lanes
+    LaneBitset<LANES> pending;
+    vector<int64_t> sources, destinations;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      lane_src_level[lane] = -1;
+      lane_dst_level[lane] = -1;
+      if (lane_search[lane] < 0) {
+        continue;
+      }
+      auto source = searches.sources[lane_search[lane]];
+      auto destination = searches.destinations[lane_search[lane]];
+      src_visit1[source].set(lane);
+      src_seen[source].set(lane);
+      dst_visit1[destination].set(lane);
+      dst_seen[destination].set(lane);
+      sources.push_back(source);
+      destinations.push_back(destination);
+      pending.set(lane);
+    }
+
+    src_frontier.Start(std::move(sources));
+    dst_frontier.Start(std::move(destinations));
+    vector<BfsLevel<LANES>> src_levels, dst_levels;
+    BfsAddLevel(context, v_size, range_count, src_frontier, src_visit1,
+                src_levels);
+    BfsAddLevel(context, v_size, range_count, dst_frontier, dst_visit1,
+                dst_levels);
+
+    //! make passes while a lane has not met the other side, and the paths
+    //! found in the next step would not be longer than upper
+    while (pending.any() &&
+           static_cast<int64_t>(src_levels.size() + dst_levels.size()) - 2 <
+               upper) {
+      bool forward = src_levels.back().vertices.size() <=
+                     dst_levels.back().vertices.size();
+      auto &levels = forward ? src_levels : dst_levels;
+      auto &other_levels = forward ? dst_levels : src_levels;
+      auto &seen = forward ? src_seen : dst_seen;
+      auto &other_seen = forward ? dst_seen : src_seen;
+      auto &visit1 = forward ? src_visit1 : dst_visit1;
+      auto &visit2 = forward ? src_visit2 : dst_visit2;
+      auto &frontier = forward ? src_frontier : dst_frontier;
+      int64_t level = levels.size();
+      auto &next = (level & 1) ? visit2 : visit1;
+      //! Perform one step of bfs exploration on one side. Once a side reaches
+      //! no new vertex, it saw all it can reach, and the lanes that have not
+      //! met the other side yet have no path.
+      if (!BfsTopDownStep(context, v_size, range_count,
+                          forward ? out_csr : in_csr, seen,
+                          (level & 1) ? visit1 : visit2, next, frontier)) {
+        break;
+      }
+      BfsAddLevel(context, v_size, range_count, frontier, next, levels);
+      // Detect lanes whose sides met. No shorter path was missed, since the
+      // sides did not meet before this step, so the other side reached a
+      // meeting vertex at its last level.
+      int64_t other_level = other_levels.size() - 1;
+      for (auto v : levels.back().vertices) {
+        auto met = next[v] & other_seen[v] & pending;
+        if (met.none()) {
+          continue;
+        }
+        pending = pending & ~met;
+        for (idx_t lane = 0; lane < LANES; lane++) {
+          if (met.test(lane)) {
+            lane_meet[lane] = v;
+            lane_src_level[lane] = forward ? level : other_level;
+            lane_dst_level[lane] = forward ? other_level : level;
+          }
+        }
+      }
+    }
+
+    //! Reconstruct both halves of the paths, from the meeting vertex back to
+    //! the source and on to the destination
+    vector<BfsPathEnd> src_ends, dst_ends;
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (lane_src_level[lane] >= 0) {
+        src_ends.push_back({lane, lane_meet[lane], lane_src_level[lane]});
+        dst_ends.push_back({lane, lane_meet[lane], lane_dst_level[lane]});
+      }
+    }
+    vector<vector<int64_t>> src_paths(src_ends.size());
+    vector<vector<int64_t>> dst_paths(dst_ends.size());
+    auto &src_wanted = src_visit1;
+    for (auto &lanes : src_wanted) {
+      lanes.reset();
+    }
+    BfsReconstructPaths(out_csr, src_levels, src_ends, src_wanted, src_paths);
+    auto &dst_wanted = dst_visit1;
+    for (auto &lanes : dst_wanted) {
+      lanes.reset();
+    }
+    BfsReconstructPaths(in_csr, dst_levels, dst_ends, dst_wanted, dst_paths);
+    for (idx_t i = 0; i < src_ends.size(); i++) {
+      auto lane = src_ends[i].lane;
+      // the sides met on a path shorter than lower
+      if (lane_src_level[lane] + lane_dst_level[lane] < lower) {
+        continue;
+      }
+      // A side met at its start vertex has no half of its own
+      auto &path = src_paths[i];
+      if (path.empty()) {
+        path.push_back(lane_meet[lane]);
+      }
+      std::reverse(path.begin(), path.end());
+      if (!dst_paths[i].empty()) {
+        path.insert(path.end(), dst_paths[i].begin() + 1, dst_paths[i].end());
+      }
+      for (auto row : lane_rows[lane]) {
+        append_path(row, path);
+      }
+      lane_rows[lane].clear();
+    }
+    // the sides of the searches left did not meet, or met on a path shorter
+    // than lower
+    for (auto &rows : lane_rows) {
+      for (auto row : rows) {
+        result_validity.SetInvalid(row);
+      }
+    }
+  }
+};
+
+struct ShortestPathBidirectionalOperation {
+  //! incoming holds the incoming edges of csr, in the same layout. lower and
+  //! upper bound the hops of a path, see IterativeLengthFunctionData.
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        DataChunk &args, int64_t v_size, Vector &result,
+                        const CSR &incoming, int64_t lower, int64_t upper) {
+    result.SetVectorType(VectorType::FLAT_VECTOR);
+    auto in_csr = incoming.GetViewAs<CSR_VIEW>();
+
+    UnifiedVectorFormat vdata_src, vdata_dst;
+    args.data[2].ToUnifiedFormat(args.size(), vdata_src);
+    args.data[3].ToUnifiedFormat(args.size(), vdata_dst);
+    auto src_data = (int64_t *)vdata_src.data;
+    auto dst_data = (int64_t *)vdata_dst.data;
+
+    // rows with the same source and destination share a lane
+    auto searches = GroupPathSearches(args.size(), vdata_src, src_data,
+                                      vdata_dst, dst_data, true);
+    ValidityMask &result_validity = FlatVector::Validity(result);
+    for (auto row : searches.null_rows) {
+      result_validity.SetInvalid(row);
+    }
+
+    // the steps of both sides are split over the threads by vertex ranges
+    auto range_count = BfsRangeCount(context, v_size);
+    BfsFrontier src_frontier(context, v_size, range_count);
+    BfsFrontier dst_frontier(context, v_size, range_count);
+
+    // every batch takes the narrowest lanes that hold the remaining searches
+    auto &scratch = *GetDuckPGQState(context)->scratch_pool;
+    int64_t total_len = 0;
+    idx_t started_searches = 0;
+    while (started_searches < searches.sources.size()) {
+      LaneWidthDispatch<ShortestPathBidirectionalBatch>(
+          searches.sources.size() - started_searches, csr, in_csr, context,
+          v_size, result, range_count, src_frontier, dst_frontier, searches,
+          vdata_dst, dst_data, lower, upper, scratch, total_len,
+          started_searches);
+    }
+  }
+};
+
+static void ShortestPathBidirectionalFunction(DataChunk &args,
+                                              ExpressionState &state,
+                                              Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (IterativeLengthFunctionData &)*func_expr.bind_info;
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  D_ASSERT(duckpgq_state->csr_list[info.csr_id]);
+  auto csr_entry = duckpgq_state->csr_list.find(info.csr_id);
+  if (csr_entry == duckpgq_state->csr_list.end()) {
+    throw ConstraintException("Invalid ID");
+  }
+  auto &forward = *csr_entry->second;
+
+  if (!forward.initialized_v) {
+    throw ConstraintException(
+        "Need to initialize CSR before doing shortest path");
+  }
+  int64_t v_size = args.data[1].GetValue(0).GetValue<int64_t>();
+  // The search from the destination follows the incoming edges of the
+  // traversed CSR, so both directions must have been built
+  auto &csr = info.reverse ? forward.GetReverse() : forward;
+  auto &incoming = info.reverse ? forward : forward.GetReverse();
+  if (!incoming.SameLayout(csr)) {
+    throw ConstraintException(
+        "The reverse CSR has a different layout than the CSR");
+  }
+  TemplatedCSRDispatch<ShortestPathBidirectionalOperation>(
+      csr, info.context, args, v_size, result, incoming, info.lower,
+      info.upper);
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreScalarFunctions::RegisterShortestPathBidirectionalScalarFunction(
+    DatabaseInstance &db) {
+  ScalarFunctionSet set("shortestpathbidirectional");
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathBidirectionalFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! Following the incoming edges if the last argument is true
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathBidirectionalFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  //! With the fewest and most hops of the path as the last two arguments
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathBidirectionalFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  set.AddFunction(ScalarFunction(
+      {LogicalType::INTEGER, LogicalType::BIGINT, LogicalType::BIGINT,
+       LogicalType::BIGINT, LogicalType::BOOLEAN, LogicalType::BIGINT,
+       LogicalType::BIGINT},
+      LogicalType::LIST(LogicalType::BIGINT), ShortestPathBidirectionalFunction,
+      IterativeLengthFunctionData::IterativeLengthBind));
+  ExtensionUtil::RegisterFunction(db, set);
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -0,0 +1,122 @@
+#include "duckdb/planner/expression/bound_function_expression.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/functions/function_data/triangle_count_function_data.hpp"
+#include "duckpgq/core/utils/duckpgq_bfs.hpp"
+#include "duckpgq/core/utils/duckpgq_sorted_adjacency.hpp"
+#include "duckpgq/core/utils/duckpgq_utils.hpp"
+
+#include <duckpgq/core/functions/scalar.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+//! Counts the triangles of every vertex of an undirected CSR. With every edge
+//! kept once, towards the endpoint of higher degree, every triangle is found
+//! exactly once: from its vertex of lowest degree u, as a vertex x in the
+//! lists of both u and its neighbor w. The lists of high degree vertices are
+//! never walked, and the vertices are split into ranges that the threads
+//! process in parallel.
+static void CountTriangles(TriangleCountFunctionData &info, const CSR &csr) {
+  auto &context = info.context;
+  auto &adjacency = info.adjacency;
+  adjacency.Build(context, csr, info.computation, true);
+  auto vertex_count = static_cast<int64_t>(adjacency.VertexCount());
+  info.triangles = make_unsafe_uniq_array<std::atomic<int64_t>>(vertex_count);
+  auto triangles = info.triangles.get();
+
+  auto range_count = BfsRangeCount(context, vertex_count);
+  auto range_size = BfsRangeSize(vertex_count, range_count);
+  info.computation.ParallelFor(context, range_count, [&](idx_t range_idx) {
+    auto begin = MinValue<int64_t>(static_cast<int64_t>(range_idx) * range_size,
+                                   vertex_count);
+    auto end = MinValue<int64_t>(begin + range_size, vertex_count);
+    for (auto v = begin; v < end; v++) {
+      triangles[v].store(0, std::memory_order_relaxed);
+    }
+  });
+  info.computation.ParallelFor(context, range_count, [&](idx_t range_idx) {
+    auto begin = MinValue<int64_t>(static_cast<int64_t>(range_idx) * range_size,
+                                   vertex_count);
+    auto end = MinValue<int64_t>(begin + range_size, vertex_count);
+    for (auto u = begin; u < end; u++) {
+      int64_t u_triangles = 0;
+      for (auto w = adjacency.Begin(u); w < adjacency.End(u); w++) {
+        int64_t w_triangles = 0;
+        ForEachCommon(adjacency.Begin(u), adjacency.End(u),
+                      adjacency.Begin(*w), adjacency.End(*w),
+                      [&](int64_t x) {
+                        w_triangles++;
+                        triangles[x].fetch_add(1, std::memory_order_relaxed);
+                      });
+        if (w_triangles > 0) {
+          u_triangles += w_triangles;
+          triangles[*w].fetch_add(w_triangles, std::memory_order_relaxed);
+        }
+      }
+      if (u_triangles > 0) {
+        triangles[u].fetch_add(u_triangles, std::memory_order_relaxed);
+      }
+    }
+  });
+}
+
+static void TriangleCountFunction(DataChunk &args, ExpressionState &state,
+                                  Vector &result) {
+  auto &func_expr = (BoundFunctionExpression &)state.expr;
+  auto &info = (TriangleCountFunctionData &)*func_expr.bind_info;
+  auto duckpgq_state = GetDuckPGQState(info.context);
+
+  auto csr_entry = duckpgq_state->csr_list.find((uint64_t)info.csr_id);
+  if (csr_entry == duckpgq_state->csr_list.end()) {
+    throw ConstraintException("CSR not found. Is the graph populated?");
+  }
+
+  if (!(csr_entry->second->initialized_v && csr_entry->second->initialized_e)) {
+    throw ConstraintException(
+        "Need to initialize CSR before counting triangles.");
+  }
+  auto &csr = *csr_entry->second;
+  info.computation.Run([&]() { CountTriangles(info, csr); });
+  auto vertex_count = static_cast<int64_t>(info.adjacency.VertexCount());
+
+  auto &src = args.data[1];
+  UnifiedVectorFormat vdata_src;
+  src.ToUnifiedFormat(args.size(), vdata_src);
+  auto src_data = (int64_t *)vdata_src.data;
+
+  ValidityMask &result_validity = FlatVector::Validity(result);
+  result.SetVectorType(VectorType::FLAT_VECTOR);
+  auto result_data = FlatVector::GetData<int64_t>(result);
+
+  for (idx_t n = 0; n < args.size(); n++) {
+    auto src_sel = vdata_src.sel->get_index(n);
+    if (!vdata_src.validity.RowIsValid(src_sel)) {
+      result_validity.SetInvalid(n);
+      continue;
+    }
+    int64_t src_node = src_data[src_sel];
+    if (src_node < 0 || src_node >= vertex_count) {
+      result_validity.SetInvalid(n);
+      continue;
+    }
+    result_data[n] = info.triangles[src_node].load(std::memory_order_relaxed);
+  }
+  duckpgq_state->csr_to_delete.insert(info.csr_id);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreScalarFunctions::RegisterTriangleCountScalarFunction(
+    DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(
+      db, ScalarFunction("triangle_count",
+                         {LogicalType::INTEGER, LogicalType::BIGINT},
+                         LogicalType::BIGINT, TriangleCountFunction,
+                         TriangleCountFunctionData::TriangleCountBind));
+}
+
+} // namespace core
+
+} // namespace duckpgq
\ No newline at end of file
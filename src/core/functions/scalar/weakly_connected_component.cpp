@@ -4,39 +4,146 @@
 #include <duckpgq/core/functions/function_data/weakly_connected_component_function_data.hpp>
 #include <duckpgq/core/functions/scalar.hpp>
 #include <duckpgq/core/functions/table/weakly_connected_component.hpp>
-#include <duckpgq/core/utils/duckpgq_bitmap.hpp>
+#include <duckpgq/core/utils/duckpgq_bfs.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 #include <atomic>
-#include <vector>
+#include <random>
 
 namespace duckpgq {
 namespace core {
 
-// Helper function to find the root of a node with path compression
-static int64_t FindTreeRoot(std::vector<int64_t> &forest,
-                            int64_t node) {
-  while (true) {
-    int64_t parent = forest[node];
-    if (parent == node) {
-      return node; // Found the root
+//! Number of neighbors every vertex links to before the largest component is
+//! sampled
+#define WCC_NEIGHBOR_ROUNDS 2
+//! Number of vertices sampled to find the largest component
+#define WCC_SAMPLE_SIZE 1024
+
+// Helper function to link the trees of two nodes. The root with the larger id
+// is hooked under the smaller one with a compare-and-swap, and the hook is
+// retried from the new parents if another thread moved the root first.
+static void Link(std::atomic<int64_t> *forest, int64_t nodeA, int64_t nodeB) {
+  int64_t parentA = forest[nodeA].load(std::memory_order_relaxed);
+  int64_t parentB = forest[nodeB].load(std::memory_order_relaxed);
+  while (parentA != parentB) {
+    int64_t high = MaxValue(parentA, parentB);
+    int64_t low = MinValue(parentA, parentB);
+    int64_t parent_high = forest[high].load(std::memory_order_relaxed);
+    if (parent_high == low) {
+      return;
     }
-    forest[node] = forest[parent];
-    node = parent;
+    if (parent_high == high &&
+        forest[high].compare_exchange_strong(parent_high, low)) {
+      return;
+    }
+    parentA = forest[forest[high].load(std::memory_order_relaxed)].load(
+        std::memory_order_relaxed);
+    parentB = forest[low].load(std::memory_order_relaxed);
   }
 }
 
+// Helper function to point every node in [begin, end) to its root
+static void Compress(std::atomic<int64_t> *forest, int64_t begin,
+                     int64_t end) {
+  for (int64_t node = begin; node < end; node++) {
+    int64_t parent = forest[node].load(std::memory_order_relaxed);
+    int64_t grandparent = forest[parent].load(std::memory_order_relaxed);
+    while (parent != grandparent) {
+      forest[node].store(grandparent, std::memory_order_relaxed);
+      parent = grandparent;
+      grandparent = forest[parent].load(std::memory_order_relaxed);
+    }
+  }
+}
 
-// Helper function to link two nodes in the same connected component
-static void Link(std::vector<int64_t> &forest, int64_t nodeA,
-                 int64_t nodeB) {
-  int64_t rootA = FindTreeRoot(forest, nodeA);
-  int64_t rootB = FindTreeRoot(forest, nodeB);
-
-  if (rootA != rootB) {
-    forest[rootA] = rootB;
+// The most frequent root among sampled nodes, which is likely the largest
+// component
+static int64_t SampleFrequentRoot(std::atomic<int64_t> *forest,
+                                  int64_t v_size) {
+  std::mt19937_64 rng(0);
+  std::unordered_map<int64_t, idx_t> counts;
+  int64_t frequent_root = 0;
+  idx_t frequent_count = 0;
+  for (idx_t i = 0; i < WCC_SAMPLE_SIZE; i++) {
+    auto root = forest[rng() % v_size].load(std::memory_order_relaxed);
+    auto count = ++counts[root];
+    if (count > frequent_count) {
+      frequent_root = root;
+      frequent_count = count;
+    }
   }
+  return frequent_root;
 }
 
+//! Afforest (Sutton et al., IPDPS 2018). Every vertex first links to a few
+//! of its neighbors, which already joins most of the largest component. The
+//! remaining edges are linked afterwards, except those of the vertices in
+//! the largest component found by sampling, whose other endpoints link the
+//! edges instead if the CSR is symmetric. All links go through Link, so the
+//! vertices are split into ranges that the threads process in parallel.
+struct WeaklyConnectedComponentOperation {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, const CSR &full_csr,
+                        WeaklyConnectedComponentFunctionData &info) {
+    auto &context = info.context;
+    // The last vertex is a sentinel without an adjacency list
+    int64_t v_size = csr.vsize - 1;
+    auto forest = info.forest.get();
+    auto range_count = BfsRangeCount(context, v_size);
+    auto range_size = BfsRangeSize(v_size, range_count);
+    auto parallel_ranges =
+        [&](const std::function<void(int64_t, int64_t)> &function) {
+          info.computation.ParallelFor(context, range_count, [&](idx_t idx) {
+            auto begin =
+                MinValue<int64_t>(static_cast<int64_t>(idx) * range_size,
+                                  v_size);
+            function(begin, MinValue<int64_t>(begin + range_size, v_size));
+          });
+        };
+
+    parallel_ranges([&](int64_t begin, int64_t end) {
+      for (auto node = begin; node < end; node++) {
+        forest[node].store(node, std::memory_order_relaxed);
+      }
+    });
+    for (int64_t round = 0; round < WCC_NEIGHBOR_ROUNDS; round++) {
+      parallel_ranges([&](int64_t begin, int64_t end) {
+        for (auto node = begin; node < end; node++) {
+          int64_t position = 0;
+          csr.AnyNeighbor(node, [&](int64_t neighbor, int64_t) {
+            if (position++ < round) {
+              return false;
+            }
+            Link(forest, node, neighbor);
+            return true;
+          });
+        }
+      });
+      parallel_ranges(
+          [&](int64_t begin, int64_t end) { Compress(forest, begin, end); });
+    }
+
+    // Without incoming edges in the lists, the edges of the largest component
+    // are only linked by its own vertices
+    auto skipped_root =
+        full_csr.symmetric ? SampleFrequentRoot(forest, v_size) : -1;
+    parallel_ranges([&](int64_t begin, int64_t end) {
+      for (auto node = begin; node < end; node++) {
+        if (forest[node].load(std::memory_order_relaxed) == skipped_root) {
+          continue;
+        }
+        int64_t position = 0;
+        csr.ForEachNeighbor(node, [&](int64_t neighbor, int64_t) {
+          if (position++ >= WCC_NEIGHBOR_ROUNDS) {
+            Link(forest, node, neighbor);
+          }
+        });
+      }
+    });
+    parallel_ranges(
+        [&](int64_t begin, int64_t end) { Compress(forest, begin, end); });
+  }
+};
+
 static void WeaklyConnectedComponentFunction(DataChunk &args,
                                              ExpressionState &state,
                                              Vector &result) {
@@ -55,9 +162,14 @@ static void WeaklyConnectedComponentFunction(DataChunk &args,
   }
 
   // Retrieve CSR data
-  int64_t *v = (int64_t *)duckpgq_state->csr_list[info.csr_id]->v;
-  vector<int64_t> &e = duckpgq_state->csr_list[info.csr_id]->e;
-  size_t v_size = duckpgq_state->csr_list[info.csr_id]->vsize;
+  auto &csr = *csr_entry->second;
+  int64_t v_size = csr.vsize;
+
+  info.computation.Run([&]() {
+    info.forest = make_unsafe_uniq_array<std::atomic<int64_t>>(v_size);
+    info.forest[v_size - 1] = v_size - 1;
+    TemplatedCSRDispatch<WeaklyConnectedComponentOperation>(csr, csr, info);
+  });
 
   // Get source vector for searches
   auto &src = args.data[1];
@@ -70,38 +182,16 @@ static void WeaklyConnectedComponentFunction(DataChunk &args,
   result.SetVectorType(VectorType::FLAT_VECTOR);
   auto result_data = FlatVector::GetData<int64_t>(result);
 
-  if (!info.state_initialized) {
-    std::lock_guard<std::mutex> guard(info.initialize_lock); // Thread safety
-    if (!info.state_converged) {
-      info.forest.resize(v_size);
-      info.state_initialized = true; // Initialize state
-    }
-  }
-
-  // Check if already converged
-  if (!info.state_converged) {
-    std::lock_guard<std::mutex> guard(info.wcc_lock); // Thread safety
-    if (!info.state_converged) {
-      // Initialize the forest for connected components
-      for (int64_t i = 0; i < v_size - 1; ++i) {
-        info.forest[i] = i; // Each node points to itself
-      }
-      // Process edges to link nodes
-      for (int64_t i = 0; i < v_size - 1; i++) {
-        for (int64_t edge_idx = v[i]; edge_idx < v[i + 1]; edge_idx++) {
-          int64_t neighbor = e[edge_idx];
-          Link(info.forest, i, neighbor);
-        }
-      }
-      info.state_converged = true;
+  // Assign the smallest vertex of the component as its id
+  for (idx_t i = 0; i < args.size(); i++) {
+    auto src_pos = vdata_src.sel->get_index(i);
+    if (!vdata_src.validity.RowIsValid(src_pos)) {
+      result_validity.SetInvalid(i);
+      continue;
     }
-  }
-  // Assign component IDs for the source nodes
-  for (size_t i = 0; i < args.size(); i++) {
-    int64_t src_node = src_data[i];
+    int64_t src_node = src_data[src_pos];
     if (src_node >= 0 && src_node < v_size) {
-      result_data[i] =
-          FindTreeRoot(info.forest, src_node); // Assign component ID to the result
+      result_data[i] = info.forest[src_node].load(std::memory_order_relaxed);
     } else {
       result_validity.SetInvalid(i);
     }
@@ -0,0 +1,142 @@
+#include "duckpgq/core/functions/table/bfs_distances.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/tableref/joinref.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+
+#include <duckpgq/core/functions/table.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+namespace core {
+
+// Function to extract a field of the vertices unnested from bfs_distances
+static unique_ptr<ParsedExpression> CreateReachedField(const string &field) {
+  vector<unique_ptr<ParsedExpression>> children;
+  children.push_back(make_uniq<ColumnRefExpression>("reached"));
+  children.push_back(make_uniq<ConstantExpression>(Value(field)));
+  auto extract =
+      make_uniq<FunctionExpression>("struct_extract", std::move(children));
+  extract->alias = field;
+  return std::move(extract);
+}
+
+// Main binding function. Every source runs a single search, whose reached
+// vertices are unnested from the list the bfs_distances scalar returns:
+//   SELECT source, reached.vertex_rowid, reached.distance,
+//          reached.parent_rowid
+//   FROM (SELECT src.key AS source,
+//                unnest(bfs_distances(0, __x.temp + count, src.rowid))
+//                    AS reached
+//         FROM vertex_table src, (...) __x
+//         WHERE src.key IN (sources)) bfs
+unique_ptr<TableRef>
+BfsDistancesFunction::BfsDistancesBindReplace(ClientContext &context,
+                                              TableFunctionBindInput &input) {
+  auto pg_name = StringUtil::Lower(StringValue::Get(input.inputs[0]));
+  auto node_table = StringUtil::Lower(StringValue::Get(input.inputs[1]));
+  auto edge_table = StringUtil::Lower(StringValue::Get(input.inputs[2]));
+
+  auto duckpgq_state = GetDuckPGQState(context);
+  auto pg_info = GetPropertyGraphInfo(duckpgq_state, pg_name);
+  auto edge_pg_entry =
+      ValidateSourceNodeAndEdgeTable(pg_info, node_table, edge_table);
+  auto &vertex_table = edge_pg_entry->source_pg_table;
+  auto &vertex_key = edge_pg_entry->source_pk[0];
+
+  // The key of one source, or a list of them
+  vector<Value> sources;
+  auto &source_input = input.inputs[3];
+  if (source_input.type().id() == LogicalTypeId::LIST) {
+    if (!source_input.IsNull()) {
+      for (auto &source : ListValue::GetChildren(source_input)) {
+        if (!source.IsNull()) {
+          sources.push_back(source);
+        }
+      }
+    }
+  } else if (!source_input.IsNull()) {
+    sources.push_back(source_input);
+  }
+
+  // The vertex count depends on the CSR through __x.temp, which is 0
+  vector<unique_ptr<ParsedExpression>> v_size_children;
+  v_size_children.push_back(make_uniq<ColumnRefExpression>("temp", "__x"));
+  v_size_children.push_back(GetCountTable(vertex_table, "__v", vertex_key));
+
+  vector<unique_ptr<ParsedExpression>> bfs_children;
+  bfs_children.push_back(make_uniq<ConstantExpression>(Value::INTEGER(0)));
+  bfs_children.push_back(
+      make_uniq<FunctionExpression>("add", std::move(v_size_children)));
+  bfs_children.push_back(make_uniq<ColumnRefExpression>("rowid", "src"));
+  auto max_depth = input.named_parameters.find("max_depth");
+  if (max_depth != input.named_parameters.end()) {
+    bfs_children.push_back(make_uniq<ConstantExpression>(max_depth->second));
+  }
+  vector<unique_ptr<ParsedExpression>> unnest_children;
+  unnest_children.push_back(
+      make_uniq<FunctionExpression>("bfs_distances", std::move(bfs_children)));
+  auto unnest =
+      make_uniq<FunctionExpression>("unnest", std::move(unnest_children));
+  unnest->alias = "reached";
+
+  auto search_node = make_uniq<SelectNode>();
+  search_node->select_list.push_back(
+      CreateColumnRefExpression(vertex_key, "src", "source"));
+  search_node->select_list.push_back(std::move(unnest));
+
+  auto cross_join_ref = make_uniq<JoinRef>(JoinRefType::CROSS);
+  cross_join_ref->left = vertex_table->CreateBaseTableRef("src");
+  cross_join_ref->right = CreateCountCTESubquery();
+  search_node->from_table = std::move(cross_join_ref);
+
+  if (sources.empty()) {
+    search_node->where_clause =
+        make_uniq<ConstantExpression>(Value::BOOLEAN(false));
+  } else {
+    auto in_expression =
+        make_uniq<OperatorExpression>(ExpressionType::COMPARE_IN);
+    in_expression->children.push_back(
+        make_uniq<ColumnRefExpression>(vertex_key, "src"));
+    for (auto &source : sources) {
+      in_expression->children.push_back(make_uniq<ConstantExpression>(source));
+    }
+    search_node->where_clause = std::move(in_expression);
+  }
+
+  search_node->cte_map.map["csr_cte"] =
+      CreateCSRCTE(context, pg_name, edge_pg_entry, search_node, true);
+  CSRRequireRebind(input);
+
+  auto search_statement = make_uniq<SelectStatement>();
+  search_statement->node = std::move(search_node);
+
+  auto select_node = make_uniq<SelectNode>();
+  select_node->select_list.push_back(make_uniq<ColumnRefExpression>("source"));
+  select_node->select_list.push_back(CreateReachedField("vertex_rowid"));
+  select_node->select_list.push_back(CreateReachedField("distance"));
+  select_node->select_list.push_back(CreateReachedField("parent_rowid"));
+  select_node->from_table =
+      make_uniq<SubqueryRef>(std::move(search_statement), "bfs");
+
+  auto subquery = make_uniq<SelectStatement>();
+  subquery->node = std::move(select_node);
+
+  auto result = make_uniq<SubqueryRef>(std::move(subquery));
+  result->alias = "bfs_distances";
+  return std::move(result);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreTableFunctions::RegisterBfsDistancesTableFunction(
+    DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(db, BfsDistancesFunction());
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -327,6 +327,9 @@ void CreatePropertyGraphFunction::CreatePropertyGraphFunc(
     local_state->registered_property_graphs[pg_info->property_graph_name] =
         pg_info->Copy();
   }
+  // The cached CSRs may have been built from an earlier definition of the
+  // property graph
+  CSRCache::Get(context)->Invalidate();
 
   auto new_conn = make_shared_ptr<ClientContext>(context.db);
 
@@ -0,0 +1,61 @@
+#include "duckpgq/core/functions/table/csr_cache.hpp"
+#include "duckpgq/core/utils/csr_cache.hpp"
+#include <duckpgq/core/functions/table.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+unique_ptr<FunctionData>
+CSRCacheFunction::CSRCacheBind(ClientContext &context,
+                               TableFunctionBindInput &input,
+                               vector<LogicalType> &return_types,
+                               vector<string> &names) {
+  names.emplace_back("key");
+  return_types.emplace_back(LogicalType::VARCHAR);
+  names.emplace_back("hits");
+  return_types.emplace_back(LogicalType::BIGINT);
+  names.emplace_back("distance_index_hits");
+  return_types.emplace_back(LogicalType::BIGINT);
+  names.emplace_back("memory_usage_bytes");
+  return_types.emplace_back(LogicalType::BIGINT);
+  return make_uniq<TableFunctionData>();
+}
+
+unique_ptr<GlobalTableFunctionState>
+CSRCacheFunction::CSRCacheInit(ClientContext &context,
+                               TableFunctionInitInput &input) {
+  auto result = make_uniq<CSRCacheGlobalData>();
+  result->entries = CSRCache::Get(context)->GetHits();
+  return std::move(result);
+}
+
+void CSRCacheFunction::CSRCacheFunc(ClientContext &context,
+                                    TableFunctionInput &data_p,
+                                    DataChunk &output) {
+  auto &data = data_p.global_state->Cast<CSRCacheGlobalData>();
+  idx_t count = 0;
+  while (data.offset < data.entries.size() && count < STANDARD_VECTOR_SIZE) {
+    auto &entry = data.entries[data.offset++];
+    output.SetValue(0, count, Value(entry.key));
+    output.SetValue(1, count, Value::BIGINT(NumericCast<int64_t>(entry.hits)));
+    output.SetValue(
+        2, count,
+        Value::BIGINT(NumericCast<int64_t>(entry.distance_index_hits)));
+    output.SetValue(
+        3, count, Value::BIGINT(NumericCast<int64_t>(entry.memory_usage)));
+    count++;
+  }
+  output.SetCardinality(count);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreTableFunctions::RegisterCSRCacheTableFunction(DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(db, CSRCacheFunction());
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -60,11 +60,20 @@ void DropPropertyGraphFunction::DropPropertyGraphFunc(
     }
     local_state->registered_property_graphs.erase(pg_info->property_graph_name);
   }
+  // The cached CSRs may have been built from an earlier definition of the
+  // property graph
+  auto csr_cache = CSRCache::Get(context);
+  csr_cache->Invalidate();
+  csr_cache->DropDistanceIndexes(pg_info->property_graph_name);
 
   auto new_conn = make_shared_ptr<ClientContext>(context.db);
   new_conn->Query("DELETE FROM __duckpgq_internal where property_graph = '" +
                       pg_info->property_graph_name + "'",
                   false);
+  new_conn->Query(
+      "DELETE FROM __duckpgq_distance_indexes where property_graph = '" +
+          pg_info->property_graph_name + "'",
+      false);
 }
 
 //------------------------------------------------------------------------------
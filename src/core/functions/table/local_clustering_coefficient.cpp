@@ -32,8 +32,9 @@ LocalClusteringCoefficientFunction::LocalClusteringCoefficientBindReplace(
       CreateSelectNode(edge_pg_entry, "local_clustering_coefficient",
                        "local_clustering_coefficient");
 
-  select_node->cte_map.map["csr_cte"] =
-      CreateUndirectedCSRCTE(edge_pg_entry, select_node);
+  select_node->cte_map.map["csr_cte"] = CreateCSRCTE(
+      context, pg_name, edge_pg_entry, select_node, false);
+  CSRRequireRebind(input);
 
   auto subquery = make_uniq<SelectStatement>();
   subquery->node = std::move(select_node);
@@ -11,10 +11,10 @@
 #include "duckdb/parser/expression/function_expression.hpp"
 #include "duckdb/parser/expression/subquery_expression.hpp"
 #include "duckdb/parser/expression/cast_expression.hpp"
-#include "duckdb/parser/expression/between_expression.hpp"
 #include "duckdb/parser/expression/constant_expression.hpp"
 #include "duckdb/parser/expression/comparison_expression.hpp"
 #include "duckdb/parser/expression/conjunction_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
 #include "duckdb/parser/expression/star_expression.hpp"
 
 #include "duckdb/parser/query_node/set_operation_node.hpp"
@@ -415,6 +415,12 @@ unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::GenerateShortestPathCTE(
 
   auto edge_element = GetPathElement(edge_subpath->path_list[0]);
   auto edge_table = FindGraphTable(edge_element->label, pg_table);
+  // (a)<-[e]-*(b) follows the incoming edges of a
+  bool reverse = edge_element->match_type == PGQMatchType::MATCH_EDGE_LEFT;
+  // CreatePathFindingCSRCTE builds the incoming edges of these CSRs, which
+  // lets the search also run backwards from the destination
+  bool bidirectional =
+      reverse || edge_element->match_type == PGQMatchType::MATCH_EDGE_ANY;
 
   auto src_row_id = make_uniq<ColumnRefExpression>(
       "rowid", previous_vertex_element->variable_binding);
@@ -429,9 +435,19 @@ unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::GenerateShortestPathCTE(
       edge_table->source_pk[0])));
   pathfinding_children.push_back(std::move(src_row_id));
   pathfinding_children.push_back(std::move(dst_row_id));
+  if (reverse) {
+    pathfinding_children.push_back(
+        make_uniq<ConstantExpression>(Value::BOOLEAN(true)));
+  }
+  // The search stops after upper hops
+  pathfinding_children.push_back(
+      make_uniq<ConstantExpression>(Value::BIGINT(edge_subpath->lower)));
+  pathfinding_children.push_back(
+      make_uniq<ConstantExpression>(Value::BIGINT(edge_subpath->upper)));
 
   auto shortest_path_function = make_uniq<FunctionExpression>(
-      "shortestpath", std::move(pathfinding_children));
+      bidirectional ? "shortestpathbidirectional" : "shortestpath",
+      std::move(pathfinding_children));
   shortest_path_function->alias = "path";
   select_node->select_list.push_back(std::move(shortest_path_function));
   auto src_rowid_outer_select = make_uniq<ColumnRefExpression>(
@@ -443,9 +459,13 @@ unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::GenerateShortestPathCTE(
   dst_rowid_outer_select->alias = "dst_rowid";
   select_node->select_list.push_back(std::move(dst_rowid_outer_select));
 
-  auto src_tableref = edge_table->source_pg_table->CreateBaseTableRef();
+  auto &src_pg_table = reverse ? edge_table->destination_pg_table
+                               : edge_table->source_pg_table;
+  auto &dst_pg_table = reverse ? edge_table->source_pg_table
+                               : edge_table->destination_pg_table;
+  auto src_tableref = src_pg_table->CreateBaseTableRef();
   src_tableref->alias = previous_vertex_element->variable_binding;
-  auto dst_tableref = edge_table->destination_pg_table->CreateBaseTableRef();
+  auto dst_tableref = dst_pg_table->CreateBaseTableRef();
   dst_tableref->alias = next_vertex_element->variable_binding;
   auto first_cross_join_ref = make_uniq<JoinRef>(JoinRefType::CROSS);
   first_cross_join_ref->left = std::move(src_tableref);
@@ -464,7 +484,8 @@ unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::GenerateShortestPathCTE(
 
   path_finding_conditions.push_back(AddPathQuantifierCondition(
       previous_vertex_element->variable_binding,
-      next_vertex_element->variable_binding, edge_table, edge_subpath));
+      next_vertex_element->variable_binding, edge_table, edge_subpath,
+      reverse));
 
   select_node->where_clause = CreateWhereClause(path_finding_conditions);
 
@@ -474,7 +495,7 @@ unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::GenerateShortestPathCTE(
 }
 
 unique_ptr<ParsedExpression> PGQMatchFunction::CreatePathFindingFunction(
-    vector<unique_ptr<PathReference>> &path_list,
+    ClientContext &context, vector<unique_ptr<PathReference>> &path_list,
     CreatePropertyGraphInfo &pg_table, const string &path_variable,
     unique_ptr<SelectNode> &final_select_node,
     vector<unique_ptr<ParsedExpression>> &conditions) {
@@ -526,23 +547,13 @@ unique_ptr<ParsedExpression> PGQMatchFunction::CreatePathFindingFunction(
             final_select_node->cte_map.map.end()) {
           edge_element =
               reinterpret_cast<PathElement *>(edge_subpath->path_list[0].get());
-          if (edge_element->match_type == PGQMatchType::MATCH_EDGE_RIGHT) {
-            final_select_node->cte_map.map["cte1"] = CreateDirectedCSRCTE(
-                FindGraphTable(edge_element->label, pg_table),
-                previous_vertex_element->variable_binding,
-                edge_element->variable_binding,
-                next_vertex_element->variable_binding);
-          } else if (edge_element->match_type == PGQMatchType::MATCH_EDGE_ANY) {
-            final_select_node->cte_map.map["cte1"] = CreateUndirectedCSRCTE(
-                FindGraphTable(edge_element->label, pg_table),
-                final_select_node);
-          } else {
-            throw NotImplementedException(
-                "Cannot do shortest path for edge type %s",
-                edge_element->match_type == PGQMatchType::MATCH_EDGE_LEFT
-                    ? "MATCH_EDGE_LEFT"
-                    : "MATCH_EDGE_LEFT_RIGHT");
-          }
+          final_select_node->cte_map.map["cte1"] = CreatePathFindingCSRCTE(
+              context, pg_table,
+              FindGraphTable(edge_element->label, pg_table), final_select_node,
+              edge_element->match_type,
+              previous_vertex_element->variable_binding,
+              edge_element->variable_binding,
+              next_vertex_element->variable_binding);
         }
         string shortest_path_cte_name = "shortest_path_cte";
         if (final_select_node->cte_map.map.find(shortest_path_cte_name) ==
@@ -677,7 +688,8 @@ void PGQMatchFunction::AddEdgeJoins(
 
 unique_ptr<ParsedExpression> PGQMatchFunction::AddPathQuantifierCondition(
     const string &prev_binding, const string &next_binding,
-    const shared_ptr<PropertyGraphTable> &edge_table, const SubPath *subpath) {
+    const shared_ptr<PropertyGraphTable> &edge_table, const SubPath *subpath,
+    bool reverse) {
 
   auto src_row_id = make_uniq<ColumnRefExpression>("rowid", prev_binding);
   auto dst_row_id = make_uniq<ColumnRefExpression>("rowid", next_binding);
@@ -689,6 +701,16 @@ unique_ptr<ParsedExpression> PGQMatchFunction::AddPathQuantifierCondition(
       edge_table->source_pg_table, prev_binding, edge_table->source_pk[0])));
   pathfinding_children.push_back(std::move(src_row_id));
   pathfinding_children.push_back(std::move(dst_row_id));
+  if (reverse) {
+    pathfinding_children.push_back(
+        make_uniq<ConstantExpression>(Value::BOOLEAN(true)));
+  }
+  // iterativelength stops searching after upper hops, and returns NULL for
+  // paths outside of the bounds
+  pathfinding_children.push_back(
+      make_uniq<ConstantExpression>(Value::BIGINT(subpath->lower)));
+  pathfinding_children.push_back(
+      make_uniq<ConstantExpression>(Value::BIGINT(subpath->upper)));
 
   auto reachability_function = make_uniq<FunctionExpression>(
       "iterativelength", std::move(pathfinding_children));
@@ -701,18 +723,42 @@ unique_ptr<ParsedExpression> PGQMatchFunction::AddPathQuantifierCondition(
 
   auto addition_function =
       make_uniq<FunctionExpression>("add", std::move(addition_children));
-  auto lower_limit = make_uniq<ConstantExpression>(
-      Value::INTEGER(static_cast<int32_t>(subpath->lower)));
-  auto upper_limit = make_uniq<ConstantExpression>(
-      Value::INTEGER(static_cast<int32_t>(subpath->upper)));
-  auto between_expression = make_uniq<BetweenExpression>(
-      std::move(addition_function), std::move(lower_limit),
-      std::move(upper_limit));
-  return std::move(between_expression);
+  auto not_null_expression = make_uniq<OperatorExpression>(
+      ExpressionType::OPERATOR_IS_NOT_NULL, std::move(addition_function));
+  return std::move(not_null_expression);
+}
+
+unique_ptr<CommonTableExpressionInfo> PGQMatchFunction::CreatePathFindingCSRCTE(
+    ClientContext &context, CreatePropertyGraphInfo &pg_table,
+    const shared_ptr<PropertyGraphTable> &edge_table,
+    const unique_ptr<SelectNode> &select_node, PGQMatchType edge_type,
+    const string &prev_binding, const string &edge_binding,
+    const string &next_binding) {
+  switch (edge_type) {
+  case PGQMatchType::MATCH_EDGE_RIGHT:
+    return CreateCSRCTE(context, pg_table.property_graph_name, edge_table,
+                        select_node, true, prev_binding, edge_binding,
+                        next_binding);
+  case PGQMatchType::MATCH_EDGE_ANY:
+    // The undirected CSR is its own reverse, which lets iterativelength take
+    // bottom-up steps
+    return CreateCSRCTE(context, pg_table.property_graph_name, edge_table,
+                        select_node, false, prev_binding, edge_binding,
+                        next_binding, true);
+  case PGQMatchType::MATCH_EDGE_LEFT:
+    // The edges of (a)<-[e]-(b) go from b to a. Path-finding follows the
+    // incoming edges of the reverse CSR, which is built in the same pass.
+    return CreateCSRCTE(context, pg_table.property_graph_name, edge_table,
+                        select_node, true, next_binding, edge_binding,
+                        prev_binding, true);
+  default:
+    throw NotImplementedException(
+        "Cannot do shortest path for edge type MATCH_EDGE_LEFT_RIGHT");
+  }
 }
 
 void PGQMatchFunction::AddPathFinding(
-    unique_ptr<SelectNode> &select_node,
+    ClientContext &context, unique_ptr<SelectNode> &select_node,
     vector<unique_ptr<ParsedExpression>> &conditions,
     const string &prev_binding, const string &edge_binding,
     const string &next_binding,
@@ -722,18 +768,9 @@ void PGQMatchFunction::AddPathFinding(
   //! START
   //! FROM (SELECT count(cte1.temp) * 0 as temp from cte1) __x
   if (select_node->cte_map.map.find("cte1") == select_node->cte_map.map.end()) {
-    if (edge_type == PGQMatchType::MATCH_EDGE_RIGHT) {
-      select_node->cte_map.map["cte1"] = CreateDirectedCSRCTE(
-          edge_table, prev_binding, edge_binding, next_binding);
-    } else if (edge_type == PGQMatchType::MATCH_EDGE_ANY) {
-      select_node->cte_map.map["cte1"] =
-          CreateUndirectedCSRCTE(edge_table, select_node);
-    } else {
-      throw NotImplementedException("Cannot do shortest path for edge type %s",
-                                    edge_type == PGQMatchType::MATCH_EDGE_LEFT
-                                        ? "MATCH_EDGE_LEFT"
-                                        : "MATCH_EDGE_LEFT_RIGHT");
-    }
+    select_node->cte_map.map["cte1"] = CreatePathFindingCSRCTE(
+        context, pg_table, edge_table, select_node, edge_type, prev_binding,
+        edge_binding, next_binding);
   }
   if (select_node->cte_map.map.find("shortest_path_cte") !=
       select_node->cte_map.map.end()) {
@@ -755,16 +792,17 @@ void PGQMatchFunction::AddPathFinding(
 
   //! START
   //! WHERE __x.temp + iterativelength(<csr_id>, (SELECT count(c.id)
-  //!       from dst c, a.rowid, b.rowid) between lower and upper
-  conditions.push_back(AddPathQuantifierCondition(prev_binding, next_binding,
-                                                  edge_table, subpath));
+  //!       from dst c, a.rowid, b.rowid, lower, upper) IS NOT NULL
+  conditions.push_back(AddPathQuantifierCondition(
+      prev_binding, next_binding, edge_table, subpath,
+      edge_type == PGQMatchType::MATCH_EDGE_LEFT));
   //! END
   //! WHERE __x.temp + iterativelength(<csr_id>, (SELECT count(s.id)
-  //! from src s, a.rowid, b.rowid) between lower and upper
+  //! from src s, a.rowid, b.rowid, lower, upper) IS NOT NULL
 }
 
 void PGQMatchFunction::CheckNamedSubpath(
-    SubPath &subpath, MatchExpression &original_ref,
+    ClientContext &context, SubPath &subpath, MatchExpression &original_ref,
     CreatePropertyGraphInfo &pg_table,
     unique_ptr<SelectNode> &final_select_node,
     vector<unique_ptr<ParsedExpression>> &conditions) {
@@ -789,8 +827,8 @@ void PGQMatchFunction::CheckNamedSubpath(
       // Check subpath name matches the column referenced in the function -->
       // element_id(named_subpath)
       auto shortest_path_function = CreatePathFindingFunction(
-          subpath.path_list, pg_table, subpath.path_variable, final_select_node,
-          conditions);
+          context, subpath.path_list, pg_table, subpath.path_variable,
+          final_select_node, conditions);
 
       if (column_alias.empty()) {
         shortest_path_function->alias =
@@ -803,8 +841,8 @@ void PGQMatchFunction::CheckNamedSubpath(
                                       std::move(shortest_path_function));
     } else if (parsed_ref->function_name == "path_length") {
       auto shortest_path_function = CreatePathFindingFunction(
-          subpath.path_list, pg_table, subpath.path_variable, final_select_node,
-          conditions);
+          context, subpath.path_list, pg_table, subpath.path_variable,
+          final_select_node, conditions);
       auto path_len_children = vector<unique_ptr<ParsedExpression>>();
       path_len_children.push_back(std::move(shortest_path_function));
       auto path_len =
@@ -825,8 +863,8 @@ void PGQMatchFunction::CheckNamedSubpath(
                parsed_ref->function_name == "edges") {
       auto list_slice_children = vector<unique_ptr<ParsedExpression>>();
       auto shortest_path_function = CreatePathFindingFunction(
-          subpath.path_list, pg_table, subpath.path_variable, final_select_node,
-          conditions);
+          context, subpath.path_list, pg_table, subpath.path_variable,
+          final_select_node, conditions);
       list_slice_children.push_back(std::move(shortest_path_function));
 
       if (parsed_ref->function_name == "vertices") {
@@ -860,7 +898,7 @@ void PGQMatchFunction::CheckNamedSubpath(
 }
 
 void PGQMatchFunction::ProcessPathList(
-    vector<unique_ptr<PathReference>> &path_list,
+    ClientContext &context, vector<unique_ptr<PathReference>> &path_list,
     vector<unique_ptr<ParsedExpression>> &conditions,
     unique_ptr<SelectNode> &final_select_node,
     case_insensitive_map_t<shared_ptr<PropertyGraphTable>> &alias_map,
@@ -875,15 +913,15 @@ void PGQMatchFunction::ProcessPathList(
     }
     if (!previous_vertex_subpath->path_variable.empty() &&
         previous_vertex_subpath->path_list.size() > 1) {
-      CheckNamedSubpath(*previous_vertex_subpath, original_ref, pg_table,
-                        final_select_node, conditions);
+      CheckNamedSubpath(context, *previous_vertex_subpath, original_ref,
+                        pg_table, final_select_node, conditions);
     }
     if (previous_vertex_subpath->path_list.size() == 1) {
       previous_vertex_element =
           GetPathElement(previous_vertex_subpath->path_list[0]);
     } else {
       // Add the shortest path if the name is found in the column_list
-      ProcessPathList(previous_vertex_subpath->path_list, conditions,
+      ProcessPathList(context, previous_vertex_subpath->path_list, conditions,
                       final_select_node, alias_map, pg_table,
                       extra_alias_counter, original_ref);
       return;
@@ -933,7 +971,7 @@ void PGQMatchFunction::ProcessPathList(
 
       if (edge_subpath->upper > 1) {
         // Add the path-finding
-        AddPathFinding(final_select_node, conditions,
+        AddPathFinding(context, final_select_node, conditions,
                        previous_vertex_element->variable_binding,
                        edge_element->variable_binding,
                        next_vertex_element->variable_binding, edge_table,
@@ -1063,8 +1101,13 @@ PGQMatchFunction::MatchBindReplace(ClientContext &context,
     auto &path_pattern = ref->path_patterns[idx_i];
     // Check if the element is PathElement or a Subpath with potentially many
     // items
-    ProcessPathList(path_pattern->path_elements, conditions, final_select_node,
-                    alias_map, *pg_table, extra_alias_counter, *ref);
+    ProcessPathList(context, path_pattern->path_elements, conditions,
+                    final_select_node, alias_map, *pg_table,
+                    extra_alias_counter, *ref);
+  }
+  if (final_select_node->cte_map.map.find("cte1") !=
+      final_select_node->cte_map.map.end()) {
+    CSRRequireRebind(bind_input);
   }
 
   // Go through all aliases encountered
@@ -1,6 +1,13 @@
 #include "duckpgq/core/functions/table/pagerank.hpp"
 #include "duckdb/function/table_function.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/tableref/joinref.hpp"
 #include "duckdb/parser/tableref/subqueryref.hpp"
+#include "duckdb/parser/tableref/table_function_ref.hpp"
+#include "duckpgq/core/functions/function_data/pagerank_function_data.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
 
 #include <duckpgq/core/functions/table.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
@@ -9,6 +16,31 @@
 namespace duckpgq {
 namespace core {
 
+// The value of a named parameter of PageRank, or its default
+static Value GetPageRankParameter(TableFunctionBindInput &input,
+                                  const string &name, Value default_value) {
+  auto parameter = input.named_parameters.find(name);
+  if (parameter == input.named_parameters.end()) {
+    return default_value;
+  }
+  return parameter->second;
+}
+
+// The damping factor, tolerance and most iterations, as the last arguments of
+// the pagerank and pagerank_residual scalars
+static vector<unique_ptr<ParsedExpression>>
+CreatePageRankParameters(TableFunctionBindInput &input) {
+  vector<unique_ptr<ParsedExpression>> parameters;
+  parameters.push_back(make_uniq<ConstantExpression>(GetPageRankParameter(
+      input, "damping", Value::DOUBLE(PAGERANK_DEFAULT_DAMPING))));
+  parameters.push_back(make_uniq<ConstantExpression>(GetPageRankParameter(
+      input, "tolerance", Value::DOUBLE(PAGERANK_DEFAULT_TOLERANCE))));
+  parameters.push_back(make_uniq<ConstantExpression>(
+      GetPageRankParameter(input, "max_iterations",
+                           Value::BIGINT(PAGERANK_DEFAULT_MAX_ITERATIONS))));
+  return parameters;
+}
+
 // Main binding function
 unique_ptr<TableRef>
 PageRankFunction::PageRankBindReplace(ClientContext &context,
@@ -22,10 +54,14 @@ PageRankFunction::PageRankBindReplace(ClientContext &context,
   auto edge_pg_entry =
       ValidateSourceNodeAndEdgeTable(pg_info, node_table, edge_table);
 
-  auto select_node = CreateSelectNode(edge_pg_entry, "pagerank", "pagerank");
+  auto select_node = CreateSelectNode(edge_pg_entry, "pagerank", "pagerank",
+                                      CreatePageRankParameters(input));
 
+  // The ranks are pulled over the incoming edges of every vertex
   select_node->cte_map.map["csr_cte"] =
-      CreateDirectedCSRCTE(edge_pg_entry, "src", "edge", "dst");
+      CreateCSRCTE(context, pg_name, edge_pg_entry, select_node, true, "src",
+                   "edge", "dst", true);
+  CSRRequireRebind(input);
 
   auto subquery = make_uniq<SelectStatement>();
   subquery->node = std::move(select_node);
@@ -35,12 +71,98 @@ PageRankFunction::PageRankBindReplace(ClientContext &context,
   return std::move(result);
 }
 
+// Every iteration up to the most iterations asks for its residual, which is
+// NULL for the iterations after PageRank stopped:
+//   SELECT iteration, residual
+//   FROM (SELECT range AS iteration,
+//                __x.temp + pagerank_residual(0, range, ...) AS residual
+//         FROM range(1, max_iterations + 1), (...) __x) residuals
+//   WHERE residual IS NOT NULL
+unique_ptr<TableRef> PageRankResidualsFunction::PageRankResidualsBindReplace(
+    ClientContext &context, TableFunctionBindInput &input) {
+  auto pg_name = StringUtil::Lower(StringValue::Get(input.inputs[0]));
+  auto node_table = StringUtil::Lower(StringValue::Get(input.inputs[1]));
+  auto edge_table = StringUtil::Lower(StringValue::Get(input.inputs[2]));
+
+  auto duckpgq_state = GetDuckPGQState(context);
+  auto pg_info = GetPropertyGraphInfo(duckpgq_state, pg_name);
+  auto edge_pg_entry =
+      ValidateSourceNodeAndEdgeTable(pg_info, node_table, edge_table);
+
+  auto parameters = CreatePageRankParameters(input);
+  auto max_iterations =
+      GetPageRankParameter(input, "max_iterations",
+                           Value::BIGINT(PAGERANK_DEFAULT_MAX_ITERATIONS));
+  if (max_iterations.IsNull() || max_iterations.GetValue<int64_t>() < 0) {
+    // Binding pagerank_residual rejects the parameter
+    max_iterations = Value::BIGINT(0);
+  }
+
+  vector<unique_ptr<ParsedExpression>> range_children;
+  range_children.push_back(make_uniq<ConstantExpression>(Value::BIGINT(1)));
+  range_children.push_back(make_uniq<ConstantExpression>(
+      Value::BIGINT(max_iterations.GetValue<int64_t>() + 1)));
+  auto range_ref = make_uniq<TableFunctionRef>();
+  range_ref->function =
+      make_uniq<FunctionExpression>("range", std::move(range_children));
+
+  vector<unique_ptr<ParsedExpression>> residual_children;
+  residual_children.push_back(
+      make_uniq<ConstantExpression>(Value::INTEGER(0)));
+  residual_children.push_back(make_uniq<ColumnRefExpression>("range"));
+  for (auto &parameter : parameters) {
+    residual_children.push_back(std::move(parameter));
+  }
+  vector<unique_ptr<ParsedExpression>> addition_children;
+  addition_children.push_back(make_uniq<ColumnRefExpression>("temp", "__x"));
+  addition_children.push_back(make_uniq<FunctionExpression>(
+      "pagerank_residual", std::move(residual_children)));
+  auto residual =
+      make_uniq<FunctionExpression>("add", std::move(addition_children));
+  residual->alias = "residual";
+
+  auto residuals_node = make_uniq<SelectNode>();
+  residuals_node->select_list.push_back(
+      CreateColumnRefExpression("range", "", "iteration"));
+  residuals_node->select_list.push_back(std::move(residual));
+  auto cross_join_ref = make_uniq<JoinRef>(JoinRefType::CROSS);
+  cross_join_ref->left = std::move(range_ref);
+  cross_join_ref->right = CreateCountCTESubquery();
+  residuals_node->from_table = std::move(cross_join_ref);
+  residuals_node->cte_map.map["csr_cte"] =
+      CreateCSRCTE(context, pg_name, edge_pg_entry, residuals_node, true,
+                   "src", "edge", "dst", true);
+  CSRRequireRebind(input);
+
+  auto residuals_statement = make_uniq<SelectStatement>();
+  residuals_statement->node = std::move(residuals_node);
+
+  auto select_node = make_uniq<SelectNode>();
+  select_node->select_list.push_back(
+      make_uniq<ColumnRefExpression>("iteration"));
+  select_node->select_list.push_back(
+      make_uniq<ColumnRefExpression>("residual"));
+  select_node->from_table =
+      make_uniq<SubqueryRef>(std::move(residuals_statement), "residuals");
+  select_node->where_clause = make_uniq<OperatorExpression>(
+      ExpressionType::OPERATOR_IS_NOT_NULL,
+      make_uniq<ColumnRefExpression>("residual"));
+
+  auto subquery = make_uniq<SelectStatement>();
+  subquery->node = std::move(select_node);
+
+  auto result = make_uniq<SubqueryRef>(std::move(subquery));
+  result->alias = "pagerank_residuals";
+  return std::move(result);
+}
+
 //------------------------------------------------------------------------------
 // Register functions
 //------------------------------------------------------------------------------
 void CoreTableFunctions::RegisterPageRankTableFunction(DatabaseInstance &db) {
   ExtensionUtil::RegisterFunction(db, PageRankFunction());
+  ExtensionUtil::RegisterFunction(db, PageRankResidualsFunction());
 }
 
 } // namespace core
-} // namespace duckpgq
\ No newline at end of file
+} // namespace duckpgq
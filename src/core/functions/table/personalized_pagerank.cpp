@@ -0,0 +1,151 @@
+#include "duckpgq/core/functions/table/personalized_pagerank.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/tableref/joinref.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+#include "duckpgq/core/functions/function_data/pagerank_function_data.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+
+#include <duckpgq/core/functions/table.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+namespace core {
+
+// Function to extract a field of the vertices unnested from
+// personalized_pagerank
+static unique_ptr<ParsedExpression> CreateRankedField(const string &field) {
+  vector<unique_ptr<ParsedExpression>> children;
+  children.push_back(make_uniq<ColumnRefExpression>("ranked"));
+  children.push_back(make_uniq<ConstantExpression>(Value(field)));
+  auto extract =
+      make_uniq<FunctionExpression>("struct_extract", std::move(children));
+  extract->alias = field;
+  return std::move(extract);
+}
+
+// Main binding function. The seeds are pushed from in batches, and the ranked
+// vertices of every seed are unnested from the list the scalar returns:
+//   SELECT seed, ranked.vertex_rowid, ranked.pagerank
+//   FROM (SELECT src.key AS seed,
+//                unnest(personalized_pagerank(0, __x.temp + count, src.rowid,
+//                                             damping, tolerance)) AS ranked
+//         FROM vertex_table src, (...) __x
+//         WHERE src.key IN (seeds)) ppr
+unique_ptr<TableRef>
+PersonalizedPageRankFunction::PersonalizedPageRankBindReplace(
+    ClientContext &context, TableFunctionBindInput &input) {
+  auto pg_name = StringUtil::Lower(StringValue::Get(input.inputs[0]));
+  auto node_table = StringUtil::Lower(StringValue::Get(input.inputs[1]));
+  auto edge_table = StringUtil::Lower(StringValue::Get(input.inputs[2]));
+
+  auto duckpgq_state = GetDuckPGQState(context);
+  auto pg_info = GetPropertyGraphInfo(duckpgq_state, pg_name);
+  auto edge_pg_entry =
+      ValidateSourceNodeAndEdgeTable(pg_info, node_table, edge_table);
+  auto &vertex_table = edge_pg_entry->source_pg_table;
+  auto &vertex_key = edge_pg_entry->source_pk[0];
+
+  // The key of one seed, or a list of them
+  vector<Value> seeds;
+  auto &seed_input = input.inputs[3];
+  if (seed_input.type().id() == LogicalTypeId::LIST) {
+    if (!seed_input.IsNull()) {
+      for (auto &seed : ListValue::GetChildren(seed_input)) {
+        if (!seed.IsNull()) {
+          seeds.push_back(seed);
+        }
+      }
+    }
+  } else if (!seed_input.IsNull()) {
+    seeds.push_back(seed_input);
+  }
+
+  // The vertex count depends on the CSR through __x.temp, which is 0
+  vector<unique_ptr<ParsedExpression>> v_size_children;
+  v_size_children.push_back(make_uniq<ColumnRefExpression>("temp", "__x"));
+  v_size_children.push_back(GetCountTable(vertex_table, "__v", vertex_key));
+
+  vector<unique_ptr<ParsedExpression>> ppr_children;
+  ppr_children.push_back(make_uniq<ConstantExpression>(Value::INTEGER(0)));
+  ppr_children.push_back(
+      make_uniq<FunctionExpression>("add", std::move(v_size_children)));
+  ppr_children.push_back(make_uniq<ColumnRefExpression>("rowid", "src"));
+  auto damping = input.named_parameters.find("damping");
+  auto tolerance = input.named_parameters.find("tolerance");
+  if (damping != input.named_parameters.end() ||
+      tolerance != input.named_parameters.end()) {
+    ppr_children.push_back(make_uniq<ConstantExpression>(
+        damping != input.named_parameters.end()
+            ? damping->second
+            : Value::DOUBLE(PAGERANK_DEFAULT_DAMPING)));
+    ppr_children.push_back(make_uniq<ConstantExpression>(
+        tolerance != input.named_parameters.end()
+            ? tolerance->second
+            : Value::DOUBLE(PERSONALIZED_PAGERANK_DEFAULT_TOLERANCE)));
+  }
+  vector<unique_ptr<ParsedExpression>> unnest_children;
+  unnest_children.push_back(make_uniq<FunctionExpression>(
+      "personalized_pagerank", std::move(ppr_children)));
+  auto unnest =
+      make_uniq<FunctionExpression>("unnest", std::move(unnest_children));
+  unnest->alias = "ranked";
+
+  auto ppr_node = make_uniq<SelectNode>();
+  ppr_node->select_list.push_back(
+      CreateColumnRefExpression(vertex_key, "src", "seed"));
+  ppr_node->select_list.push_back(std::move(unnest));
+
+  auto cross_join_ref = make_uniq<JoinRef>(JoinRefType::CROSS);
+  cross_join_ref->left = vertex_table->CreateBaseTableRef("src");
+  cross_join_ref->right = CreateCountCTESubquery();
+  ppr_node->from_table = std::move(cross_join_ref);
+
+  if (seeds.empty()) {
+    ppr_node->where_clause =
+        make_uniq<ConstantExpression>(Value::BOOLEAN(false));
+  } else {
+    auto in_expression =
+        make_uniq<OperatorExpression>(ExpressionType::COMPARE_IN);
+    in_expression->children.push_back(
+        make_uniq<ColumnRefExpression>(vertex_key, "src"));
+    for (auto &seed : seeds) {
+      in_expression->children.push_back(make_uniq<ConstantExpression>(seed));
+    }
+    ppr_node->where_clause = std::move(in_expression);
+  }
+
+  ppr_node->cte_map.map["csr_cte"] =
+      CreateCSRCTE(context, pg_name, edge_pg_entry, ppr_node, true);
+  CSRRequireRebind(input);
+
+  auto ppr_statement = make_uniq<SelectStatement>();
+  ppr_statement->node = std::move(ppr_node);
+
+  auto select_node = make_uniq<SelectNode>();
+  select_node->select_list.push_back(make_uniq<ColumnRefExpression>("seed"));
+  select_node->select_list.push_back(CreateRankedField("vertex_rowid"));
+  select_node->select_list.push_back(CreateRankedField("pagerank"));
+  select_node->from_table =
+      make_uniq<SubqueryRef>(std::move(ppr_statement), "ppr");
+
+  auto subquery = make_uniq<SelectStatement>();
+  subquery->node = std::move(select_node);
+
+  auto result = make_uniq<SubqueryRef>(std::move(subquery));
+  result->alias = "personalized_pagerank";
+  return std::move(result);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreTableFunctions::RegisterPersonalizedPageRankTableFunction(
+    DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(db, PersonalizedPageRankFunction());
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -27,16 +27,16 @@ static void ScanCSREFunction(ClientContext &context, TableFunctionInput &data_p,
   auto csr_id = data_p.bind_data->Cast<CSRScanEData>().csr_id;
   CSR *csr = duckpgq_state->GetCSR(csr_id);
 
-  idx_t vector_size = state->csr_e_offset + DEFAULT_STANDARD_VECTOR_SIZE <= csr->e.size() ?
-    DEFAULT_STANDARD_VECTOR_SIZE : csr->e.size() - state->csr_e_offset;
+  idx_t vector_size = state->csr_e_offset + DEFAULT_STANDARD_VECTOR_SIZE <= csr->EdgeCount() ?
+    DEFAULT_STANDARD_VECTOR_SIZE : csr->EdgeCount() - state->csr_e_offset;
 
   output.SetCardinality(vector_size);
   output.data[0].SetVectorType(VectorType::FLAT_VECTOR);
   for (idx_t idx_i = 0; idx_i < vector_size; idx_i++) {
-    output.data[0].SetValue(idx_i, Value(csr->e[state->csr_e_offset + idx_i]));
+    output.data[0].SetValue(idx_i, Value(csr->GetEdge(state->csr_e_offset + idx_i)));
   }
 
-  if (state->csr_e_offset + vector_size >= csr->e.size()) {
+  if (state->csr_e_offset + vector_size >= csr->EdgeCount()) {
     state->finished = true;
   } else {
     state->csr_e_offset += vector_size;
@@ -57,6 +57,8 @@ static void ScanCSRPtrFunction(ClientContext &context,
   auto duckpgq_state = GetDuckPGQState(context);
   auto csr_id = data_p.bind_data->Cast<CSRScanPtrData>().csr_id;
   CSR *csr = duckpgq_state->GetCSR(csr_id);
+  // The pointers refer to the 64-bit layout, also for a narrowed CSR
+  csr->Widen();
   output.SetCardinality(5);
   output.data[0].SetVectorType(VectorType::FLAT_VECTOR);
   auto result_data = FlatVector::GetData<uint64_t>(output.data[0]);
@@ -104,7 +106,7 @@ static void ScanCSRVFunction(ClientContext &context, TableFunctionInput &data_p,
   output.SetCardinality(vector_size);
   output.data[0].SetVectorType(VectorType::FLAT_VECTOR);
   for (idx_t idx_i = 0; idx_i < vector_size; idx_i++) {
-    output.data[0].SetValue(idx_i, Value(csr->v[state->csr_v_offset + idx_i]));
+    output.data[0].SetValue(idx_i, Value(csr->GetOffset(state->csr_v_offset + idx_i)));
   }
 
   if (state->csr_v_offset + vector_size >= csr->vsize) {
@@ -0,0 +1,97 @@
+#include "duckpgq/core/functions/table/triangle_count.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/parser/expression/cast_expression.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+
+#include <duckpgq/core/functions/table.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+namespace core {
+
+// The triangles of every vertex, counted on the undirected CSR
+static unique_ptr<SelectNode>
+CreateTriangleCountNode(ClientContext &context, TableFunctionBindInput &input) {
+  auto pg_name = StringUtil::Lower(StringValue::Get(input.inputs[0]));
+  auto node_label = StringUtil::Lower(StringValue::Get(input.inputs[1]));
+  auto edge_label = StringUtil::Lower(StringValue::Get(input.inputs[2]));
+
+  auto duckpgq_state = GetDuckPGQState(context);
+  auto pg_info = GetPropertyGraphInfo(duckpgq_state, pg_name);
+  auto edge_pg_entry =
+      ValidateSourceNodeAndEdgeTable(pg_info, node_label, edge_label);
+
+  auto select_node =
+      CreateSelectNode(edge_pg_entry, "triangle_count", "triangle_count");
+  select_node->cte_map.map["csr_cte"] =
+      CreateCSRCTE(context, pg_name, edge_pg_entry, select_node, false);
+  CSRRequireRebind(input);
+  return select_node;
+}
+
+// Main binding function
+unique_ptr<TableRef>
+TriangleCountFunction::TriangleCountBindReplace(ClientContext &context,
+                                                TableFunctionBindInput &input) {
+  auto subquery = make_uniq<SelectStatement>();
+  subquery->node = CreateTriangleCountNode(context, input);
+
+  auto result = make_uniq<SubqueryRef>(std::move(subquery));
+  result->alias = "triangle_count";
+  return std::move(result);
+}
+
+// Every triangle counts for each of its three vertices:
+//   SELECT coalesce(CAST(sum(triangle_count) // 3 AS BIGINT), 0)
+//       AS triangle_count
+//   FROM (SELECT ..., triangle_count(0, rowid) ...) triangles
+unique_ptr<TableRef> TriangleCountTotalFunction::TriangleCountTotalBindReplace(
+    ClientContext &context, TableFunctionBindInput &input) {
+  auto triangles_statement = make_uniq<SelectStatement>();
+  triangles_statement->node = CreateTriangleCountNode(context, input);
+
+  vector<unique_ptr<ParsedExpression>> sum_children;
+  sum_children.push_back(make_uniq<ColumnRefExpression>("triangle_count"));
+  vector<unique_ptr<ParsedExpression>> divide_children;
+  divide_children.push_back(
+      make_uniq<FunctionExpression>("sum", std::move(sum_children)));
+  divide_children.push_back(make_uniq<ConstantExpression>(Value::BIGINT(3)));
+  auto total = make_uniq<CastExpression>(
+      LogicalType::BIGINT,
+      make_uniq<FunctionExpression>("//", std::move(divide_children)));
+  // The sum over a graph without vertices is NULL
+  auto coalesce =
+      make_uniq<OperatorExpression>(ExpressionType::OPERATOR_COALESCE);
+  coalesce->children.push_back(std::move(total));
+  coalesce->children.push_back(
+      make_uniq<ConstantExpression>(Value::BIGINT(0)));
+  coalesce->alias = "triangle_count";
+
+  auto select_node = make_uniq<SelectNode>();
+  select_node->select_list.push_back(std::move(coalesce));
+  select_node->from_table =
+      make_uniq<SubqueryRef>(std::move(triangles_statement), "triangles");
+
+  auto subquery = make_uniq<SelectStatement>();
+  subquery->node = std::move(select_node);
+
+  auto result = make_uniq<SubqueryRef>(std::move(subquery));
+  result->alias = "triangle_count_total";
+  return std::move(result);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CoreTableFunctions::RegisterTriangleCountTableFunction(
+    DatabaseInstance &db) {
+  ExtensionUtil::RegisterFunction(db, TriangleCountFunction());
+  ExtensionUtil::RegisterFunction(db, TriangleCountTotalFunction());
+}
+
+} // namespace core
+} // namespace duckpgq
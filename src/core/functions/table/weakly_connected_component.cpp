@@ -25,8 +25,12 @@ WeaklyConnectedComponentFunction::WeaklyConnectedComponentBindReplace(
   auto select_node = CreateSelectNode(
       edge_pg_entry, "weakly_connected_component", "componentId");
 
+  // The reverse of an undirected CSR shows it is symmetric, so the edges of
+  // the largest component are only linked from the other components
   select_node->cte_map.map["csr_cte"] =
-      CreateUndirectedCSRCTE(edge_pg_entry, select_node);
+      CreateCSRCTE(context, pg_name, edge_pg_entry, select_node, false, "src",
+                   "edge", "dst", true);
+  CSRRequireRebind(input);
 
   auto subquery = make_uniq<SelectStatement>();
   subquery->node = std::move(select_node);
@@ -0,0 +1,63 @@
+#include "duckpgq/core/operator/duckpgq_modified_tables.hpp"
+#include "duckpgq/core/operator/duckpgq_operator.hpp"
+
+#include "duckdb/planner/operator/logical_delete.hpp"
+#include "duckdb/planner/operator/logical_insert.hpp"
+#include "duckdb/planner/operator/logical_update.hpp"
+#include <duckpgq_state.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+static void CollectModifiedTables(LogicalOperator &op, DuckPGQState &state) {
+  switch (op.type) {
+  case LogicalOperatorType::LOGICAL_INSERT:
+    state.modified_tables.insert(op.Cast<LogicalInsert>().table.name);
+    break;
+  case LogicalOperatorType::LOGICAL_DELETE:
+    state.modified_tables.insert(op.Cast<LogicalDelete>().table.name);
+    break;
+  case LogicalOperatorType::LOGICAL_UPDATE:
+    state.modified_tables.insert(op.Cast<LogicalUpdate>().table.name);
+    break;
+  case LogicalOperatorType::LOGICAL_ALTER:
+  case LogicalOperatorType::LOGICAL_CREATE_TABLE:
+  case LogicalOperatorType::LOGICAL_CREATE_INDEX:
+  case LogicalOperatorType::LOGICAL_DROP:
+  case LogicalOperatorType::LOGICAL_ATTACH:
+  case LogicalOperatorType::LOGICAL_DETACH:
+  case LogicalOperatorType::LOGICAL_EXTENSION_OPERATOR:
+    // May replace a table without naming it, or write anywhere
+    state.modified_unknown_tables = true;
+    break;
+  default:
+    break;
+  }
+  for (auto &child : op.children) {
+    CollectModifiedTables(*child, state);
+  }
+}
+
+void DuckPGQModifiedTables(OptimizerExtensionInput &input,
+                           unique_ptr<LogicalOperator> &plan) {
+  auto duckpgq_state =
+      input.context.registered_state->Get<DuckPGQState>("duckpgq");
+  if (!duckpgq_state) {
+    return;
+  }
+  duckpgq_state->plan_checked = true;
+  CollectModifiedTables(*plan, *duckpgq_state);
+}
+
+//------------------------------------------------------------------------------
+// Register functions
+//------------------------------------------------------------------------------
+void CorePGQOperator::RegisterModifiedTablesOptimizer(DatabaseInstance &db) {
+  auto &config = DBConfig::GetConfig(db);
+  config.optimizer_extensions.push_back(DuckPGQModifiedTablesExtension());
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -9,6 +9,7 @@
 #include <duckdb/parser/statement/copy_statement.hpp>
 #include <duckdb/parser/statement/create_statement.hpp>
 #include <duckdb/parser/statement/insert_statement.hpp>
+#include <duckdb/parser/statement/prepare_statement.hpp>
 #include <duckpgq/core/functions/table/create_property_graph.hpp>
 #include <duckpgq_state.hpp>
 
@@ -169,6 +170,11 @@ duckpgq_handle_statement(SQLStatement *statement, DuckPGQState &duckpgq_state) {
     duckpgq_handle_statement(insert_statement.select_statement.get(),
                              duckpgq_state);
   }
+  if (statement->type == StatementType::PREPARE_STATEMENT) {
+    const auto &prepare_statement = statement->Cast<PrepareStatement>();
+    duckpgq_handle_statement(prepare_statement.statement.get(),
+                             duckpgq_state);
+  }
 
   throw Exception(ExceptionType::NOT_IMPLEMENTED,
                   StatementTypeToString(statement->type) +
@@ -0,0 +1,73 @@
+#include "duckdb/function/pragma_function.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include <duckpgq/core/pragma/duckpgq_pragma.hpp>
+#include <duckpgq/core/utils/duckpgq_utils.hpp>
+
+namespace duckpgq {
+
+namespace core {
+
+// Function to find the edge table a distance index is declared on
+static shared_ptr<PropertyGraphTable>
+GetDistanceIndexEdgeTable(ClientContext &context,
+                          const FunctionParameters &parameters,
+                          string &pg_name) {
+  auto duckpgq_state = GetDuckPGQState(context);
+  auto pg_info = GetPropertyGraphInfo(
+      duckpgq_state, StringValue::Get(parameters.values[0]));
+  pg_name = pg_info->property_graph_name;
+  auto edge_label = StringValue::Get(parameters.values[1]);
+  auto edge_table = pg_info->GetTableByLabel(edge_label, true, false);
+  if (edge_table->is_vertex_table) {
+    throw Exception(ExceptionType::INVALID,
+                    edge_label + " is a vertex table, expected an edge table");
+  }
+  return edge_table;
+}
+
+// The distance index is built from the CSR the first time a path length is
+// looked up after the graph changed, and is kept with the cached CSR. The
+// declaration takes effect once the returned statement commits.
+static string PragmaCreateDistanceIndex(ClientContext &context,
+                                        const FunctionParameters &parameters) {
+  string pg_name;
+  auto edge_table = GetDistanceIndexEdgeTable(context, parameters, pg_name);
+  GetDuckPGQState(context)->distance_index_changes.push_back(
+      {pg_name, edge_table->table_name, true});
+  auto pg_value = KeywordHelper::WriteQuoted(pg_name, '\'');
+  auto table_value = KeywordHelper::WriteQuoted(edge_table->table_name, '\'');
+  return "INSERT INTO __duckpgq_distance_indexes SELECT " + pg_value + ", " +
+         table_value +
+         " WHERE NOT EXISTS (SELECT * FROM __duckpgq_distance_indexes "
+         "WHERE property_graph = " +
+         pg_value + " AND edge_table = " + table_value + ")";
+}
+
+static string PragmaDropDistanceIndex(ClientContext &context,
+                                      const FunctionParameters &parameters) {
+  string pg_name;
+  auto edge_table = GetDistanceIndexEdgeTable(context, parameters, pg_name);
+  GetDuckPGQState(context)->distance_index_changes.push_back(
+      {pg_name, edge_table->table_name, false});
+  return "DELETE FROM __duckpgq_distance_indexes WHERE property_graph = " +
+         KeywordHelper::WriteQuoted(pg_name, '\'') + " AND edge_table = " +
+         KeywordHelper::WriteQuoted(edge_table->table_name, '\'');
+}
+
+void CorePGQPragma::RegisterDistanceIndex(DatabaseInstance &instance) {
+  // PRAGMA create_distance_index('pg', 'edge_label') answers the path-length
+  // predicates of MATCH over the edge table from a distance index
+  ExtensionUtil::RegisterFunction(
+      instance, PragmaFunction::PragmaCall(
+                    "create_distance_index", PragmaCreateDistanceIndex,
+                    {LogicalType::VARCHAR, LogicalType::VARCHAR}));
+  ExtensionUtil::RegisterFunction(
+      instance, PragmaFunction::PragmaCall(
+                    "drop_distance_index", PragmaDropDistanceIndex,
+                    {LogicalType::VARCHAR, LogicalType::VARCHAR}));
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -5,20 +5,143 @@
 #include "duckdb/parser/expression/constant_expression.hpp"
 #include "duckdb/parser/expression/star_expression.hpp"
 #include "duckdb/parser/tableref/basetableref.hpp"
+#include "duckdb/parser/tableref/emptytableref.hpp"
 #include "duckdb/parser/tableref/subqueryref.hpp"
+#include "duckdb/planner/binder.hpp"
 
+#include <duckpgq/core/utils/csr_cache.hpp>
 #include <duckpgq/core/utils/duckpgq_utils.hpp>
 
 namespace duckpgq {
 
 namespace core {
+bool CSR::IsComplete() const {
+  return initialized_v && initialized_e &&
+         inserted_edges.load() == static_cast<int64_t>(EdgeCount());
+}
+
+idx_t CSR::EdgeCount() const {
+  if (compressed) {
+    return static_cast<idx_t>(GetOffset(vsize - 1));
+  }
+  return width == CSRWidth::WIDE ? e.size() : e_narrow.size();
+}
+
+template <class T> static idx_t VectorMemorySize(const vector<T> &values) {
+  return values.capacity() * sizeof(T);
+}
+
+idx_t CSR::MemorySize() const {
+  idx_t size = v ? vsize * sizeof(atomic<int64_t>) : 0;
+  size += VectorMemorySize(e) + VectorMemorySize(edge_ids) +
+          VectorMemorySize(w) + VectorMemorySize(w_double);
+  size += VectorMemorySize(v_narrow) + VectorMemorySize(e_narrow) +
+          VectorMemorySize(edge_ids_narrow);
+  size += VectorMemorySize(list_offsets) + VectorMemorySize(e_compressed);
+  if (reverse) {
+    size += reverse->MemorySize();
+  }
+  return size + distance_index_size.load();
+}
+
+int64_t CSR::GetOffset(idx_t i) const {
+  return width == CSRWidth::NARROW ? v_narrow[i] : v[i].load();
+}
+
+int64_t CSR::GetEdge(idx_t i) const {
+  if (!compressed) {
+    return width == CSRWidth::WIDE ? e[i] : e_narrow[i];
+  }
+  // Decode the neighbor list holding edge i, i.e. the list of the last vertex
+  // whose list starts at or before i
+  idx_t lower = 0;
+  idx_t upper = vsize - 1;
+  while (lower < upper) {
+    auto middle = lower + (upper - lower + 1) / 2;
+    if (GetOffset(middle) <= static_cast<int64_t>(i)) {
+      lower = middle;
+    } else {
+      upper = middle - 1;
+    }
+  }
+  int64_t result = 0;
+  auto find_edge = [&](int64_t neighbor, int64_t offset) {
+    if (offset == static_cast<int64_t>(i)) {
+      result = neighbor;
+    }
+  };
+  if (width == CSRWidth::NARROW) {
+    GetCompressedView<uint32_t>().ForEachNeighbor(lower, find_edge);
+  } else {
+    GetCompressedView<int64_t>().ForEachNeighbor(lower, find_edge);
+  }
+  return result;
+}
+
+void CSR::Widen() {
+  lock_guard<mutex> guard(widen_lock);
+  if ((width == CSRWidth::WIDE && !compressed) ||
+      (v && e.size() == EdgeCount())) {
+    // Neither narrowed nor compressed, or widened before
+    return;
+  }
+  if (width == CSRWidth::NARROW) {
+    auto wide_v = new std::atomic<int64_t>[vsize];
+    for (idx_t i = 0; i < vsize; i++) {
+      wide_v[i] = v_narrow[i];
+    }
+    delete[] v;
+    v = wide_v;
+    edge_ids.assign(edge_ids_narrow.begin(), edge_ids_narrow.end());
+  }
+  if (!compressed) {
+    e.assign(e_narrow.begin(), e_narrow.end());
+    return;
+  }
+  e.resize(EdgeCount());
+  auto decode_edge = [&](int64_t neighbor, int64_t offset) {
+    e[offset] = neighbor;
+  };
+  for (idx_t i = 0; i + 1 < vsize; i++) {
+    if (width == CSRWidth::NARROW) {
+      GetCompressedView<uint32_t>().ForEachNeighbor(i, decode_edge);
+    } else {
+      GetCompressedView<int64_t>().ForEachNeighbor(i, decode_edge);
+    }
+  }
+}
+
+CSR &CSR::GetReverse() {
+  if (symmetric) {
+    return *this;
+  }
+  if (!reverse) {
+    throw ConstraintException(
+        "The reverse CSR has not been built, see create_csr_edge");
+  }
+  return *reverse;
+}
+
+const DistanceIndex &CSR::GetDistanceIndex(ClientContext &context) {
+  lock_guard<mutex> guard(distance_index_lock);
+  if (!distance_index) {
+    if (!IsComplete()) {
+      throw ConstraintException(
+          "Need to initialize CSR before building a distance index");
+    }
+    distance_index = DistanceIndex::Build(context, *this);
+    distance_index_size = distance_index->MemorySize();
+  }
+  return *distance_index;
+}
+
 string CSR::ToString() const {
     std::ostringstream result;
 
     if (initialized_v) {
         result << "v (Node Offsets):\n";
         for (size_t i = 0; i < vsize; i++) {
-            result << "  Node " << i << ": Offset " << v[i].load() << "\n";
+            result << "  Node " << i << ": Offset " << GetOffset(i) << "\n";
         }
     } else {
         result << "v: V has not been initialized\n";
@@ -30,8 +153,8 @@ string CSR::ToString() const {
         result << "e (Edges):\n";
         for (size_t i = 0; i < vsize - 2; i++) {
             result << "  Node " << i << " connects to: ";
-            for (size_t j = v[i].load(); j < v[i + 1].load(); j++) {
-                result << e[j] << " ";
+            for (auto j = GetOffset(i); j < GetOffset(i + 1); j++) {
+                result << GetEdge(j) << " ";
             }
             result << "\n";
         }
@@ -45,7 +168,7 @@ string CSR::ToString() const {
         result << "w (Weights):\n";
         for (size_t i = 0; i < vsize - 1; i++) {
             result << "  Node " << i << " weights: ";
-            for (size_t j = v[i].load(); j < v[i + 1].load(); j++) {
+            for (auto j = GetOffset(i); j < GetOffset(i + 1); j++) {
                 result << w[j] << " ";
             }
             result << "\n";
@@ -58,16 +181,20 @@ string CSR::ToString() const {
 }
 
 CSRFunctionData::CSRFunctionData(ClientContext &context, int32_t id,
-                                 LogicalType weight_type)
-    : context(context), id(id), weight_type(std::move(weight_type)) {}
+                                 LogicalType weight_type, bool build_reverse,
+                                 string cache_key)
+    : context(context), id(id), weight_type(std::move(weight_type)),
+      build_reverse(build_reverse), cache_key(std::move(cache_key)) {}
 
 unique_ptr<FunctionData> CSRFunctionData::Copy() const {
-  return make_uniq<CSRFunctionData>(context, id, weight_type);
+  return make_uniq<CSRFunctionData>(context, id, weight_type, build_reverse,
+                                    cache_key);
 }
 
 bool CSRFunctionData::Equals(const FunctionData &other_p) const {
   auto &other = (const CSRFunctionData &)other_p;
-  return id == other.id && weight_type == other.weight_type;
+  return id == other.id && weight_type == other.weight_type &&
+         build_reverse == other.build_reverse && cache_key == other.cache_key;
 }
 
 unique_ptr<FunctionData>
@@ -96,13 +223,37 @@ CSRFunctionData::CSREdgeBind(ClientContext &context,
     throw InvalidInputException("Id must be constant.");
   }
   Value id = ExpressionExecutor::EvaluateScalar(context, *arguments[0]);
-  if (arguments.size() == 8) {
+  // The optional last argument is the key of the CSR in the CSR cache
+  string cache_key;
+  auto argument_count = arguments.size();
+  if (arguments.back()->return_type == LogicalType::VARCHAR) {
+    if (!arguments.back()->IsFoldable()) {
+      throw InvalidInputException("Cache key must be constant.");
+    }
+    cache_key = ExpressionExecutor::EvaluateScalar(context, *arguments.back())
+                    .GetValue<string>();
+    argument_count--;
+  }
+  // The optional argument before it asks for the reverse CSR
+  bool build_reverse = false;
+  auto &reverse_argument = arguments[argument_count - 1];
+  if (reverse_argument->return_type == LogicalType::BOOLEAN) {
+    if (!reverse_argument->IsFoldable()) {
+      throw InvalidInputException("Reverse flag must be constant.");
+    }
+    build_reverse =
+        ExpressionExecutor::EvaluateScalar(context, *reverse_argument)
+            .GetValue<bool>();
+    argument_count--;
+  }
+  if (argument_count == 8) {
     return make_uniq<CSRFunctionData>(context, id.GetValue<int32_t>(),
-                                      arguments[7]->return_type);
+                                      arguments[7]->return_type,
+                                      build_reverse, cache_key);
   }
   auto logical_type = LogicalType::SQLNULL;
   return make_uniq<CSRFunctionData>(context, id.GetValue<int32_t>(),
-                                    logical_type);
+                                    logical_type, build_reverse, cache_key);
 }
 
 unique_ptr<FunctionData>
@@ -477,7 +628,8 @@ MakeEdgesCTE(const shared_ptr<PropertyGraphTable> &edge_table) {
 // Function to create the CTE for the Undirected CSR
 unique_ptr<CommonTableExpressionInfo>
 CreateUndirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
-                       const unique_ptr<SelectNode> &select_node) {
+                       const unique_ptr<SelectNode> &select_node,
+                       bool with_reverse, const string &cache_key) {
   if (select_node->cte_map.map.find("edges_cte") ==
       select_node->cte_map.map.end()) {
     select_node->cte_map.map["edges_cte"] = MakeEdgesCTE(edge_table);
@@ -508,6 +660,14 @@ CreateUndirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
   csr_edge_children.push_back(std::move(src_rowid_colref));
   csr_edge_children.push_back(std::move(dst_rowid_colref));
   csr_edge_children.push_back(std::move(edge_rowid_colref));
+  if (with_reverse) {
+    csr_edge_children.push_back(
+        make_uniq<ConstantExpression>(Value::BOOLEAN(true)));
+  }
+  if (!cache_key.empty()) {
+    csr_edge_children.push_back(
+        make_uniq<ConstantExpression>(Value(cache_key)));
+  }
 
   auto create_csr_edge_function = make_uniq<FunctionExpression>(
       "create_csr_edge", std::move(csr_edge_children));
@@ -646,7 +806,8 @@ GetCountEdgeTable(const shared_ptr<PropertyGraphTable> &edge_table) {
 unique_ptr<CommonTableExpressionInfo>
 CreateDirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
                      const string &prev_binding, const string &edge_binding,
-                     const string &next_binding) {
+                     const string &next_binding, bool with_reverse,
+                     const string &cache_key) {
   auto csr_edge_id_constant = make_uniq<ConstantExpression>(Value::INTEGER(0));
   auto count_create_edge_select = GetCountTable(
       edge_table->source_pg_table, prev_binding, edge_table->source_pk[0]);
@@ -672,6 +833,14 @@ CreateDirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
   csr_edge_children.push_back(std::move(src_rowid_colref));
   csr_edge_children.push_back(std::move(dst_rowid_colref));
   csr_edge_children.push_back(std::move(edge_rowid_colref));
+  if (with_reverse) {
+    csr_edge_children.push_back(
+        make_uniq<ConstantExpression>(Value::BOOLEAN(true)));
+  }
+  if (!cache_key.empty()) {
+    csr_edge_children.push_back(
+        make_uniq<ConstantExpression>(Value(cache_key)));
+  }
 
   auto create_csr_edge_function = make_uniq<FunctionExpression>(
       "create_csr_edge", std::move(csr_edge_children));
@@ -689,6 +858,63 @@ CreateDirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
   return info;
 }
 
+// Function to create the CTE for a CSR found in the CSR cache, which scans
+// no table. create_csr_edge only installs the cached CSR as CSR 0.
+unique_ptr<CommonTableExpressionInfo>
+CreateCachedCSRCTE(const string &cache_key) {
+  vector<unique_ptr<ParsedExpression>> csr_edge_children;
+  csr_edge_children.push_back(
+      make_uniq<ConstantExpression>(Value::INTEGER(0)));
+  csr_edge_children.push_back(make_uniq<ConstantExpression>(Value(cache_key)));
+  auto create_csr_edge_function = make_uniq<FunctionExpression>(
+      "create_csr_edge", std::move(csr_edge_children));
+  auto outer_select_node =
+      CreateOuterSelectNode(std::move(create_csr_edge_function));
+  outer_select_node->from_table = make_uniq<EmptyTableRef>();
+
+  auto outer_select_statement = make_uniq<SelectStatement>();
+  outer_select_statement->node = std::move(outer_select_node);
+  auto info = make_uniq<CommonTableExpressionInfo>();
+  info->query = std::move(outer_select_statement);
+  return info;
+}
+
+// Function to create the CTE that provides CSR 0 to the query. If the CSR is
+// in the CSR cache when the statement is bound, the CTE only installs it, so
+// neither the tables of the graph are scanned nor the counts of the CSR are
+// computed. Otherwise the CTE builds the CSR and passes its cache key to
+// create_csr_edge, which still takes the CSR from the cache if it got there
+// in the meantime, and else has it published to the cache at the end of the
+// query. The statement is bound again every time it runs, see
+// CSRRequireRebind, so a prepared statement decides on every execution.
+// with_reverse also builds the reverse CSR, which an undirected CSR turns out
+// to be symmetric to. If the edge table has a distance index, iterativelength
+// looks path lengths up in the index of the cached CSR once it is built.
+unique_ptr<CommonTableExpressionInfo>
+CreateCSRCTE(ClientContext &context, const string &pg_name,
+             const shared_ptr<PropertyGraphTable> &edge_table,
+             const unique_ptr<SelectNode> &select_node, bool directed,
+             const string &prev_binding, const string &edge_binding,
+             const string &next_binding, bool with_reverse) {
+  auto cache_key =
+      CSRCache::CreateKey(pg_name, *edge_table, directed, with_reverse);
+  if (GetDuckPGQState(context)->BindCachedCSR(context, cache_key)) {
+    return CreateCachedCSRCTE(cache_key);
+  }
+  if (directed) {
+    return CreateDirectedCSRCTE(edge_table, prev_binding, edge_binding,
+                                next_binding, with_reverse, cache_key);
+  }
+  return CreateUndirectedCSRCTE(edge_table, select_node, with_reverse,
+                                cache_key);
+}
+
+void CSRRequireRebind(TableFunctionBindInput &input) {
+  if (input.binder) {
+    input.binder->SetAlwaysRequireRebind();
+  }
+}
+
 // Function to create a subquery for counting with CTE
 unique_ptr<SubqueryRef> CreateCountCTESubquery() {
   auto temp_cte_select_node = make_uniq<SelectNode>();
@@ -0,0 +1,172 @@
+#include "duckpgq/core/utils/csr_cache.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+shared_ptr<CSRCache> CSRCache::Get(ClientContext &context) {
+  return ObjectCache::GetObjectCache(context).GetOrCreate<CSRCache>(
+      CSRCache::ObjectType());
+}
+
+string CSRCache::CreateKey(const string &pg_name,
+                           const PropertyGraphTable &edge_table, bool directed,
+                           bool with_reverse) {
+  if (StringUtil::Contains(pg_name, "|") ||
+      StringUtil::Contains(edge_table.table_name, "|")) {
+    return "";
+  }
+  return StringUtil::Lower(pg_name) + "|" +
+         StringUtil::Lower(edge_table.table_name) + "|" +
+         (directed ? "directed" : "undirected") +
+         (with_reverse ? "|reverse" : "");
+}
+
+void CSRCache::ParseKey(const string &key, string &pg_name,
+                        string &edge_table) {
+  auto parts = StringUtil::Split(key, '|');
+  D_ASSERT(parts.size() >= 3);
+  pg_name = parts[0];
+  edge_table = parts[1];
+}
+
+idx_t CSRCache::LastChange(const case_insensitive_set_t &tables) const {
+  auto last_change = all_tables_version;
+  for (const auto &table : tables) {
+    auto entry = table_versions.find(table);
+    if (entry != table_versions.end()) {
+      last_change = MaxValue(last_change, entry->second);
+    }
+  }
+  return last_change;
+}
+
+shared_ptr<CSR> CSRCache::Lookup(const string &key, idx_t version_p) {
+  lock_guard<mutex> guard(cache_lock);
+  auto entry = entries.find(key);
+  if (entry == entries.end()) {
+    return nullptr;
+  }
+  if (LastChange(entry->second.tables) > version_p) {
+    // The CSR was built from a newer version of the graph
+    return nullptr;
+  }
+  entry->second.hits++;
+  entry->second.last_use = ++use_clock;
+  return entry->second.csr;
+}
+
+void CSRCache::Insert(const string &key, shared_ptr<CSR> csr,
+                      case_insensitive_set_t tables, idx_t version_p,
+                      idx_t limit) {
+  lock_guard<mutex> guard(cache_lock);
+  if (LastChange(tables) > version_p) {
+    // The graph changed while the CSR was being built
+    return;
+  }
+  if (csr->MemorySize() > limit) {
+    // The CSR does not fit even into the empty cache
+    Evict(limit);
+    return;
+  }
+  auto &entry = entries[key];
+  entry.csr = std::move(csr);
+  entry.tables = std::move(tables);
+  entry.hits = 0;
+  entry.last_use = ++use_clock;
+  Evict(limit);
+}
+
+void CSRCache::Evict(idx_t limit) {
+  idx_t memory_usage = 0;
+  for (auto &entry : entries) {
+    entry.second.memory_usage = entry.second.csr->MemorySize();
+    memory_usage += entry.second.memory_usage;
+  }
+  while (memory_usage > limit) {
+    auto least_recent = entries.begin();
+    for (auto entry = entries.begin(); entry != entries.end(); entry++) {
+      if (entry->second.last_use < least_recent->second.last_use) {
+        least_recent = entry;
+      }
+    }
+    memory_usage -= least_recent->second.memory_usage;
+    entries.erase(least_recent);
+  }
+}
+
+void CSRCache::Invalidate() {
+  lock_guard<mutex> guard(cache_lock);
+  all_tables_version = ++version;
+  entries.clear();
+}
+
+void CSRCache::Invalidate(const case_insensitive_set_t &tables) {
+  lock_guard<mutex> guard(cache_lock);
+  auto new_version = ++version;
+  for (const auto &table : tables) {
+    table_versions[table] = new_version;
+  }
+  for (auto entry = entries.begin(); entry != entries.end();) {
+    if (LastChange(entry->second.tables) == new_version) {
+      entry = entries.erase(entry);
+    } else {
+      entry++;
+    }
+  }
+}
+
+vector<CSRCache::CSRCacheHits> CSRCache::GetHits() {
+  lock_guard<mutex> guard(cache_lock);
+  vector<CSRCacheHits> result;
+  for (const auto &entry : entries) {
+    result.push_back({entry.first, entry.second.hits,
+                      entry.second.csr->distance_index_hits.load(),
+                      entry.second.csr->MemorySize()});
+  }
+  return result;
+}
+
+bool CSRCache::HasDistanceIndex(const string &pg_name,
+                                const string &edge_table) {
+  lock_guard<mutex> guard(cache_lock);
+  auto entry = distance_indexes.find(pg_name);
+  return entry != distance_indexes.end() && entry->second.count(edge_table);
+}
+
+void CSRCache::SetDistanceIndex(const string &pg_name,
+                                const string &edge_table, bool exists) {
+  lock_guard<mutex> guard(cache_lock);
+  if (exists) {
+    distance_indexes[pg_name].insert(edge_table);
+    return;
+  }
+  auto entry = distance_indexes.find(pg_name);
+  if (entry != distance_indexes.end()) {
+    entry->second.erase(edge_table);
+  }
+}
+
+void CSRCache::DropDistanceIndexes(const string &pg_name) {
+  lock_guard<mutex> guard(cache_lock);
+  distance_indexes.erase(pg_name);
+}
+
+bool CSRCache::DistanceIndexesLoaded() {
+  lock_guard<mutex> guard(cache_lock);
+  return distance_indexes_loaded;
+}
+
+void CSRCache::LoadDistanceIndexes(
+    case_insensitive_map_t<case_insensitive_set_t> indexes) {
+  lock_guard<mutex> guard(cache_lock);
+  if (distance_indexes_loaded) {
+    return;
+  }
+  distance_indexes = std::move(indexes);
+  distance_indexes_loaded = true;
+}
+
+} // namespace core
+
+} // namespace duckpgq
@@ -0,0 +1,68 @@
+#include "duckpgq/core/utils/duckpgq_bfs.hpp"
+
+#include <algorithm>
+
+namespace duckpgq {
+namespace core {
+
+idx_t BfsRangeCount(ClientContext &context, int64_t v_size) {
+  auto thread_count = GetThreadCount(context);
+  if (thread_count <= 1 || v_size < 2 * BFS_MIN_RANGE_SIZE) {
+    return 1;
+  }
+  // A few ranges per thread, so threads that finish early steal work
+  auto max_ranges = static_cast<idx_t>(v_size / BFS_MIN_RANGE_SIZE);
+  return MinValue<idx_t>(4 * thread_count, max_ranges);
+}
+
+int64_t BfsRangeSize(int64_t v_size, idx_t range_count) {
+  auto count = static_cast<int64_t>(range_count);
+  return (v_size + count - 1) / count;
+}
+
+void BfsParallelRanges(
+    ClientContext &context, int64_t v_size, idx_t range_count,
+    const std::function<void(idx_t range_idx, int64_t begin, int64_t end)>
+        &range_function) {
+  auto range_size = BfsRangeSize(v_size, range_count);
+  ParallelFor(context, range_count, [&](idx_t range_idx) {
+    auto begin =
+        MinValue<int64_t>(static_cast<int64_t>(range_idx) * range_size, v_size);
+    auto end = MinValue<int64_t>(begin + range_size, v_size);
+    range_function(range_idx, begin, end);
+  });
+}
+
+BfsFrontier::BfsFrontier(ClientContext &context, int64_t v_size,
+                         idx_t range_count)
+    : context(context), v_size(v_size), range_count(range_count),
+      current_listed(false), stale_listed(false) {}
+
+void BfsFrontier::Start(vector<int64_t> sources) {
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+  current = std::move(sources);
+  current_listed = true;
+  // next may still hold the lanes of the previous search
+  stale.clear();
+  stale_listed = false;
+}
+
+void BfsFrontier::SetFrontier(vector<int64_t> vertices, bool listed) {
+  // visit becomes next of the following step
+  std::swap(stale, current);
+  stale_listed = current_listed;
+  current = std::move(vertices);
+  current_listed = listed;
+}
+
+idx_t BfsFrontier::Advance() {
+  vector<int64_t> reached = touched;
+  std::sort(reached.begin(), reached.end());
+  auto count = reached.size();
+  SetFrontier(std::move(reached), true);
+  return count;
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,255 @@
+#include "duckpgq/core/utils/duckpgq_distance_index.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+#include "duckpgq/core/utils/duckpgq_bfs.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+
+#include <numeric>
+
+namespace duckpgq {
+namespace core {
+
+//! Distance of a vertex a search has not reached
+static constexpr uint32_t DISTANCE_INDEX_UNREACHED =
+    std::numeric_limits<uint32_t>::max();
+
+//! Adjacency lists with 32-bit vertex ids, read from the CSR once so the
+//! searches of all hubs and the reverse edges share one layout
+struct DistanceIndexGraph {
+  vector<uint64_t> offsets;
+  vector<uint32_t> targets;
+};
+
+struct DistanceIndexAdjacency {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, ClientContext &context,
+                        idx_t vertex_count, DistanceIndexGraph &graph) {
+    graph.offsets.resize(vertex_count + 1);
+    graph.offsets[0] = 0;
+    for (idx_t v = 0; v < vertex_count; v++) {
+      graph.offsets[v + 1] = graph.offsets[v] + csr.Degree(v);
+    }
+    graph.targets.resize(graph.offsets[vertex_count]);
+    // Every range of vertices writes its own part of the targets
+    auto v_size = static_cast<int64_t>(vertex_count);
+    auto range_count = BfsRangeCount(context, v_size);
+    auto range_size = BfsRangeSize(v_size, range_count);
+    ParallelFor(context, range_count, [&](idx_t range_idx) {
+      auto begin = MinValue<int64_t>(
+          static_cast<int64_t>(range_idx) * range_size, v_size);
+      auto end = MinValue<int64_t>(begin + range_size, v_size);
+      for (auto v = begin; v < end; v++) {
+        auto position = graph.offsets[v];
+        csr.ForEachNeighbor(v, [&](int64_t neighbor, int64_t) {
+          graph.targets[position++] = static_cast<uint32_t>(neighbor);
+        });
+      }
+    });
+  }
+};
+
+//! The graph with every edge turned around
+static DistanceIndexGraph TransposeGraph(const DistanceIndexGraph &graph,
+                                         idx_t vertex_count) {
+  DistanceIndexGraph transposed;
+  transposed.offsets.assign(vertex_count + 1, 0);
+  for (auto target : graph.targets) {
+    transposed.offsets[target + 1]++;
+  }
+  for (idx_t v = 0; v < vertex_count; v++) {
+    transposed.offsets[v + 1] += transposed.offsets[v];
+  }
+  transposed.targets.resize(graph.targets.size());
+  auto positions = transposed.offsets;
+  for (idx_t v = 0; v < vertex_count; v++) {
+    for (auto o = graph.offsets[v]; o < graph.offsets[v + 1]; o++) {
+      transposed.targets[positions[graph.targets[o]]++] =
+          static_cast<uint32_t>(v);
+    }
+  }
+  return transposed;
+}
+
+//! Breadth-first search from hub along the edges of graph, which adds the
+//! distance from the hub to the target labels of every vertex it reaches.
+//! Vertices whose distance the labels of the earlier hubs already give are
+//! not labeled and not expanded. hub_distance and distance are all
+//! DISTANCE_INDEX_UNREACHED before and after the search.
+template <class LABEL_ENTRY>
+static void PrunedSearch(const DistanceIndexGraph &graph, uint32_t hub,
+                         uint32_t rank,
+                         const vector<vector<LABEL_ENTRY>> &source_labels,
+                         vector<vector<LABEL_ENTRY>> &target_labels,
+                         vector<uint32_t> &hub_distance,
+                         vector<uint32_t> &distance, vector<uint32_t> &queue) {
+  // The labels of the hub itself, indexed by hub rank
+  auto hub_label_count = source_labels[hub].size();
+  for (idx_t i = 0; i < hub_label_count; i++) {
+    auto &entry = source_labels[hub][i];
+    hub_distance[entry.hub] = entry.distance;
+  }
+
+  queue.clear();
+  queue.push_back(hub);
+  distance[hub] = 0;
+  for (idx_t head = 0; head < queue.size(); head++) {
+    auto v = queue[head];
+    auto d = distance[v];
+    bool covered = false;
+    for (auto &entry : target_labels[v]) {
+      if (hub_distance[entry.hub] != DISTANCE_INDEX_UNREACHED &&
+          static_cast<uint64_t>(hub_distance[entry.hub]) + entry.distance <=
+              d) {
+        covered = true;
+        break;
+      }
+    }
+    if (covered) {
+      continue;
+    }
+    target_labels[v].push_back({rank, d});
+    for (auto o = graph.offsets[v]; o < graph.offsets[v + 1]; o++) {
+      auto neighbor = graph.targets[o];
+      if (distance[neighbor] == DISTANCE_INDEX_UNREACHED) {
+        distance[neighbor] = d + 1;
+        queue.push_back(neighbor);
+      }
+    }
+  }
+
+  for (auto v : queue) {
+    distance[v] = DISTANCE_INDEX_UNREACHED;
+  }
+  // The hub may have labeled itself, which leaves the new entry unset
+  for (idx_t i = 0; i < hub_label_count; i++) {
+    hub_distance[source_labels[hub][i].hub] = DISTANCE_INDEX_UNREACHED;
+  }
+}
+
+unique_ptr<DistanceIndex> DistanceIndex::Build(ClientContext &context,
+                                               const CSR &csr) {
+  D_ASSERT(csr.IsComplete());
+  idx_t vertex_count = csr.vsize - 2;
+  if (vertex_count >= DISTANCE_INDEX_UNREACHED) {
+    throw NotImplementedException(
+        "Distance indexes support fewer than 2^32 - 1 vertices");
+  }
+  auto index = make_uniq<DistanceIndex>();
+  index->vertex_count = vertex_count;
+  index->symmetric = csr.symmetric;
+
+  DistanceIndexGraph out_graph;
+  TemplatedCSRDispatch<DistanceIndexAdjacency>(csr, context, vertex_count,
+                                               out_graph);
+  DistanceIndexGraph in_graph;
+  if (!index->symmetric) {
+    in_graph = TransposeGraph(out_graph, vertex_count);
+  }
+
+  // Vertices of high degree lie on many shortest paths, and make the labels
+  // of the later hubs small
+  vector<uint64_t> degrees(vertex_count);
+  for (idx_t v = 0; v < vertex_count; v++) {
+    degrees[v] = out_graph.offsets[v + 1] - out_graph.offsets[v];
+    if (!index->symmetric) {
+      degrees[v] += in_graph.offsets[v + 1] - in_graph.offsets[v];
+    }
+  }
+  vector<uint32_t> order(vertex_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return degrees[a] > degrees[b];
+                   });
+
+  vector<vector<LabelEntry>> out_labels(vertex_count);
+  vector<vector<LabelEntry>> in_labels(index->symmetric ? 0 : vertex_count);
+  vector<uint32_t> hub_distance(vertex_count, DISTANCE_INDEX_UNREACHED);
+  vector<uint32_t> distance(vertex_count, DISTANCE_INDEX_UNREACHED);
+  vector<uint32_t> queue;
+  queue.reserve(vertex_count);
+  for (uint32_t rank = 0; rank < vertex_count; rank++) {
+    if (context.interrupted) {
+      throw InterruptException();
+    }
+    auto hub = order[rank];
+    if (index->symmetric) {
+      PrunedSearch(out_graph, hub, rank, out_labels, out_labels, hub_distance,
+                   distance, queue);
+      continue;
+    }
+    // The paths starting at the hub label the vertices they end at, and the
+    // paths ending at the hub the vertices they start at
+    PrunedSearch(out_graph, hub, rank, out_labels, in_labels, hub_distance,
+                 distance, queue);
+    PrunedSearch(in_graph, hub, rank, in_labels, out_labels, hub_distance,
+                 distance, queue);
+  }
+
+  index->out_labels = Flatten(out_labels);
+  if (!index->symmetric) {
+    index->in_labels = Flatten(in_labels);
+  }
+  return index;
+}
+
+DistanceIndex::Labels
+DistanceIndex::Flatten(vector<vector<LabelEntry>> &labels) {
+  Labels result;
+  result.offsets.resize(labels.size() + 1);
+  result.offsets[0] = 0;
+  for (idx_t v = 0; v < labels.size(); v++) {
+    result.offsets[v + 1] = result.offsets[v] + labels[v].size();
+  }
+  result.entries.reserve(result.offsets[labels.size()]);
+  for (auto &label : labels) {
+    result.entries.insert(result.entries.end(), label.begin(), label.end());
+    vector<LabelEntry>().swap(label);
+  }
+  return result;
+}
+
+int64_t DistanceIndex::Query(int64_t source, int64_t destination) const {
+  D_ASSERT(source >= 0 && static_cast<idx_t>(source) < vertex_count);
+  D_ASSERT(destination >= 0 &&
+           static_cast<idx_t>(destination) < vertex_count);
+  if (source == destination) {
+    return 0;
+  }
+  auto &to_labels = symmetric ? out_labels : in_labels;
+  auto i = out_labels.offsets[source];
+  auto i_end = out_labels.offsets[source + 1];
+  auto j = to_labels.offsets[destination];
+  auto j_end = to_labels.offsets[destination + 1];
+  auto best = NumericLimits<uint64_t>::Maximum();
+  // Both labels are sorted by hub, so the shared hubs are found by merging
+  while (i < i_end && j < j_end) {
+    auto &from = out_labels.entries[i];
+    auto &to = to_labels.entries[j];
+    if (from.hub == to.hub) {
+      best = MinValue<uint64_t>(best, static_cast<uint64_t>(from.distance) +
+                                          to.distance);
+      i++;
+      j++;
+    } else if (from.hub < to.hub) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+  return best == NumericLimits<uint64_t>::Maximum()
+             ? -1
+             : static_cast<int64_t>(best);
+}
+
+idx_t DistanceIndex::LabelCount() const {
+  return out_labels.entries.size() + in_labels.entries.size();
+}
+
+idx_t DistanceIndex::MemorySize() const {
+  return (out_labels.offsets.size() + in_labels.offsets.size()) *
+             sizeof(uint64_t) +
+         LabelCount() * sizeof(LabelEntry);
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,221 @@
+#include "duckpgq/core/utils/duckpgq_lane_bitset.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define DUCKPGQ_LANE_BITSET_X86
+#include <immintrin.h>
+#endif
+
+namespace duckpgq {
+namespace core {
+
+//===--------------------------------------------------------------------===//
+// Scalar kernels
+//===--------------------------------------------------------------------===//
+template <idx_t LANES>
+static idx_t MarkSeenScalar(LaneBitset<LANES> *next, LaneBitset<LANES> *seen,
+                            idx_t count) {
+  static_assert(sizeof(LaneBitset<LANES>) == LANES / 8,
+                "LaneBitset must not be padded");
+  idx_t reached = 0;
+  for (idx_t i = 0; i < count; i++) {
+    typename LaneBitset<LANES>::word_t any = 0;
+    for (idx_t w = 0; w < LaneBitset<LANES>::WORDS; w++) {
+      next[i].words[w] &= ~seen[i].words[w];
+      seen[i].words[w] |= next[i].words[w];
+      any |= next[i].words[w];
+    }
+    reached += any != 0;
+  }
+  return reached;
+}
+
+template <idx_t LANES>
+static LaneBitset<LANES> IntersectScalar(const LaneBitset<LANES> *a,
+                                         const LaneBitset<LANES> *b,
+                                         idx_t count) {
+  LaneBitset<LANES> result;
+  for (idx_t i = 0; i < count; i++) {
+    for (idx_t w = 0; w < LaneBitset<LANES>::WORDS; w++) {
+      result.words[w] |= a[i].words[w] & b[i].words[w];
+    }
+  }
+  return result;
+}
+
+#ifdef DUCKPGQ_LANE_BITSET_X86
+//===--------------------------------------------------------------------===//
+// AVX2 kernels, four words per register, for 256 lanes and more
+//===--------------------------------------------------------------------===//
+// The bitsets of a vector are not guaranteed to be aligned to their size
+// before C++17, so all kernels use unaligned loads and stores.
+template <idx_t LANES>
+__attribute__((target("avx2"))) static idx_t
+MarkSeenAVX2(LaneBitset<LANES> *next, LaneBitset<LANES> *seen, idx_t count) {
+  idx_t reached = 0;
+  for (idx_t i = 0; i < count; i++) {
+    auto next_words = reinterpret_cast<__m256i *>(next[i].words);
+    auto seen_words = reinterpret_cast<__m256i *>(seen[i].words);
+    __m256i any = _mm256_setzero_si256();
+    for (idx_t r = 0; r < LANES / 256; r++) {
+      __m256i n = _mm256_loadu_si256(next_words + r);
+      __m256i s = _mm256_loadu_si256(seen_words + r);
+      n = _mm256_andnot_si256(s, n);
+      _mm256_storeu_si256(next_words + r, n);
+      _mm256_storeu_si256(seen_words + r, _mm256_or_si256(s, n));
+      any = _mm256_or_si256(any, n);
+    }
+    reached += !_mm256_testz_si256(any, any);
+  }
+  return reached;
+}
+
+template <idx_t LANES>
+__attribute__((target("avx2"))) static LaneBitset<LANES>
+IntersectAVX2(const LaneBitset<LANES> *a, const LaneBitset<LANES> *b,
+              idx_t count) {
+  __m256i acc[LANES / 256];
+  for (idx_t r = 0; r < LANES / 256; r++) {
+    acc[r] = _mm256_setzero_si256();
+  }
+  for (idx_t i = 0; i < count; i++) {
+    auto a_words = reinterpret_cast<const __m256i *>(a[i].words);
+    auto b_words = reinterpret_cast<const __m256i *>(b[i].words);
+    for (idx_t r = 0; r < LANES / 256; r++) {
+      __m256i both = _mm256_and_si256(_mm256_loadu_si256(a_words + r),
+                                      _mm256_loadu_si256(b_words + r));
+      acc[r] = _mm256_or_si256(acc[r], both);
+    }
+  }
+  LaneBitset<LANES> result;
+  auto result_words = reinterpret_cast<__m256i *>(result.words);
+  for (idx_t r = 0; r < LANES / 256; r++) {
+    _mm256_storeu_si256(result_words + r, acc[r]);
+  }
+  return result;
+}
+
+//===--------------------------------------------------------------------===//
+// AVX-512 kernels, eight words per register, for 512 lanes and more
+//===--------------------------------------------------------------------===//
+template <idx_t LANES>
+__attribute__((target("avx512f"))) static idx_t
+MarkSeenAVX512(LaneBitset<LANES> *next, LaneBitset<LANES> *seen,
+               idx_t count) {
+  idx_t reached = 0;
+  for (idx_t i = 0; i < count; i++) {
+    __mmask8 any = 0;
+    for (idx_t r = 0; r < LANES / 512; r++) {
+      auto next_words = next[i].words + 8 * r;
+      auto seen_words = seen[i].words + 8 * r;
+      __m512i n = _mm512_loadu_si512(next_words);
+      __m512i s = _mm512_loadu_si512(seen_words);
+      n = _mm512_maskz_andnot_epi64(0xFF, s, n);
+      _mm512_storeu_si512(next_words, n);
+      _mm512_storeu_si512(seen_words, _mm512_or_si512(s, n));
+      any |= _mm512_test_epi64_mask(n, n);
+    }
+    reached += any != 0;
+  }
+  return reached;
+}
+
+template <idx_t LANES>
+__attribute__((target("avx512f"))) static LaneBitset<LANES>
+IntersectAVX512(const LaneBitset<LANES> *a, const LaneBitset<LANES> *b,
+                idx_t count) {
+  __m512i acc[LANES / 512];
+  for (idx_t r = 0; r < LANES / 512; r++) {
+    acc[r] = _mm512_setzero_si512();
+  }
+  for (idx_t i = 0; i < count; i++) {
+    for (idx_t r = 0; r < LANES / 512; r++) {
+      acc[r] = _mm512_or_si512(
+          acc[r], _mm512_and_si512(_mm512_loadu_si512(a[i].words + 8 * r),
+                                   _mm512_loadu_si512(b[i].words + 8 * r)));
+    }
+  }
+  LaneBitset<LANES> result;
+  for (idx_t r = 0; r < LANES / 512; r++) {
+    _mm512_storeu_si512(result.words + 8 * r, acc[r]);
+  }
+  return result;
+}
+#endif
+
+//===--------------------------------------------------------------------===//
+// Runtime dispatch
+//===--------------------------------------------------------------------===//
+template <idx_t LANES> struct LaneBitsetKernels {
+  idx_t (*mark_seen)(LaneBitset<LANES> *next, LaneBitset<LANES> *seen,
+                     idx_t count);
+  LaneBitset<LANES> (*intersect)(const LaneBitset<LANES> *a,
+                                 const LaneBitset<LANES> *b, idx_t count);
+};
+
+// Widths below a register are left to the scalar kernels, which the compiler
+// vectorizes over the words of consecutive vertices
+template <idx_t LANES> static LaneBitsetKernels<LANES> SelectKernels() {
+  return {MarkSeenScalar<LANES>, IntersectScalar<LANES>};
+}
+
+// Picks the widest kernels the CPU supports, once per process and width
+template <> LaneBitsetKernels<256> SelectKernels<256>() {
+#ifdef DUCKPGQ_LANE_BITSET_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {MarkSeenAVX2<256>, IntersectAVX2<256>};
+  }
+#endif
+  return {MarkSeenScalar<256>, IntersectScalar<256>};
+}
+
+template <> LaneBitsetKernels<512> SelectKernels<512>() {
+#ifdef DUCKPGQ_LANE_BITSET_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return {MarkSeenAVX512<512>, IntersectAVX512<512>};
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return {MarkSeenAVX2<512>, IntersectAVX2<512>};
+  }
+#endif
+  return {MarkSeenScalar<512>, IntersectScalar<512>};
+}
+
+template <idx_t LANES>
+static const LaneBitsetKernels<LANES> &GetKernels() {
+  static const LaneBitsetKernels<LANES> kernels = SelectKernels<LANES>();
+  return kernels;
+}
+
+template <idx_t LANES>
+idx_t LaneBitsetMarkSeen(LaneBitset<LANES> *next, LaneBitset<LANES> *seen,
+                         idx_t count) {
+  return GetKernels<LANES>().mark_seen(next, seen, count);
+}
+
+template <idx_t LANES>
+LaneBitset<LANES> LaneBitsetIntersect(const LaneBitset<LANES> *a,
+                                      const LaneBitset<LANES> *b,
+                                      idx_t count) {
+  return GetKernels<LANES>().intersect(a, b, count);
+}
+
+// The lane widths of LaneWidthDispatch
+#define INSTANTIATE_LANE_BITSET_KERNELS(LANES)                                 \
+  template idx_t LaneBitsetMarkSeen<LANES>(                                    \
+      LaneBitset<LANES> *next, LaneBitset<LANES> *seen, idx_t count);          \
+  template LaneBitset<LANES> LaneBitsetIntersect<LANES>(                       \
+      const LaneBitset<LANES> *a, const LaneBitset<LANES> *b, idx_t count);
+
+INSTANTIATE_LANE_BITSET_KERNELS(8)
+INSTANTIATE_LANE_BITSET_KERNELS(16)
+INSTANTIATE_LANE_BITSET_KERNELS(32)
+INSTANTIATE_LANE_BITSET_KERNELS(64)
+INSTANTIATE_LANE_BITSET_KERNELS(128)
+INSTANTIATE_LANE_BITSET_KERNELS(256)
+INSTANTIATE_LANE_BITSET_KERNELS(512)
+
+} // namespace core
+} // namespace duckpgq
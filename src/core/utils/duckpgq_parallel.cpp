@@ -0,0 +1,133 @@
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+#include "duckdb/parallel/task_executor.hpp"
+#include "duckdb/parallel/task_scheduler.hpp"
+
+namespace duckpgq {
+namespace core {
+
+class ParallelForTask : public BaseExecutorTask {
+public:
+  ParallelForTask(TaskExecutor &executor, atomic<idx_t> &next_morsel,
+                  idx_t morsel_count,
+                  const std::function<void(idx_t)> &morsel_function)
+      : BaseExecutorTask(executor), next_morsel(next_morsel),
+        morsel_count(morsel_count), morsel_function(morsel_function) {}
+
+  void ExecuteTask() override {
+    for (idx_t morsel_idx = next_morsel++; morsel_idx < morsel_count;
+         morsel_idx = next_morsel++) {
+      morsel_function(morsel_idx);
+    }
+  }
+
+private:
+  atomic<idx_t> &next_morsel;
+  idx_t morsel_count;
+  const std::function<void(idx_t)> &morsel_function;
+};
+
+idx_t GetThreadCount(ClientContext &context) {
+  auto thread_count = TaskScheduler::GetScheduler(context).NumberOfThreads();
+  return thread_count > 0 ? static_cast<idx_t>(thread_count) : 1;
+}
+
+void ParallelFor(ClientContext &context, idx_t morsel_count,
+                 const std::function<void(idx_t morsel_idx)> &morsel_function) {
+  auto task_count = MinValue<idx_t>(GetThreadCount(context), morsel_count);
+  if (task_count <= 1) {
+    for (idx_t morsel_idx = 0; morsel_idx < morsel_count; morsel_idx++) {
+      morsel_function(morsel_idx);
+    }
+    return;
+  }
+  atomic<idx_t> next_morsel{0};
+  TaskExecutor executor(context);
+  for (idx_t task_idx = 0; task_idx < task_count; task_idx++) {
+    executor.ScheduleTask(make_uniq<ParallelForTask>(
+        executor, next_morsel, morsel_count, morsel_function));
+  }
+  executor.WorkOnTasks();
+}
+
+void SharedComputation::Run(const std::function<void()> &compute) {
+  unique_lock<mutex> guard(lock);
+  if (!started) {
+    started = true;
+    guard.unlock();
+    std::exception_ptr compute_error;
+    try {
+      compute();
+    } catch (...) {
+      compute_error = std::current_exception();
+    }
+    guard.lock();
+    done = true;
+    error = compute_error;
+    changed.notify_all();
+    guard.unlock();
+    if (compute_error) {
+      std::rethrow_exception(compute_error);
+    }
+    return;
+  }
+  // Help with every phase once, a phase whose morsels are all claimed only
+  // has to be waited for
+  shared_ptr<Phase> helped;
+  while (!done) {
+    if (phase && phase != helped) {
+      helped = phase;
+      guard.unlock();
+      Work(*helped);
+      guard.lock();
+      continue;
+    }
+    changed.wait(guard);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void SharedComputation::ParallelFor(
+    ClientContext &context, idx_t morsel_count,
+    const std::function<void(idx_t morsel_idx)> &morsel_function) {
+  auto current = make_shared_ptr<Phase>(morsel_count, morsel_function);
+  {
+    lock_guard<mutex> guard(lock);
+    phase = current;
+    changed.notify_all();
+  }
+  // The idle worker threads take morsels through the task scheduler
+  core::ParallelFor(context, GetThreadCount(context),
+                    [&](idx_t) { Work(*current); });
+  unique_lock<mutex> guard(lock);
+  changed.wait(guard, [&]() {
+    return current->finished_morsels.load() == current->morsel_count;
+  });
+  phase.reset();
+  guard.unlock();
+  if (current->error) {
+    std::rethrow_exception(current->error);
+  }
+}
+
+void SharedComputation::Work(Phase &phase) {
+  for (idx_t morsel_idx = phase.next_morsel++;
+       morsel_idx < phase.morsel_count; morsel_idx = phase.next_morsel++) {
+    try {
+      phase.morsel_function(morsel_idx);
+    } catch (...) {
+      lock_guard<mutex> guard(phase.error_lock);
+      if (!phase.error) {
+        phase.error = std::current_exception();
+      }
+    }
+    if (++phase.finished_morsels == phase.morsel_count) {
+      lock_guard<mutex> guard(lock);
+      changed.notify_all();
+    }
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,49 @@
+#include "duckpgq/core/utils/duckpgq_path_searches.hpp"
+#include "duckdb/common/types/hash.hpp"
+
+namespace duckpgq {
+namespace core {
+
+namespace {
+struct PathSearchKeyHash {
+  size_t operator()(const pair<int64_t, int64_t> &key) const {
+    return CombineHash(Hash(key.first), Hash(key.second));
+  }
+};
+} // namespace
+
+PathSearches GroupPathSearches(idx_t count,
+                               const UnifiedVectorFormat &vdata_src,
+                               const int64_t *src_data,
+                               const UnifiedVectorFormat &vdata_dst,
+                               const int64_t *dst_data, bool by_destination) {
+  PathSearches result;
+  // Without by_destination all keys have the same destination
+  unordered_map<pair<int64_t, int64_t>, idx_t, PathSearchKeyHash> search_idx;
+  for (idx_t i = 0; i < count; i++) {
+    auto src_index = vdata_src.sel->get_index(i);
+    auto dst_index = vdata_dst.sel->get_index(i);
+    if (!vdata_src.validity.RowIsValid(src_index) ||
+        !vdata_dst.validity.RowIsValid(dst_index)) {
+      result.null_rows.push_back(i);
+      continue;
+    }
+    auto source = src_data[src_index];
+    auto destination = by_destination ? dst_data[dst_index] : 0;
+    pair<int64_t, int64_t> key(source, destination);
+    auto entry = search_idx.find(key);
+    if (entry == search_idx.end()) {
+      entry = search_idx.emplace(key, result.sources.size()).first;
+      result.sources.push_back(source);
+      if (by_destination) {
+        result.destinations.push_back(destination);
+      }
+      result.rows.emplace_back();
+    }
+    result.rows[entry->second].push_back(i);
+  }
+  return result;
+}
+
+} // namespace core
+} // namespace duckpgq
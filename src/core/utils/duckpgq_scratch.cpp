@@ -0,0 +1,89 @@
+#include "duckpgq/core/utils/duckpgq_scratch.hpp"
+
+namespace duckpgq {
+namespace core {
+
+ScratchBuffer::ScratchBuffer(ScratchPool &pool, idx_t size_class, bool zeroed,
+                             BufferHandle handle)
+    : pool(&pool), size_class(size_class), zeroed(zeroed),
+      handle(std::move(handle)) {
+  auto ptr = reinterpret_cast<uintptr_t>(this->handle.Ptr());
+  auto misalignment = ptr % SCRATCH_ALIGNMENT;
+  data = this->handle.Ptr() +
+         (misalignment ? SCRATCH_ALIGNMENT - misalignment : 0);
+}
+
+ScratchBuffer::ScratchBuffer(ScratchBuffer &&other) noexcept
+    : pool(other.pool), size_class(other.size_class), zeroed(other.zeroed),
+      handle(std::move(other.handle)), data(other.data) {
+  other.pool = nullptr;
+}
+
+ScratchBuffer::~ScratchBuffer() {
+  if (pool) {
+    pool->Release(size_class, zeroed, std::move(handle));
+  }
+}
+
+static idx_t ScratchSizeClass(idx_t size) {
+  // Leave room to align the start of the buffer
+  auto needed = size + SCRATCH_ALIGNMENT;
+  idx_t size_class = SCRATCH_MIN_SIZE_CLASS;
+  while ((idx_t(1) << size_class) < needed) {
+    size_class++;
+  }
+  return size_class;
+}
+
+ScratchBuffer ScratchPool::Acquire(idx_t size) {
+  auto size_class = ScratchSizeClass(size);
+  {
+    lock_guard<mutex> guard(pool_lock);
+    auto &free_list = free_buffers[size_class];
+    if (!free_list.empty()) {
+      auto handle = std::move(free_list.back());
+      free_list.pop_back();
+      return ScratchBuffer(*this, size_class, false, std::move(handle));
+    }
+  }
+  // Throws once the memory limit is reached
+  auto handle = buffer_manager.Allocate(MemoryTag::EXTENSION,
+                                        idx_t(1) << size_class, false);
+  return ScratchBuffer(*this, size_class, false, std::move(handle));
+}
+
+ScratchBuffer ScratchPool::AcquireZeroed(idx_t size) {
+  auto size_class = ScratchSizeClass(size);
+  {
+    lock_guard<mutex> guard(pool_lock);
+    auto &free_list = zeroed_buffers[size_class];
+    if (!free_list.empty()) {
+      auto handle = std::move(free_list.back());
+      free_list.pop_back();
+      return ScratchBuffer(*this, size_class, true, std::move(handle));
+    }
+  }
+  auto handle = buffer_manager.Allocate(MemoryTag::EXTENSION,
+                                        idx_t(1) << size_class, false);
+  std::memset(handle.Ptr(), 0, idx_t(1) << size_class);
+  return ScratchBuffer(*this, size_class, true, std::move(handle));
+}
+
+void ScratchPool::Release(idx_t size_class, bool zeroed, BufferHandle handle) {
+  lock_guard<mutex> guard(pool_lock);
+  auto &free_list =
+      zeroed ? zeroed_buffers[size_class] : free_buffers[size_class];
+  free_list.push_back(std::move(handle));
+}
+
+void ScratchPool::Clear() {
+  lock_guard<mutex> guard(pool_lock);
+  for (idx_t size_class = 0; size_class < SCRATCH_SIZE_CLASSES;
+       size_class++) {
+    free_buffers[size_class].clear();
+    zeroed_buffers[size_class].clear();
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
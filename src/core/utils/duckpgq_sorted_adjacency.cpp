@@ -0,0 +1,135 @@
+#include "duckpgq/core/utils/duckpgq_sorted_adjacency.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+#include "duckpgq/core/utils/duckpgq_bfs.hpp"
+
+namespace duckpgq {
+namespace core {
+
+struct SortedAdjacencyCopy {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, int64_t begin, int64_t end,
+                        const vector<uint64_t> &offsets,
+                        vector<int64_t> &targets) {
+    for (auto v = begin; v < end; v++) {
+      auto position = offsets[v];
+      csr.ForEachNeighbor(v, [&](int64_t neighbor, int64_t) {
+        targets[position++] = neighbor;
+      });
+      std::sort(targets.begin() + offsets[v], targets.begin() + position);
+    }
+  }
+};
+
+//! Copies the neighbors of higher degree, ties broken by id, to the start of
+//! the space of every vertex, and returns the length of every list
+struct SortedAdjacencyOrient {
+  template <class CSR_VIEW>
+  static void Operation(const CSR_VIEW &csr, int64_t begin, int64_t end,
+                        const vector<uint64_t> &offsets,
+                        vector<int64_t> &targets, vector<uint64_t> &lengths) {
+    auto higher = [&](int64_t v, int64_t neighbor) {
+      auto degree = offsets[v + 1] - offsets[v];
+      auto neighbor_degree = offsets[neighbor + 1] - offsets[neighbor];
+      return neighbor_degree > degree ||
+             (neighbor_degree == degree && neighbor > v);
+    };
+    for (auto v = begin; v < end; v++) {
+      auto position = offsets[v];
+      csr.ForEachNeighbor(v, [&](int64_t neighbor, int64_t) {
+        if (higher(v, neighbor)) {
+          targets[position++] = neighbor;
+        }
+      });
+      auto list_begin = targets.begin() + offsets[v];
+      std::sort(list_begin, targets.begin() + position);
+      lengths[v] = std::unique(list_begin, targets.begin() + position) -
+                   list_begin;
+    }
+  }
+};
+
+void SortedAdjacency::Build(ClientContext &context, const CSR &csr,
+                            SharedComputation &computation, bool oriented) {
+  D_ASSERT(csr.IsComplete());
+  // The two vertices after the last one have no edges
+  auto vertex_count = static_cast<int64_t>(csr.vsize) - 2;
+  offsets.resize(vertex_count + 1);
+  offsets[0] = 0;
+  for (int64_t v = 0; v < vertex_count; v++) {
+    offsets[v + 1] = csr.GetOffset(v + 1);
+  }
+  targets.resize(offsets[vertex_count]);
+
+  auto range_count = BfsRangeCount(context, vertex_count);
+  auto range_size = BfsRangeSize(vertex_count, range_count);
+  auto parallel_ranges =
+      [&](const std::function<void(int64_t, int64_t)> &function) {
+        computation.ParallelFor(context, range_count, [&](idx_t range_idx) {
+          auto begin = MinValue<int64_t>(
+              static_cast<int64_t>(range_idx) * range_size, vertex_count);
+          function(begin, MinValue<int64_t>(begin + range_size, vertex_count));
+        });
+      };
+  if (!oriented) {
+    parallel_ranges([&](int64_t begin, int64_t end) {
+      TemplatedCSRDispatch<SortedAdjacencyCopy>(csr, begin, end, offsets,
+                                                targets);
+    });
+    return;
+  }
+
+  // The lists are shortened in place, then moved together
+  vector<uint64_t> lengths(vertex_count);
+  parallel_ranges([&](int64_t begin, int64_t end) {
+    TemplatedCSRDispatch<SortedAdjacencyOrient>(csr, begin, end, offsets,
+                                                targets, lengths);
+  });
+  vector<uint64_t> oriented_offsets(vertex_count + 1);
+  oriented_offsets[0] = 0;
+  for (int64_t v = 0; v < vertex_count; v++) {
+    oriented_offsets[v + 1] = oriented_offsets[v] + lengths[v];
+  }
+  vector<int64_t> oriented_targets(oriented_offsets[vertex_count]);
+  parallel_ranges([&](int64_t begin, int64_t end) {
+    for (auto v = begin; v < end; v++) {
+      std::copy(targets.begin() + offsets[v],
+                targets.begin() + offsets[v] + lengths[v],
+                oriented_targets.begin() + oriented_offsets[v]);
+    }
+  });
+  offsets = std::move(oriented_offsets);
+  targets = std::move(oriented_targets);
+}
+
+idx_t CountContained(const int64_t *a, const int64_t *a_end, const int64_t *b,
+                     const int64_t *b_end) {
+  idx_t count = 0;
+  if (a_end - a <= b_end - b) {
+    while (a < a_end && b < b_end) {
+      b = Gallop(b, b_end, *a);
+      if (b == b_end) {
+        break;
+      }
+      auto value = *a;
+      auto contained = *b == value;
+      for (; a < a_end && *a == value; a++) {
+        count += contained;
+      }
+    }
+    return count;
+  }
+  // Every distinct value of b counts its run in a
+  while (a < a_end && b < b_end) {
+    auto value = *b;
+    a = Gallop(a, a_end, value);
+    auto run_end = Gallop(a, a_end, value + 1);
+    count += static_cast<idx_t>(run_end - a);
+    a = run_end;
+    for (; b < b_end && *b == value; b++) {
+    }
+  }
+  return count;
+}
+
+} // namespace core
+} // namespace duckpgq
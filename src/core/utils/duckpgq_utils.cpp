@@ -61,7 +61,8 @@ ValidateSourceNodeAndEdgeTable(CreatePropertyGraphInfo *pg_info,
 // Function to create the SELECT node
 unique_ptr<SelectNode>
 CreateSelectNode(const shared_ptr<PropertyGraphTable> &edge_pg_entry,
-                 const string &function_name, const string &function_alias) {
+                 const string &function_name, const string &function_alias,
+                 vector<unique_ptr<ParsedExpression>> extra_arguments) {
   auto select_node = make_uniq<SelectNode>();
   std::vector<unique_ptr<ParsedExpression>> select_expression;
 
@@ -74,6 +75,9 @@ CreateSelectNode(const shared_ptr<PropertyGraphTable> &edge_pg_entry,
   function_children.push_back(make_uniq<ConstantExpression>(Value::INTEGER(0)));
   function_children.push_back(
       make_uniq<ColumnRefExpression>("rowid", edge_pg_entry->source_reference));
+  for (auto &argument : extra_arguments) {
+    function_children.push_back(std::move(argument));
+  }
   auto function = make_uniq<FunctionExpression>(function_name,
                                                 std::move(function_children));
 
@@ -12,6 +12,15 @@ static void LoadInternal(DatabaseInstance &instance) {
   duckpgq::core::CoreModule::Register(instance);
   auto &config = DBConfig::GetConfig(instance);
   config.extension_callbacks.push_back(make_uniq<DuckpgqExtensionCallback>());
+  config.AddExtensionOption(
+      "duckpgq_compress_csr",
+      "Store the neighbor lists of CSRs with 32-bit vertex ids bit-packed",
+      LogicalType::BOOLEAN, Value::BOOLEAN(false));
+  config.AddExtensionOption(
+      "duckpgq_csr_cache_limit",
+      "Maximum memory of the CSRs kept in the CSR cache, e.g. '1GB'. Defaults "
+      "to a quarter of memory_limit",
+      LogicalType::VARCHAR, Value());
   for (auto &connection :
        ConnectionManager::Get(instance).GetConnectionList()) {
     connection->registered_state->Insert(
@@ -1,8 +1,14 @@
 #include "duckpgq_state.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/transaction/meta_transaction.hpp"
 
 namespace duckdb {
 
 DuckPGQState::DuckPGQState(shared_ptr<ClientContext> context) {
+  csr_cache = duckpgq::core::CSRCache::Get(*context);
+  scratch_pool = make_uniq<duckpgq::core::ScratchPool>(
+      BufferManager::GetBufferManager(*context));
+  csr_cache_limit = GetCSRCacheLimit(*context);
   auto new_conn = make_shared_ptr<ClientContext>(context->db);
   auto query = new_conn->Query("CREATE TABLE IF NOT EXISTS __duckpgq_internal ("
                                "property_graph varchar, "
@@ -23,8 +29,19 @@ DuckPGQState::DuckPGQState(shared_ptr<ClientContext> context) {
   if (query->HasError()) {
     throw TransactionException(query->GetError());
   }
+  query = new_conn->Query("CREATE TABLE IF NOT EXISTS "
+                          "__duckpgq_distance_indexes ("
+                          "property_graph varchar, "
+                          "edge_table varchar)",
+                          false);
+  if (query->HasError()) {
+    throw TransactionException(query->GetError());
+  }
 
   RetrievePropertyGraphs(new_conn);
+  if (!csr_cache->DistanceIndexesLoaded()) {
+    RetrieveDistanceIndexes(new_conn);
+  }
 }
 
 void DuckPGQState::RetrievePropertyGraphs(
@@ -40,6 +57,23 @@ void DuckPGQState::RetrievePropertyGraphs(
   ProcessPropertyGraphs(edge_property_graphs, false);
 }
 
+void DuckPGQState::RetrieveDistanceIndexes(
+    const shared_ptr<ClientContext> &context) {
+  auto result =
+      context->Query("SELECT * FROM __duckpgq_distance_indexes", false);
+  if (result->HasError()) {
+    throw TransactionException(result->GetError());
+  }
+  case_insensitive_map_t<case_insensitive_set_t> distance_indexes;
+  auto &materialized_result = result->Cast<MaterializedQueryResult>();
+  for (idx_t i = 0; i < materialized_result.RowCount(); i++) {
+    auto pg_name = materialized_result.GetValue(0, i).GetValue<string>();
+    auto edge_table = materialized_result.GetValue(1, i).GetValue<string>();
+    distance_indexes[pg_name].insert(edge_table);
+  }
+  csr_cache->LoadDistanceIndexes(std::move(distance_indexes));
+}
+
 void DuckPGQState::ProcessPropertyGraphs(
     unique_ptr<QueryResult> &property_graphs, bool is_vertex) {
   if (!property_graphs ||
@@ -149,10 +183,183 @@ void DuckPGQState::QueryEnd() {
   parse_data.reset();
   transform_expression.clear();
   match_index = 0;              // Reset the index
+  if (invalidate_csr_cache) {
+    // Invalidate again now that the commit is visible, see TransactionCommit
+    InvalidateCSRCache();
+    invalidate_csr_cache = false;
+  }
+  for (const auto &entry : csr_keys) {
+    auto csr_entry = csr_list.find(entry.first);
+    if (csr_from_cache[entry.first] || csr_entry == csr_list.end() ||
+        !csr_entry->second->IsComplete()) {
+      continue;
+    }
+    auto tables = GetCSRTables(entry.second);
+    if (!tables.empty()) {
+      csr_cache->Insert(entry.second, csr_entry->second, std::move(tables),
+                        csr_cache_version, csr_cache_limit);
+    }
+  }
+  csr_keys.clear();
+  csr_from_cache.clear();
+  bound_csrs.clear();
   for (const auto &csr_id : csr_to_delete) {
     csr_list.erase(csr_id);
   }
   csr_to_delete.clear();
+  scratch_pool->Clear();
+  if (current_transaction) {
+    // The query did not end the transaction. If its plan was not seen, it may
+    // have written to any table.
+    if (!plan_checked && current_transaction->ModifiedDatabase()) {
+      modified_unknown_tables = true;
+    }
+    transaction_queries++;
+  }
+  plan_checked = false;
+}
+
+void DuckPGQState::TransactionBegin(MetaTransaction &transaction,
+                                    ClientContext &context) {
+  current_transaction = &transaction;
+  csr_cache_version = csr_cache->GetVersion();
+  modified_tables.clear();
+  modified_unknown_tables = false;
+  transaction_queries = 0;
+}
+
+void DuckPGQState::TransactionCommit(MetaTransaction &transaction,
+                                     ClientContext &context) {
+  current_transaction = nullptr;
+  if (!transaction.ModifiedDatabase()) {
+    return;
+  }
+  if (transaction_queries == 0 && !plan_checked) {
+    // The transaction is the single query that is ending now
+    modified_unknown_tables = true;
+  }
+  // Without a transaction the distance index pragmas commit their expansion
+  // before the statement that stores the change runs
+  if (modified_unknown_tables ||
+      modified_tables.count("__duckpgq_distance_indexes")) {
+    for (const auto &change : distance_index_changes) {
+      csr_cache->SetDistanceIndex(change.pg_name, change.edge_table,
+                                  change.exists);
+    }
+    distance_index_changes.clear();
+  }
+  invalidated_tables.clear();
+  if (!modified_unknown_tables) {
+    invalidated_tables = modified_tables;
+  }
+  // Invalidate before and after the commit becomes visible, so a CSR built
+  // by a transaction that started in between is never published
+  InvalidateCSRCache();
+  invalidate_csr_cache = true;
+}
+
+void DuckPGQState::TransactionRollback(MetaTransaction &transaction,
+                                       ClientContext &context) {
+  current_transaction = nullptr;
+  distance_index_changes.clear();
+}
+
+void DuckPGQState::InvalidateCSRCache() {
+  if (invalidated_tables.empty()) {
+    csr_cache->Invalidate();
+  } else {
+    csr_cache->Invalidate(invalidated_tables);
+  }
+}
+
+bool DuckPGQState::CanUseCSRCache() const {
+  // The graph may contain changes that are not committed yet
+  return !current_transaction || !current_transaction->ModifiedDatabase();
+}
+
+idx_t DuckPGQState::GetCSRCacheLimit(ClientContext &context) {
+  Value limit;
+  if (context.TryGetCurrentSetting("duckpgq_csr_cache_limit", limit) &&
+      !limit.IsNull()) {
+    return DBConfig::ParseMemoryLimit(limit.ToString());
+  }
+  return BufferManager::GetBufferManager(context).GetMaxMemory() / 4;
+}
+
+bool DuckPGQState::BindCachedCSR(ClientContext &context,
+                                 const string &cache_key) {
+  lock_guard<mutex> guard(csr_lock);
+  csr_cache_limit = GetCSRCacheLimit(context);
+  if (cache_key.empty() || !CanUseCSRCache()) {
+    return false;
+  }
+  auto csr = csr_cache->Lookup(cache_key, csr_cache_version);
+  if (!csr) {
+    return false;
+  }
+  bound_csrs[cache_key] = std::move(csr);
+  return true;
+}
+
+bool DuckPGQState::UseCachedCSR(const string &cache_key, int32_t csr_id) {
+  lock_guard<mutex> guard(csr_lock);
+  // Every thread running create_csr_edge asks, the first one decides
+  auto decision = csr_from_cache.find(csr_id);
+  if (decision != csr_from_cache.end()) {
+    return decision->second;
+  }
+  csr_to_delete.insert(csr_id);
+  csr_from_cache[csr_id] = false;
+  if (!CanUseCSRCache()) {
+    return false;
+  }
+  csr_keys[csr_id] = cache_key;
+  // Take the CSR found when the query was bound, it may have been dropped
+  // from the cache since
+  shared_ptr<duckpgq::core::CSR> csr;
+  auto bound_csr = bound_csrs.find(cache_key);
+  if (bound_csr != bound_csrs.end()) {
+    csr = bound_csr->second;
+  } else {
+    csr = csr_cache->Lookup(cache_key, csr_cache_version);
+  }
+  if (csr) {
+    csr_from_cache[csr_id] = true;
+    csr_list[csr_id] = std::move(csr);
+    return true;
+  }
+  return false;
+}
+
+bool DuckPGQState::UseDistanceIndex(int32_t csr_id) {
+  lock_guard<mutex> guard(csr_lock);
+  auto entry = csr_keys.find(csr_id);
+  if (entry == csr_keys.end()) {
+    return false;
+  }
+  string pg_name, edge_table;
+  duckpgq::core::CSRCache::ParseKey(entry->second, pg_name, edge_table);
+  return csr_cache->HasDistanceIndex(pg_name, edge_table);
+}
+
+case_insensitive_set_t DuckPGQState::GetCSRTables(const string &cache_key) {
+  case_insensitive_set_t tables;
+  string pg_name, edge_table_name;
+  duckpgq::core::CSRCache::ParseKey(cache_key, pg_name, edge_table_name);
+  auto pg_entry = registered_property_graphs.find(pg_name);
+  if (pg_entry == registered_property_graphs.end()) {
+    return tables;
+  }
+  auto &pg_info = pg_entry->second->Cast<CreatePropertyGraphInfo>();
+  for (const auto &edge_table : pg_info.edge_tables) {
+    if (StringUtil::CIEquals(edge_table->table_name, edge_table_name)) {
+      tables.insert(edge_table->table_name);
+      tables.insert(edge_table->source_pg_table->table_name);
+      tables.insert(edge_table->destination_pg_table->table_name);
+      break;
+    }
+  }
+  return tables;
 }
 
 CreatePropertyGraphInfo *DuckPGQState::GetPropertyGraph(const string &pg_name) {
@@ -23,6 +23,10 @@ struct CheapestPathLengthFunctionData final : FunctionData {
   static unique_ptr<FunctionData>
   CheapestPathLengthBind(ClientContext &context, ScalarFunction &bound_function,
                          vector<unique_ptr<Expression>> &arguments);
+  //! Bind of cheapest_path, which returns the path as a list of row ids
+  static unique_ptr<FunctionData>
+  CheapestPathBind(ClientContext &context, ScalarFunction &bound_function,
+                   vector<unique_ptr<Expression>> &arguments);
 
   unique_ptr<FunctionData> Copy() const override;
   bool Equals(const FunctionData &other_p) const override;
@@ -16,12 +16,26 @@ namespace core {
 struct IterativeLengthFunctionData final : FunctionData {
   ClientContext &context;
   int32_t csr_id;
+  //! Whether to follow the incoming edges, i.e. to traverse the reverse CSR
+  bool reverse;
+  //! The fewest and most hops of a path. Searches stop after upper hops, and
+  //! paths shorter than lower hops are reported as no path.
+  int64_t lower;
+  int64_t upper;
 
-  IterativeLengthFunctionData(ClientContext &context, int32_t csr_id)
-      : context(context), csr_id(csr_id) {}
+  IterativeLengthFunctionData(
+      ClientContext &context, int32_t csr_id, bool reverse = false,
+      int64_t lower = 0, int64_t upper = NumericLimits<int64_t>::Maximum())
+      : context(context), csr_id(csr_id), reverse(reverse), lower(lower),
+        upper(upper) {}
   static unique_ptr<FunctionData>
   IterativeLengthBind(ClientContext &context, ScalarFunction &bound_function,
                       vector<unique_ptr<Expression>> &arguments);
+  //! Binds bfs_distances, whose optional constant fourth argument is the
+  //! upper bound
+  static unique_ptr<FunctionData>
+  BfsDistancesBind(ClientContext &context, ScalarFunction &bound_function,
+                   vector<unique_ptr<Expression>> &arguments);
 
   unique_ptr<FunctionData> Copy() const override;
   bool Equals(const FunctionData &other_p) const override;
@@ -9,6 +9,8 @@
 #pragma once
 #include "duckdb/main/client_context.hpp"
 #include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+#include "duckpgq/core/utils/duckpgq_sorted_adjacency.hpp"
 
 namespace duckpgq {
 
@@ -17,6 +19,10 @@ namespace core {
 struct LocalClusteringCoefficientFunctionData final : FunctionData {
   ClientContext &context;
   int32_t csr_id;
+  //! The sorted neighbor lists are built once, by all threads evaluating the
+  //! function
+  SortedAdjacency adjacency;
+  SharedComputation computation;
 
   LocalClusteringCoefficientFunctionData(ClientContext &context,
                                          int32_t csr_id);
@@ -9,27 +9,52 @@
 #pragma once
 #include "duckdb/main/client_context.hpp"
 #include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
 
 namespace duckpgq {
 namespace core {
+//! Default parameters of PageRank
+#define PAGERANK_DEFAULT_DAMPING 0.85
+#define PAGERANK_DEFAULT_TOLERANCE 1e-6
+#define PAGERANK_DEFAULT_MAX_ITERATIONS 100
+//! Default residual per out-edge below which personalized PageRank stops
+//! pushing from a vertex
+#define PERSONALIZED_PAGERANK_DEFAULT_TOLERANCE 1e-4
+
 struct PageRankFunctionData final : FunctionData {
   ClientContext &context;
   int32_t csr_id;
   vector<double_t> rank;
   vector<double_t> temp_rank;
   double_t damping_factor;
+  //! The iterations stop once no rank changes by this much or more
   double_t convergence_threshold;
+  int64_t max_iterations;
   int64_t iteration_count;
-  std::mutex state_lock; // Lock for state
-  bool state_initialized;
+  //! Largest change of a rank in every iteration
+  vector<double_t> residuals;
+  //! The ranks are computed once, by all threads evaluating the function
+  SharedComputation computation;
   bool converged;
 
-  PageRankFunctionData(ClientContext &context, int32_t csr_id);
   PageRankFunctionData(ClientContext &context, int32_t csr_id,
-                       const vector<int64_t> &componentId);
+                       double_t damping_factor = PAGERANK_DEFAULT_DAMPING,
+                       double_t convergence_threshold =
+                           PAGERANK_DEFAULT_TOLERANCE,
+                       int64_t max_iterations =
+                           PAGERANK_DEFAULT_MAX_ITERATIONS);
+  //! Binds pagerank(csr_id, rowid [, damping, tolerance, max_iterations]) and
+  //! pagerank_residual(csr_id, iteration [, ...])
   static unique_ptr<FunctionData>
   PageRankBind(ClientContext &context, ScalarFunction &bound_function,
                vector<unique_ptr<Expression>> &arguments);
+  //! Binds personalized_pagerank(csr_id, v_size, rowid [, damping,
+  //! tolerance]), whose tolerance is the residual per out-edge at which a
+  //! vertex pushes
+  static unique_ptr<FunctionData>
+  PersonalizedPageRankBind(ClientContext &context,
+                           ScalarFunction &bound_function,
+                           vector<unique_ptr<Expression>> &arguments);
 
   unique_ptr<FunctionData> Copy() const override;
   bool Equals(const FunctionData &other_p) const override;
@@ -0,0 +1,39 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/functions/function_data/triangle_count_function_data.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckdb/main/client_context.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+#include "duckpgq/core/utils/duckpgq_sorted_adjacency.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+struct TriangleCountFunctionData final : FunctionData {
+  ClientContext &context;
+  int32_t csr_id;
+  //! Every edge once, towards the endpoint of higher degree
+  SortedAdjacency adjacency;
+  //! The number of triangles every vertex is part of
+  unsafe_unique_array<std::atomic<int64_t>> triangles;
+  //! The triangles are counted once, by all threads evaluating the function
+  SharedComputation computation;
+
+  TriangleCountFunctionData(ClientContext &context, int32_t csr_id);
+  static unique_ptr<FunctionData>
+  TriangleCountBind(ClientContext &context, ScalarFunction &bound_function,
+                    vector<unique_ptr<Expression>> &arguments);
+
+  unique_ptr<FunctionData> Copy() const override;
+  bool Equals(const FunctionData &other_p) const override;
+};
+
+} // namespace core
+} // namespace duckpgq
\ No newline at end of file
@@ -9,18 +9,19 @@
 #pragma once
 #include "duckdb/main/client_context.hpp"
 #include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
 
 namespace duckpgq {
 namespace core {
 struct WeaklyConnectedComponentFunctionData final : FunctionData {
   ClientContext &context;
   int32_t csr_id;
-  std::mutex wcc_lock;
-  std::mutex initialize_lock;
-  bool state_converged;
-  bool state_initialized;
-  vector<int64_t> forest;
-
+  //! The parent of every vertex, which always has a smaller id, so the root
+  //! of every tree is the smallest vertex of its component. Every vertex
+  //! points to its root once the components are computed.
+  unsafe_unique_array<std::atomic<int64_t>> forest;
+  //! The components are computed once, by all threads evaluating the function
+  SharedComputation computation;
 
   WeaklyConnectedComponentFunctionData(ClientContext &context, int32_t csr_id);
 
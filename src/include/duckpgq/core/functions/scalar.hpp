@@ -7,6 +7,8 @@ namespace core {
 
 struct CoreScalarFunctions {
   static void Register(DatabaseInstance &db) {
+    RegisterBfsDistancesScalarFunction(db);
+    RegisterCheapestPathScalarFunction(db);
     RegisterCheapestPathLengthScalarFunction(db);
     RegisterCSRCreationScalarFunctions(db);
     RegisterCSRDeletionScalarFunction(db);
@@ -17,11 +19,16 @@ struct CoreScalarFunctions {
     RegisterLocalClusteringCoefficientScalarFunction(db);
     RegisterReachabilityScalarFunction(db);
     RegisterShortestPathScalarFunction(db);
+    RegisterShortestPathBidirectionalScalarFunction(db);
     RegisterWeaklyConnectedComponentScalarFunction(db);
     RegisterPageRankScalarFunction(db);
+    RegisterPersonalizedPageRankScalarFunction(db);
+    RegisterTriangleCountScalarFunction(db);
   }
 
 private:
+  static void RegisterBfsDistancesScalarFunction(DatabaseInstance &db);
+  static void RegisterCheapestPathScalarFunction(DatabaseInstance &db);
   static void RegisterCheapestPathLengthScalarFunction(DatabaseInstance &db);
   static void RegisterCSRCreationScalarFunctions(DatabaseInstance &db);
   static void RegisterCSRDeletionScalarFunction(DatabaseInstance &db);
@@ -35,8 +42,13 @@ private:
   static void RegisterReachabilityScalarFunction(DatabaseInstance &db);
   static void RegisterShortestPathScalarFunction(DatabaseInstance &db);
   static void
+  RegisterShortestPathBidirectionalScalarFunction(DatabaseInstance &db);
+  static void
   RegisterWeaklyConnectedComponentScalarFunction(DatabaseInstance &db);
   static void RegisterPageRankScalarFunction(DatabaseInstance &db);
+  static void
+  RegisterPersonalizedPageRankScalarFunction(DatabaseInstance &db);
+  static void RegisterTriangleCountScalarFunction(DatabaseInstance &db);
 };
 
 } // namespace core
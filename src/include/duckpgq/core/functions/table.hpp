@@ -15,6 +15,10 @@ struct CoreTableFunctions {
     RegisterScanTableFunctions(db);
     RegisterWeaklyConnectedComponentTableFunction(db);
     RegisterPageRankTableFunction(db);
+    RegisterBfsDistancesTableFunction(db);
+    RegisterPersonalizedPageRankTableFunction(db);
+    RegisterTriangleCountTableFunction(db);
+    RegisterCSRCacheTableFunction(db);
   }
 
 private:
@@ -28,6 +32,11 @@ private:
   static void
   RegisterWeaklyConnectedComponentTableFunction(DatabaseInstance &db);
   static void RegisterPageRankTableFunction(DatabaseInstance &db);
+  static void RegisterBfsDistancesTableFunction(DatabaseInstance &db);
+  static void
+  RegisterPersonalizedPageRankTableFunction(DatabaseInstance &db);
+  static void RegisterTriangleCountTableFunction(DatabaseInstance &db);
+  static void RegisterCSRCacheTableFunction(DatabaseInstance &db);
 };
 
 } // namespace core
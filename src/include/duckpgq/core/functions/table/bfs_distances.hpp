@@ -0,0 +1,39 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/functions/table/bfs_distances.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "duckpgq/common.hpp"
+#include "duckdb/function/table_function.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! bfs_distances(pg, vertex_label, edge_label, source) returns the vertices
+//! reachable from the vertex with the key source, or from the vertices with
+//! the keys in a list, with their number of hops and the vertex they were
+//! first reached from. max_depth bounds the hops.
+class BfsDistancesFunction : public TableFunction {
+public:
+  BfsDistancesFunction() {
+    name = "bfs_distances";
+    arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                 LogicalType::VARCHAR, LogicalType::ANY};
+    named_parameters["max_depth"] = LogicalType::BIGINT;
+    bind_replace = BfsDistancesBindReplace;
+  }
+
+  static unique_ptr<TableRef>
+  BfsDistancesBindReplace(ClientContext &context,
+                          TableFunctionBindInput &input);
+};
+
+} // namespace core
+
+} // namespace duckpgq
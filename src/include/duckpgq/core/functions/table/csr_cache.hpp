@@ -0,0 +1,48 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/functions/table/csr_cache.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckpgq/core/utils/csr_cache.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! Lists the CSRs in the CSR cache with the number of times each was reused,
+//! the number of path lengths looked up in its distance index, and the
+//! memory it takes
+class CSRCacheFunction : public TableFunction {
+public:
+  CSRCacheFunction() {
+    name = "duckpgq_csr_cache";
+    bind = CSRCacheBind;
+    init_global = CSRCacheInit;
+    function = CSRCacheFunc;
+  }
+
+  struct CSRCacheGlobalData : public GlobalTableFunctionState {
+    vector<CSRCache::CSRCacheHits> entries;
+    idx_t offset = 0;
+  };
+
+  static unique_ptr<FunctionData>
+  CSRCacheBind(ClientContext &context, TableFunctionBindInput &input,
+               vector<LogicalType> &return_types, vector<string> &names);
+
+  static unique_ptr<GlobalTableFunctionState>
+  CSRCacheInit(ClientContext &context, TableFunctionInitInput &input);
+
+  static void CSRCacheFunc(ClientContext &context, TableFunctionInput &data_p,
+                           DataChunk &output);
+};
+
+} // namespace core
+
+} // namespace duckpgq
@@ -115,7 +115,8 @@ public:
 
   static unique_ptr<ParsedExpression> AddPathQuantifierCondition(
       const string &prev_binding, const string &next_binding,
-      const shared_ptr<PropertyGraphTable> &edge_table, const SubPath *subpath);
+      const shared_ptr<PropertyGraphTable> &edge_table, const SubPath *subpath,
+      bool reverse = false);
 
   static unique_ptr<TableRef> MatchBindReplace(ClientContext &context,
                                                TableFunctionBindInput &input);
@@ -130,13 +131,22 @@ public:
       PathElement *path_element, PathElement *next_vertex_element,
       vector<unique_ptr<ParsedExpression>> &path_finding_conditions);
   static unique_ptr<ParsedExpression>
-  CreatePathFindingFunction(vector<unique_ptr<PathReference>> &path_list,
+  CreatePathFindingFunction(ClientContext &context,
+                            vector<unique_ptr<PathReference>> &path_list,
                             CreatePropertyGraphInfo &pg_table,
                             const string &path_variable,
                             unique_ptr<SelectNode> &final_select_node,
                             vector<unique_ptr<ParsedExpression>> &conditions);
 
-  static void AddPathFinding(unique_ptr<SelectNode> &select_node,
+  static unique_ptr<CommonTableExpressionInfo> CreatePathFindingCSRCTE(
+      ClientContext &context, CreatePropertyGraphInfo &pg_table,
+      const shared_ptr<PropertyGraphTable> &edge_table,
+      const unique_ptr<SelectNode> &select_node, PGQMatchType edge_type,
+      const string &prev_binding, const string &edge_binding,
+      const string &next_binding);
+
+  static void AddPathFinding(ClientContext &context,
+                             unique_ptr<SelectNode> &select_node,
                              vector<unique_ptr<ParsedExpression>> &conditions,
                              const string &prev_binding,
                              const string &edge_binding,
@@ -156,7 +166,7 @@ public:
       int32_t &extra_alias_counter, unique_ptr<TableRef> &from_clause);
 
   static void ProcessPathList(
-      vector<unique_ptr<PathReference>> &path_pattern,
+      ClientContext &context, vector<unique_ptr<PathReference>> &path_pattern,
       vector<unique_ptr<ParsedExpression>> &conditions,
       unique_ptr<SelectNode> &select_node,
       case_insensitive_map_t<shared_ptr<PropertyGraphTable>> &alias_map,
@@ -164,7 +174,8 @@ public:
       MatchExpression &original_ref);
 
   static void
-  CheckNamedSubpath(SubPath &subpath, MatchExpression &original_ref,
+  CheckNamedSubpath(ClientContext &context, SubPath &subpath,
+                    MatchExpression &original_ref,
                     CreatePropertyGraphInfo &pg_table,
                     unique_ptr<SelectNode> &final_select_node,
                     vector<unique_ptr<ParsedExpression>> &conditions);
@@ -11,19 +11,47 @@
 namespace duckpgq {
 namespace core {
 
+//! pagerank(pg, vertex_label, edge_label) returns the PageRank of every
+//! vertex. damping, tolerance and max_iterations set the damping factor, the
+//! change of all ranks at which the iterations stop, and the most iterations.
 class PageRankFunction : public TableFunction {
 public:
   PageRankFunction() {
     name = "pagerank";
     arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
                  LogicalType::VARCHAR};
+    SetPageRankParameters(*this);
     bind_replace = PageRankBindReplace;
   }
 
+  static void SetPageRankParameters(TableFunction &function) {
+    function.named_parameters["damping"] = LogicalType::DOUBLE;
+    function.named_parameters["tolerance"] = LogicalType::DOUBLE;
+    function.named_parameters["max_iterations"] = LogicalType::BIGINT;
+  }
+
   static unique_ptr<TableRef>
   PageRankBindReplace(ClientContext &context, TableFunctionBindInput &input);
 };
 
+//! pagerank_residuals(pg, vertex_label, edge_label) returns the largest
+//! change of a rank in every iteration of the same PageRank computation, to
+//! check how fast it converges. Takes the named parameters of pagerank.
+class PageRankResidualsFunction : public TableFunction {
+public:
+  PageRankResidualsFunction() {
+    name = "pagerank_residuals";
+    arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                 LogicalType::VARCHAR};
+    PageRankFunction::SetPageRankParameters(*this);
+    bind_replace = PageRankResidualsBindReplace;
+  }
+
+  static unique_ptr<TableRef>
+  PageRankResidualsBindReplace(ClientContext &context,
+                               TableFunctionBindInput &input);
+};
+
 struct PageRankData : TableFunctionData {
   static unique_ptr<FunctionData>
   PageRankBind(ClientContext &context, TableFunctionBindInput &input,
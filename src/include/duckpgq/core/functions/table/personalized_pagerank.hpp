@@ -0,0 +1,41 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/functions/table/personalized_pagerank.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "duckpgq/common.hpp"
+#include "duckdb/function/table_function.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! personalized_pagerank(pg, vertex_label, edge_label, seed) returns the
+//! approximate PageRank of the vertices around the vertex with the key seed,
+//! or around each of the vertices with the keys in a list, with random jumps
+//! going back to the seed. damping sets the damping factor and tolerance the
+//! residual per out-edge below which the ranks are left approximate.
+class PersonalizedPageRankFunction : public TableFunction {
+public:
+  PersonalizedPageRankFunction() {
+    name = "personalized_pagerank";
+    arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                 LogicalType::VARCHAR, LogicalType::ANY};
+    named_parameters["damping"] = LogicalType::DOUBLE;
+    named_parameters["tolerance"] = LogicalType::DOUBLE;
+    bind_replace = PersonalizedPageRankBindReplace;
+  }
+
+  static unique_ptr<TableRef>
+  PersonalizedPageRankBindReplace(ClientContext &context,
+                                  TableFunctionBindInput &input);
+};
+
+} // namespace core
+
+} // namespace duckpgq
@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/functions/table/triangle_count.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "duckpgq/common.hpp"
+#include "duckdb/function/table_function.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! triangle_count(pg, vertex_label, edge_label) returns the number of
+//! triangles every vertex is part of, taking the edges as undirected.
+class TriangleCountFunction : public TableFunction {
+public:
+  TriangleCountFunction() {
+    name = "triangle_count";
+    arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                 LogicalType::VARCHAR};
+    bind_replace = TriangleCountBindReplace;
+  }
+
+  static unique_ptr<TableRef>
+  TriangleCountBindReplace(ClientContext &context,
+                           TableFunctionBindInput &input);
+};
+
+//! triangle_count_total(pg, vertex_label, edge_label) returns the number of
+//! triangles of the whole graph as a single row.
+class TriangleCountTotalFunction : public TableFunction {
+public:
+  TriangleCountTotalFunction() {
+    name = "triangle_count_total";
+    arguments = {LogicalType::VARCHAR, LogicalType::VARCHAR,
+                 LogicalType::VARCHAR};
+    bind_replace = TriangleCountTotalBindReplace;
+  }
+
+  static unique_ptr<TableRef>
+  TriangleCountTotalBindReplace(ClientContext &context,
+                                TableFunctionBindInput &input);
+};
+
+} // namespace core
+
+} // namespace duckpgq
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "duckpgq/common.hpp"
+#include "duckdb/optimizer/optimizer_extension.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! Records the tables the plan writes to in the DuckPGQ state, so that a
+//! commit only drops the cached CSRs built from those tables
+void DuckPGQModifiedTables(OptimizerExtensionInput &input,
+                           unique_ptr<LogicalOperator> &plan);
+
+struct DuckPGQModifiedTablesExtension : public OptimizerExtension {
+  DuckPGQModifiedTablesExtension() {
+    optimize_function = DuckPGQModifiedTables;
+  }
+};
+
+} // namespace core
+
+} // namespace duckpgq
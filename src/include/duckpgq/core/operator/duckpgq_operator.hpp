@@ -6,10 +6,14 @@ namespace duckpgq {
 namespace core {
 
 struct CorePGQOperator {
-  static void Register(DatabaseInstance &db) { RegisterPGQBindOperator(db); }
+  static void Register(DatabaseInstance &db) {
+    RegisterPGQBindOperator(db);
+    RegisterModifiedTablesOptimizer(db);
+  }
 
 private:
   static void RegisterPGQBindOperator(DatabaseInstance &db);
+  static void RegisterModifiedTablesOptimizer(DatabaseInstance &db);
 };
 
 } // namespace core
@@ -18,10 +18,12 @@ public:
   //! Register the PRAGMA function
   static void Register(DatabaseInstance &instance) {
     RegisterShowPropertyGraphs(instance);
+    RegisterDistanceIndex(instance);
   }
 
 private:
   static void RegisterShowPropertyGraphs(DatabaseInstance &instance);
+  static void RegisterDistanceIndex(DatabaseInstance &instance);
 };
 
 } // namespace core
@@ -7,7 +7,9 @@
 //===----------------------------------------------------------------------===//
 
 #pragma once
+#include "duckdb/common/bitpacking.hpp"
 #include "duckdb/function/function.hpp"
+#include "duckdb/function/table_function.hpp"
 
 #include "duckdb/parser/expression/cast_expression.hpp"
 #include "duckdb/parser/expression/function_expression.hpp"
@@ -19,11 +21,166 @@
 #include "duckdb/parser/query_node/select_node.hpp"
 #include "duckdb/parser/tableref/joinref.hpp"
 #include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_distance_index.hpp"
+
+#include <algorithm>
 
 namespace duckpgq {
 
 namespace core {
 
+//! Edges passed to create_csr_edge, partitioned by ranges of source vertices
+//! that hold roughly the same number of edges. Once all edges have arrived,
+//! every partition is placed into the CSR by one thread, so placing the edges
+//! needs no atomics.
+struct CSREdgeBuffer {
+  struct Partition {
+    mutex lock;
+    vector<int64_t> src;
+    vector<int64_t> dst;
+    vector<int64_t> edge_ids;
+    vector<int64_t> w;
+    vector<double> w_double;
+  };
+
+  //! Partition i holds the edges with a source in [bounds[i], bounds[i + 1])
+  vector<int64_t> bounds;
+  vector<unique_ptr<Partition>> partitions;
+  atomic<int64_t> buffered_edges{0};
+
+  idx_t GetPartition(int64_t src) const {
+    return std::upper_bound(bounds.begin() + 1, bounds.end() - 1, src) -
+           (bounds.begin() + 1);
+  }
+};
+
+//! Width of the vertex ids (e) and of the offsets (v, edge_ids) of a CSR
+enum class CSRWidth : uint8_t {
+  //! 64-bit ids and offsets, the layout a CSR is built in
+  WIDE,
+  //! 32-bit ids and 64-bit offsets, for graphs with more than 2^32 edges
+  NARROW_IDS,
+  //! 32-bit ids and offsets
+  NARROW
+};
+
+//! Neighbor lists of a compressed CSR are encoded in groups of this many
+//! neighbors
+static constexpr idx_t CSR_COMPRESSION_GROUP_SIZE =
+    BitpackingPrimitives::BITPACKING_ALGORITHM_GROUP_SIZE;
+
+//! Read-only adjacency lists of a CSR with ID_T vertex ids and OFFSET_T
+//! offsets. The search kernels are instantiated once per view type, see
+//! TemplatedCSRDispatch, and visit neighbors through ForEachNeighbor so they
+//! also run on a CompressedCSRView.
+template <class ID_T, class OFFSET_T> struct CSRView {
+  //! vsize offsets, v[i] is the start of the adjacency list of vertex i
+  const OFFSET_T *v;
+  //! Destination vertex of every edge
+  const ID_T *e;
+  //! Row id in the edge table of every edge
+  const OFFSET_T *edge_ids;
+  idx_t vsize;
+
+  //! Calls func(neighbor, offset) for every edge of vertex, where offset is
+  //! the position of the edge in edge_ids and the weights
+  template <class FUNC>
+  inline void ForEachNeighbor(idx_t vertex, FUNC &&func) const {
+    for (auto offset = v[vertex]; offset < v[vertex + 1]; offset++) {
+      func(e[offset], offset);
+    }
+  }
+
+  //! Like ForEachNeighbor, but stops at the first edge func returns true for.
+  //! Returns whether it stopped early.
+  template <class FUNC>
+  inline bool AnyNeighbor(idx_t vertex, FUNC &&func) const {
+    for (auto offset = v[vertex]; offset < v[vertex + 1]; offset++) {
+      if (func(e[offset], offset)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline int64_t Degree(idx_t vertex) const {
+    return static_cast<int64_t>(v[vertex + 1] - v[vertex]);
+  }
+};
+
+//! Reads a LEB128 encoded value and advances ptr past it
+inline uint32_t CSRReadVarint(const_data_ptr_t &ptr) {
+  uint32_t result = 0;
+  for (idx_t shift = 0;; shift += 7) {
+    auto byte = *ptr++;
+    result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return result;
+    }
+  }
+}
+
+//! Adjacency lists of a CSR whose neighbor lists are sorted and compressed.
+//! Every group of CSR_COMPRESSION_GROUP_SIZE neighbors is stored as the
+//! varint encoded gap from the last neighbor of the previous group, the bit
+//! width of the gaps within the group, and those gaps bit-packed with the
+//! DuckDB bitpacking primitives, whose unrolled unpacking compiles to SIMD
+//! code. The offsets, edge_ids and weights are not compressed.
+template <class OFFSET_T> struct CompressedCSRView {
+  const OFFSET_T *v;
+  //! Byte offset of the neighbor list of every vertex in data
+  const uint64_t *list_offsets;
+  const_data_ptr_t data;
+  const OFFSET_T *edge_ids;
+  idx_t vsize;
+
+  template <class FUNC>
+  inline void ForEachNeighbor(idx_t vertex, FUNC &&func) const {
+    AnyNeighbor(vertex, [&](int64_t neighbor, int64_t offset) {
+      func(neighbor, offset);
+      return false;
+    });
+  }
+
+  template <class FUNC>
+  inline bool AnyNeighbor(idx_t vertex, FUNC &&func) const {
+    uint32_t packed[CSR_COMPRESSION_GROUP_SIZE];
+    uint32_t gaps[CSR_COMPRESSION_GROUP_SIZE];
+    auto ptr = data + list_offsets[vertex];
+    uint32_t neighbor = 0;
+    for (auto offset = v[vertex]; offset < v[vertex + 1];) {
+      idx_t count = MinValue<idx_t>(CSR_COMPRESSION_GROUP_SIZE,
+                                    static_cast<idx_t>(v[vertex + 1] - offset));
+      neighbor += CSRReadVarint(ptr);
+      bitpacking_width_t width = *ptr++;
+      if (width == 0) {
+        // All neighbors of the group are equal
+        memset(gaps, 0, sizeof(gaps));
+      } else {
+        // Copy the group into an aligned buffer, the last group of a list is
+        // stored without padding
+        auto packed_size = (count * width + 7) / 8;
+        memcpy(packed, ptr, packed_size);
+        ptr += packed_size;
+        BitpackingPrimitives::UnPackBuffer<uint32_t>(
+            reinterpret_cast<data_ptr_t>(gaps),
+            reinterpret_cast<data_ptr_t>(packed), count, width);
+      }
+      for (idx_t i = 0; i < count; i++, offset++) {
+        neighbor += gaps[i];
+        if (func(neighbor, offset)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  inline int64_t Degree(idx_t vertex) const {
+    return static_cast<int64_t>(v[vertex + 1] - v[vertex]);
+  }
+};
+
 class CSR {
 public:
   CSR() = default;
@@ -40,14 +197,187 @@ public:
   bool initialized_v = false;
   bool initialized_e = false;
   bool initialized_w = false;
+  //! Whether any weight is negative, and the heaviest weight in w or w_double,
+  //! set once all edges are placed so the cheapest path searches need not
+  //! scan the weights
+  bool negative_weight = false;
+  int64_t max_w = 0;
+  double max_w_double = 0;
 
   size_t vsize{};
+  //! Number of edges placed into e by create_csr_edge so far
+  atomic<int64_t> inserted_edges{0};
+  //! Edges that have not been placed into e yet, see CSREdgeBuffer
+  unique_ptr<CSREdgeBuffer> edge_buffer;
+
+  //! Width the kernels read the CSR in, chosen once all edges are placed.
+  //! The 32-bit copies below replace the 64-bit arrays they narrow.
+  CSRWidth width = CSRWidth::WIDE;
+  vector<uint32_t> v_narrow;
+  vector<uint32_t> e_narrow;
+  vector<uint32_t> edge_ids_narrow;
+  //! Whether the neighbor lists are stored in e_compressed instead of e or
+  //! e_narrow, see CompressedCSRView. Only CSRs with 32-bit ids are
+  //! compressed, and only if duckpgq_compress_csr is set.
+  bool compressed = false;
+  vector<uint64_t> list_offsets;
+  vector<data_t> e_compressed;
+  //! Guards materializing the 64-bit arrays of a narrowed CSR
+  mutex widen_lock;
+  //! Incoming edges of every vertex, built together with the CSR if
+  //! create_csr_edge is asked for it. Its edge_ids and weights are those of
+  //! the same edges in the CSR, and every list is sorted by source vertex.
+  unique_ptr<CSR> reverse;
+  //! Whether the CSR turned out to equal its reverse, including the edge ids,
+  //! e.g. an undirected CSR. reverse is not kept then.
+  bool symmetric = false;
+  //! Exact distances between all vertices, built by the first path-length
+  //! query over an edge table with a distance index
+  unique_ptr<DistanceIndex> distance_index;
+  mutex distance_index_lock;
+  //! Number of path lengths looked up in the distance index
+  atomic<idx_t> distance_index_hits{0};
+  //! Bytes the distance index takes, set once it is built
+  atomic<idx_t> distance_index_size{0};
 
+  //! Whether all edges have been inserted, i.e. the CSR can be reused
+  bool IsComplete() const;
+  idx_t EdgeCount() const;
+  //! Bytes the arrays of the CSR, its reverse and its distance index take
+  idx_t MemorySize() const;
+  //! Offset of the adjacency list of vertex i, independent of the width
+  int64_t GetOffset(idx_t i) const;
+  //! Destination vertex of edge i, independent of the width
+  int64_t GetEdge(idx_t i) const;
+  //! Materializes v, e and edge_ids of a narrowed or compressed CSR again, for
+  //! consumers that expect the 64-bit layout such as get_csr_ptr. The layout
+  //! the kernels use is left unchanged.
+  void Widen();
+  //! max_w or max_w_double, for the weights of type T
+  template <typename T> T MaxWeight() const;
+  //! The reverse CSR, throws if it was not built
+  CSR &GetReverse();
+  bool HasReverse() const { return symmetric || reverse; }
+  //! The distance index of a complete CSR. The first call builds it, while
+  //! the other callers wait, and it is kept with the CSR in the CSR cache. A
+  //! build that fails throws, and the next call builds it again.
+  const DistanceIndex &GetDistanceIndex(ClientContext &context);
+  //! Whether the kernels read both CSRs through the same view type
+  bool SameLayout(const CSR &other) const {
+    return width == other.width && compressed == other.compressed;
+  }
+  template <class ID_T, class OFFSET_T> CSRView<ID_T, OFFSET_T> GetView() const;
+  template <class OFFSET_T>
+  CompressedCSRView<OFFSET_T> GetCompressedView() const;
+  //! The view of type CSR_VIEW, for a CSR with the same layout as the one
+  //! CSR_VIEW was dispatched on
+  template <class CSR_VIEW> CSR_VIEW GetViewAs() const;
   string ToString() const;
 };
 
+template <> inline int64_t CSR::MaxWeight<int64_t>() const { return max_w; }
+
+template <> inline double CSR::MaxWeight<double>() const {
+  return max_w_double;
+}
+
+template <>
+inline CSRView<int64_t, int64_t> CSR::GetView<int64_t, int64_t>() const {
+  D_ASSERT(width == CSRWidth::WIDE);
+  return {reinterpret_cast<const int64_t *>(v), e.data(), edge_ids.data(),
+          vsize};
+}
+
+template <>
+inline CSRView<uint32_t, int64_t> CSR::GetView<uint32_t, int64_t>() const {
+  D_ASSERT(width == CSRWidth::NARROW_IDS);
+  return {reinterpret_cast<const int64_t *>(v), e_narrow.data(),
+          edge_ids.data(), vsize};
+}
+
+template <>
+inline CSRView<uint32_t, uint32_t> CSR::GetView<uint32_t, uint32_t>() const {
+  D_ASSERT(width == CSRWidth::NARROW);
+  return {v_narrow.data(), e_narrow.data(), edge_ids_narrow.data(), vsize};
+}
+
+template <>
+inline CompressedCSRView<int64_t> CSR::GetCompressedView<int64_t>() const {
+  D_ASSERT(compressed && width == CSRWidth::NARROW_IDS);
+  return {reinterpret_cast<const int64_t *>(v), list_offsets.data(),
+          e_compressed.data(), edge_ids.data(), vsize};
+}
+
+template <>
+inline CompressedCSRView<uint32_t> CSR::GetCompressedView<uint32_t>() const {
+  D_ASSERT(compressed && width == CSRWidth::NARROW);
+  return {v_narrow.data(), list_offsets.data(), e_compressed.data(),
+          edge_ids_narrow.data(), vsize};
+}
+
+template <>
+inline CSRView<int64_t, int64_t>
+CSR::GetViewAs<CSRView<int64_t, int64_t>>() const {
+  return GetView<int64_t, int64_t>();
+}
+
+template <>
+inline CSRView<uint32_t, int64_t>
+CSR::GetViewAs<CSRView<uint32_t, int64_t>>() const {
+  return GetView<uint32_t, int64_t>();
+}
+
+template <>
+inline CSRView<uint32_t, uint32_t>
+CSR::GetViewAs<CSRView<uint32_t, uint32_t>>() const {
+  return GetView<uint32_t, uint32_t>();
+}
+
+template <>
+inline CompressedCSRView<int64_t>
+CSR::GetViewAs<CompressedCSRView<int64_t>>() const {
+  return GetCompressedView<int64_t>();
+}
+
+template <>
+inline CompressedCSRView<uint32_t>
+CSR::GetViewAs<CompressedCSRView<uint32_t>>() const {
+  return GetCompressedView<uint32_t>();
+}
+
+//! Calls OP::Operation(view, args...) with the view matching the layout of
+//! the CSR, so the kernels are specialized for every width and for
+//! compressed neighbor lists
+template <class OP, class... ARGS>
+void TemplatedCSRDispatch(const CSR &csr, ARGS &&...args) {
+  if (csr.compressed) {
+    if (csr.width == CSRWidth::NARROW) {
+      OP::Operation(csr.GetCompressedView<uint32_t>(),
+                    std::forward<ARGS>(args)...);
+    } else {
+      OP::Operation(csr.GetCompressedView<int64_t>(),
+                    std::forward<ARGS>(args)...);
+    }
+    return;
+  }
+  switch (csr.width) {
+  case CSRWidth::NARROW:
+    OP::Operation(csr.GetView<uint32_t, uint32_t>(),
+                  std::forward<ARGS>(args)...);
+    break;
+  case CSRWidth::NARROW_IDS:
+    OP::Operation(csr.GetView<uint32_t, int64_t>(),
+                  std::forward<ARGS>(args)...);
+    break;
+  default:
+    OP::Operation(csr.GetView<int64_t, int64_t>(), std::forward<ARGS>(args)...);
+    break;
+  }
+}
+
 struct CSRFunctionData : FunctionData {
-  CSRFunctionData(ClientContext &context, int32_t id, LogicalType weight_type);
+  CSRFunctionData(ClientContext &context, int32_t id, LogicalType weight_type,
+                  bool build_reverse = false, string cache_key = "");
   unique_ptr<FunctionData> Copy() const override;
   bool Equals(const FunctionData &other_p) const override;
   static unique_ptr<FunctionData>
@@ -63,16 +393,36 @@ struct CSRFunctionData : FunctionData {
   ClientContext &context;
   const int32_t id;
   const LogicalType weight_type;
+  //! Whether create_csr_edge also builds the reverse CSR
+  const bool build_reverse;
+  //! Key of the CSR in the CSR cache, empty if it is not cached
+  const string cache_key;
 };
 
 // CSR BindReplace functions
 unique_ptr<CommonTableExpressionInfo>
+CreateCSRCTE(ClientContext &context, const string &pg_name,
+             const shared_ptr<PropertyGraphTable> &edge_table,
+             const unique_ptr<SelectNode> &select_node, bool directed,
+             const string &prev_binding = "src",
+             const string &edge_binding = "edge",
+             const string &next_binding = "dst", bool with_reverse = false);
+unique_ptr<CommonTableExpressionInfo>
+CreateCachedCSRCTE(const string &cache_key);
+//! Called by the bind_replace functions that create a CSR CTE. CreateCSRCTE
+//! looks the CSR up in the CSR cache while binding, so the statement has to
+//! be bound again for every execution.
+void CSRRequireRebind(TableFunctionBindInput &input);
+unique_ptr<CommonTableExpressionInfo>
 CreateUndirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
-                       const unique_ptr<SelectNode> &select_node);
+                       const unique_ptr<SelectNode> &select_node,
+                       bool with_reverse = false,
+                       const string &cache_key = "");
 unique_ptr<CommonTableExpressionInfo>
 CreateDirectedCSRCTE(const shared_ptr<PropertyGraphTable> &edge_table,
                      const string &prev_binding, const string &edge_binding,
-                     const string &next_binding);
+                     const string &next_binding, bool with_reverse = false,
+                     const string &cache_key = "");
 
 // Helper functions
 unique_ptr<CommonTableExpressionInfo>
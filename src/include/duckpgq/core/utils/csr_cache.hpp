@@ -0,0 +1,116 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/csr_cache.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckdb/common/case_insensitive_map.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/compressed_sparse_row.hpp"
+
+namespace duckpgq {
+
+namespace core {
+
+//! Database-wide cache of fully built CSRs, shared by all connections.
+//! Every committed write bumps the cache version and records it as the last
+//! change of the tables it wrote to. A cached CSR is dropped when one of the
+//! tables it was built from changes, and a transaction only sees the CSRs
+//! whose tables have not changed since it started.
+//! The cache holds at most duckpgq_csr_cache_limit bytes of CSRs, and drops
+//! the least recently used ones to make room for a new one.
+class CSRCache : public ObjectCacheEntry {
+public:
+  static string ObjectType() { return "duckpgq_csr_cache"; }
+  string GetObjectType() override { return ObjectType(); }
+
+  static shared_ptr<CSRCache> Get(ClientContext &context);
+
+  //! Key of the CSR over edge_table in property graph pg_name, empty if the
+  //! names contain the separator of the key, in which case it is not cached
+  static string CreateKey(const string &pg_name,
+                          const PropertyGraphTable &edge_table, bool directed,
+                          bool with_reverse = false);
+  //! The property graph and edge table of a key made by CreateKey
+  static void ParseKey(const string &key, string &pg_name,
+                       string &edge_table);
+
+  //! Returns the cached CSR for key, or nullptr if there is none or one of
+  //! its tables has changed since version
+  shared_ptr<CSR> Lookup(const string &key, idx_t version);
+  //! Publishes a CSR built from tables by a transaction that started at
+  //! version, unless it takes more than limit bytes. Evicts the least
+  //! recently used CSRs until the cache takes at most limit bytes.
+  void Insert(const string &key, shared_ptr<CSR> csr,
+              case_insensitive_set_t tables, idx_t version, idx_t limit);
+  //! Drops all cached CSRs
+  void Invalidate();
+  //! Drops the cached CSRs built from one of tables
+  void Invalidate(const case_insensitive_set_t &tables);
+  idx_t GetVersion() const { return version.load(); }
+  //! The number of times a cached CSR was used, see duckpgq_csr_cache()
+  struct CSRCacheHits {
+    string key;
+    idx_t hits;
+    //! Path lengths looked up in the distance index of the CSR
+    idx_t distance_index_hits;
+    //! Bytes the CSR takes, see CSR::MemorySize
+    idx_t memory_usage;
+  };
+  vector<CSRCacheHits> GetHits();
+
+  //! Whether path lengths over edge_table of pg_name are looked up in a
+  //! distance index, see PRAGMA create_distance_index
+  bool HasDistanceIndex(const string &pg_name, const string &edge_table);
+  //! Declares or drops the distance index on edge_table of pg_name, once the
+  //! statement that stores it in __duckpgq_distance_indexes committed
+  void SetDistanceIndex(const string &pg_name, const string &edge_table,
+                        bool exists);
+  //! Drops the distance indexes of a property graph
+  void DropDistanceIndexes(const string &pg_name);
+  bool DistanceIndexesLoaded();
+  //! Sets the distance indexes stored in __duckpgq_distance_indexes, unless
+  //! another connection loaded them first
+  void LoadDistanceIndexes(
+      case_insensitive_map_t<case_insensitive_set_t> indexes);
+
+private:
+  struct CSRCacheEntry {
+    shared_ptr<CSR> csr;
+    //! The edge and vertex tables the CSR was built from
+    case_insensitive_set_t tables;
+    //! Number of lookups that returned the CSR
+    idx_t hits = 0;
+    //! Value of use_clock when the CSR was last inserted or returned
+    idx_t last_use = 0;
+    //! Bytes the CSR took when Evict last ran
+    idx_t memory_usage = 0;
+  };
+
+  //! The version of the last change to one of tables
+  idx_t LastChange(const case_insensitive_set_t &tables) const;
+  //! Drops the least recently used CSRs until the rest take at most limit
+  //! bytes. The distance index of a cached CSR is built after it is
+  //! inserted, so the sizes are taken again every time.
+  void Evict(idx_t limit);
+
+  mutex cache_lock;
+  unordered_map<string, CSRCacheEntry> entries;
+  idx_t use_clock = 0;
+  atomic<idx_t> version{0};
+  //! Version of the last change of every table written to
+  case_insensitive_map_t<idx_t> table_versions;
+  //! Version of the last change to all tables
+  idx_t all_tables_version = 0;
+  //! Edge tables with a distance index, by property graph
+  case_insensitive_map_t<case_insensitive_set_t> distance_indexes;
+  bool distance_indexes_loaded = false;
+};
+
+} // namespace core
+
+} // namespace duckpgq
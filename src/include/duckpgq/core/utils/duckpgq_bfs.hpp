@@ -0,0 +1,404 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_bfs.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_lane_bitset.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+#include "duckpgq/core/utils/duckpgq_scratch.hpp"
+
+#include <algorithm>
+
+namespace duckpgq {
+namespace core {
+
+//! Smallest number of vertices a step of a multi-source BFS is split into
+//! per thread; below it the scheduling overhead outweighs the step itself
+#define BFS_MIN_RANGE_SIZE 4096
+
+//! Frontiers holding fewer than 1/BFS_SPARSE_DIVISOR of the vertices are
+//! listed, and steps from them only touch the listed vertices and their
+//! neighbors instead of scanning all vertices
+#define BFS_SPARSE_DIVISOR 32
+
+//! The lanes of every vertex of a multi-source BFS, in scratch memory
+template <idx_t LANES> using LaneBitsetArray = ScratchArray<LaneBitset<LANES>>;
+
+//! Number of vertex ranges the steps of a multi-source BFS over v_size
+//! vertices are split into. Returns 1 for small graphs or a single thread, in
+//! which case all steps run on the calling thread.
+idx_t BfsRangeCount(ClientContext &context, int64_t v_size);
+
+//! Number of vertices in each of the range_count ranges; the last may be
+//! smaller
+int64_t BfsRangeSize(int64_t v_size, idx_t range_count);
+
+//! Calls range_function(range_idx, begin, end) for the range_count ranges of
+//! [0, v_size) on the worker threads, which steal the next unprocessed range
+void BfsParallelRanges(
+    ClientContext &context, int64_t v_size, idx_t range_count,
+    const std::function<void(idx_t range_idx, int64_t begin, int64_t end)>
+        &range_function);
+
+//! An edge from a frontier vertex found during a parallel top-down step
+struct BfsPushedEdge {
+  int64_t src;
+  int64_t dst;
+  int64_t offset;
+};
+
+//! Top-down step: calls push(src, dst, offset) for every outgoing edge of the
+//! vertices with a lane set in visit. In parallel, the source ranges bucket
+//! their edges by the range of the destination, and every destination range
+//! then applies its buckets on a single thread, so push may update the state
+//! of dst without synchronization. The edges of a destination are pushed in
+//! the same order as by a sequential step.
+template <idx_t LANES, class CSR_VIEW, class PUSH>
+void BfsPushFrontier(ClientContext &context, const CSR_VIEW &csr,
+                     int64_t v_size, idx_t range_count,
+                     const LaneBitsetArray<LANES> &visit, PUSH &&push) {
+  if (range_count <= 1) {
+    for (int64_t v = 0; v < v_size; v++) {
+      if (visit[v].any()) {
+        csr.ForEachNeighbor(
+            v, [&](int64_t n, int64_t offset) { push(v, n, offset); });
+      }
+    }
+    return;
+  }
+  auto range_size = BfsRangeSize(v_size, range_count);
+  // Bucket (i, j) holds the edges from source range i to destination range j
+  vector<vector<BfsPushedEdge>> buckets(range_count * range_count);
+  BfsParallelRanges(
+      context, v_size, range_count,
+      [&](idx_t range_idx, int64_t begin, int64_t end) {
+        auto range_buckets = &buckets[range_idx * range_count];
+        for (int64_t v = begin; v < end; v++) {
+          if (visit[v].any()) {
+            csr.ForEachNeighbor(v, [&](int64_t n, int64_t offset) {
+              range_buckets[n / range_size].push_back({v, n, offset});
+            });
+          }
+        }
+      });
+  BfsParallelRanges(context, v_size, range_count,
+                    [&](idx_t range_idx, int64_t, int64_t) {
+                      for (idx_t src_range = 0; src_range < range_count;
+                           src_range++) {
+                        auto &bucket =
+                            buckets[src_range * range_count + range_idx];
+                        for (auto &edge : bucket) {
+                          push(edge.src, edge.dst, edge.offset);
+                        }
+                        bucket = vector<BfsPushedEdge>();
+                      }
+                    });
+}
+
+//! Tracks the vertices holding lanes in the visit and next arrays of a
+//! multi-source BFS, like the visit list of reachability does. While the
+//! frontier is small, steps are sparse: they expand the listed frontier on the
+//! calling thread, and clear next through the list of what it held before.
+//! Larger frontiers are left to dense steps, which scan all vertices.
+class BfsFrontier {
+public:
+  BfsFrontier(ClientContext &context, int64_t v_size, idx_t range_count);
+
+  //! Starts a search from the sources, the only vertices with lanes in visit
+  void Start(vector<int64_t> sources);
+  //! Whether the next step should be sparse
+  bool IsSparse() const {
+    return current_listed &&
+           static_cast<int64_t>(current.size()) * BFS_SPARSE_DIVISOR < v_size;
+  }
+  //! Whether the frontier is listed, which it always is while IsSparse()
+  bool IsListed() const { return current_listed; }
+  //! The frontier in ascending order, valid while IsListed()
+  const vector<int64_t> &Vertices() const { return current; }
+
+  //! Sparse step: clears next and calls push(src, dst, offset) for the
+  //! outgoing edges of the frontier, in the order a dense step would. Collects
+  //! the vertices that push leaves with lanes in next.
+  template <idx_t LANES, class CSR_VIEW, class PUSH>
+  void Push(const CSR_VIEW &csr, LaneBitsetArray<LANES> &next, PUSH &&push) {
+    ClearNext(next);
+    touched.clear();
+    for (auto v : current) {
+      csr.ForEachNeighbor(v, [&](int64_t n, int64_t offset) {
+        bool was_empty = next[n].none();
+        push(v, n, offset);
+        if (was_empty && next[n].any()) {
+          touched.push_back(n);
+        }
+      });
+    }
+  }
+  //! Ends a sparse step like LaneBitsetMarkSeen, for the vertices collected by
+  //! Push only. Those with lanes left form the next frontier; returns its size.
+  template <idx_t LANES>
+  idx_t MarkSeen(LaneBitsetArray<LANES> &next, LaneBitsetArray<LANES> &seen) {
+    vector<int64_t> reached;
+    for (auto v : touched) {
+      next[v] = next[v] & ~seen[v];
+      seen[v] = seen[v] | next[v];
+      if (next[v].any()) {
+        reached.push_back(v);
+      }
+    }
+    std::sort(reached.begin(), reached.end());
+    auto count = reached.size();
+    SetFrontier(std::move(reached), true);
+    return count;
+  }
+  //! Ends a sparse step with all vertices collected by Push as the next
+  //! frontier. Returns its size.
+  idx_t Advance();
+  //! Ends a dense step that left lanes in reached vertices of next, and lists
+  //! them if the next step can be sparse
+  template <idx_t LANES>
+  void DenseStepDone(const LaneBitsetArray<LANES> &next, idx_t reached) {
+    if (static_cast<int64_t>(reached) * BFS_SPARSE_DIVISOR >= v_size) {
+      SetFrontier(vector<int64_t>(), false);
+      return;
+    }
+    // Every range lists its own vertices, which are concatenated in order
+    vector<vector<int64_t>> range_vertices(range_count);
+    BfsParallelRanges(context, v_size, range_count,
+                      [&](idx_t range_idx, int64_t begin, int64_t end) {
+                        for (auto v = begin; v < end; v++) {
+                          if (next[v].any()) {
+                            range_vertices[range_idx].push_back(v);
+                          }
+                        }
+                      });
+    vector<int64_t> vertices;
+    vertices.reserve(reached);
+    for (auto &range : range_vertices) {
+      vertices.insert(vertices.end(), range.begin(), range.end());
+    }
+    SetFrontier(std::move(vertices), true);
+  }
+
+private:
+  template <idx_t LANES> void ClearNext(LaneBitsetArray<LANES> &next) {
+    if (stale_listed) {
+      for (auto v : stale) {
+        next[v].reset();
+      }
+      return;
+    }
+    BfsParallelRanges(context, v_size, range_count,
+                      [&](idx_t, int64_t begin, int64_t end) {
+                        for (auto v = begin; v < end; v++) {
+                          next[v].reset();
+                        }
+                      });
+  }
+  void SetFrontier(vector<int64_t> vertices, bool listed);
+
+  ClientContext &context;
+  int64_t v_size;
+  idx_t range_count;
+  //! The vertices with lanes in visit, if current_listed
+  vector<int64_t> current;
+  bool current_listed;
+  //! The vertices with lanes in next before the step, if stale_listed
+  vector<int64_t> stale;
+  bool stale_listed;
+  //! The vertices given lanes in next by the last sparse step
+  vector<int64_t> touched;
+};
+
+//! One top-down step of a multi-source BFS: leaves the lanes that reach a
+//! vertex for the first time in next and adds them to seen. The frontier
+//! decides between a sparse and a dense step. Returns whether any lane reached
+//! a new vertex.
+template <idx_t LANES, class CSR_VIEW>
+bool BfsTopDownStep(ClientContext &context, int64_t v_size, idx_t range_count,
+                    const CSR_VIEW &csr, LaneBitsetArray<LANES> &seen,
+                    LaneBitsetArray<LANES> &visit, LaneBitsetArray<LANES> &next,
+                    BfsFrontier &frontier) {
+  auto push = [&](int64_t v, int64_t n, int64_t) { next[n] |= visit[v]; };
+  if (frontier.IsSparse()) {
+    frontier.Push(csr, next, push);
+    return frontier.MarkSeen(next, seen) > 0;
+  }
+
+  BfsParallelRanges(context, v_size, range_count,
+                    [&](idx_t, int64_t begin, int64_t end) {
+                      for (auto v = begin; v < end; v++) {
+                        next[v].reset();
+                      }
+                    });
+  BfsPushFrontier(context, csr, v_size, range_count, visit, push);
+
+  atomic<idx_t> reached{0};
+  BfsParallelRanges(context, v_size, range_count,
+                    [&](idx_t, int64_t begin, int64_t end) {
+                      reached += LaneBitsetMarkSeen(next.data() + begin,
+                                                    seen.data() + begin,
+                                                    end - begin);
+                    });
+  frontier.DenseStepDone(next, reached);
+  return reached > 0;
+}
+
+//! The vertices first reached at one level of the search, in ascending order,
+//! with the lanes that reached them there. Levels where few lanes reach each
+//! vertex, as on graphs with a long diameter, list the lanes instead of
+//! keeping a bitset per vertex.
+template <idx_t LANES> struct BfsLevel {
+  vector<int64_t> vertices;
+  //! The lanes of every vertex, if the level is dense
+  vector<LaneBitset<LANES>> lanes;
+  //! Otherwise, the lanes of vertices[i] are
+  //! lane_ids[lane_offsets[i]..lane_offsets[i + 1])
+  vector<uint16_t> lane_ids;
+  vector<uint32_t> lane_offsets;
+
+  LaneBitset<LANES> GetLanes(idx_t i) const {
+    if (!lanes.empty()) {
+      return lanes[i];
+    }
+    LaneBitset<LANES> result;
+    for (auto k = lane_offsets[i]; k < lane_offsets[i + 1]; k++) {
+      result.set(lane_ids[k]);
+    }
+    return result;
+  }
+};
+
+//! Keeps the vertices that the last step reached, which are the frontier
+template <idx_t LANES>
+void BfsAddLevel(ClientContext &context, int64_t v_size, idx_t range_count,
+                 const BfsFrontier &frontier,
+                 const LaneBitsetArray<LANES> &next,
+                 vector<BfsLevel<LANES>> &levels) {
+  levels.emplace_back();
+  auto &level = levels.back();
+  if (frontier.IsListed()) {
+    level.vertices = frontier.Vertices();
+  } else {
+    // Every range lists its own vertices, which are concatenated in order
+    vector<vector<int64_t>> range_vertices(range_count);
+    BfsParallelRanges(context, v_size, range_count,
+                      [&](idx_t range_idx, int64_t begin, int64_t end) {
+                        for (auto v = begin; v < end; v++) {
+                          if (next[v].any()) {
+                            range_vertices[range_idx].push_back(v);
+                          }
+                        }
+                      });
+    for (auto &range : range_vertices) {
+      level.vertices.insert(level.vertices.end(), range.begin(), range.end());
+    }
+  }
+  // Collect the lane lists, unless they take more space than the bitsets
+  auto dense_size = level.vertices.size() * sizeof(LaneBitset<LANES>);
+  level.lane_offsets.reserve(level.vertices.size() + 1);
+  level.lane_offsets.push_back(0);
+  for (auto v : level.vertices) {
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      if (next[v].test(lane)) {
+        level.lane_ids.push_back(lane);
+      }
+    }
+    level.lane_offsets.push_back(level.lane_ids.size());
+    if (level.lane_ids.size() * sizeof(uint16_t) +
+            level.lane_offsets.size() * sizeof(uint32_t) >
+        dense_size) {
+      level.lane_ids = vector<uint16_t>();
+      level.lane_offsets = vector<uint32_t>();
+      level.lanes.reserve(level.vertices.size());
+      for (auto u : level.vertices) {
+        level.lanes.push_back(next[u]);
+      }
+      return;
+    }
+  }
+}
+
+//! A path to rebuild: the lane that searched it, its last vertex and the
+//! level that vertex was reached at
+struct BfsPathEnd {
+  idx_t lane;
+  int64_t vertex;
+  int64_t level;
+};
+
+//! Rebuilds the paths backwards from their ends, one level at a time. The
+//! predecessor of a vertex on the path of a lane is the first vertex of the
+//! level before that reached it for the lane, in the order a step pushes the
+//! edges in, which is the parent a forward step would have recorded. Ends of
+//! the same lane share that predecessor, so their paths merge once they meet.
+//! Collects the path of ends[i] in paths[i] as the end, edge rowid, vertex,
+//! ..., source. Ends at a level below 1 get no path. wanted must be empty, and
+//! is left empty.
+template <idx_t LANES, class CSR_VIEW>
+void BfsReconstructPaths(const CSR_VIEW &csr,
+                         const vector<BfsLevel<LANES>> &levels,
+                         const vector<BfsPathEnd> &ends,
+                         LaneBitsetArray<LANES> &wanted,
+                         vector<vector<int64_t>> &paths) {
+  // The ends of every lane whose path is being rebuilt, by the vertex their
+  // paths have reached
+  vector<unordered_map<int64_t, vector<idx_t>>> heads(LANES), next_heads(LANES);
+  LaneBitset<LANES> pending;
+  for (auto level = static_cast<int64_t>(levels.size()) - 1; level > 0;
+       level--) {
+    // Ends reached at this level start their path
+    for (idx_t i = 0; i < ends.size(); i++) {
+      if (ends[i].level == level) {
+        paths[i].push_back(ends[i].vertex);
+        heads[ends[i].lane][ends[i].vertex].push_back(i);
+        pending.set(ends[i].lane);
+      }
+    }
+    if (pending.none()) {
+      continue;
+    }
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      for (auto &head : heads[lane]) {
+        wanted[head.first].set(lane);
+      }
+    }
+    auto &prev = levels[level - 1];
+    for (idx_t i = 0; i < prev.vertices.size(); i++) {
+      auto lanes = prev.GetLanes(i) & pending;
+      if (lanes.none()) {
+        continue;
+      }
+      auto v = prev.vertices[i];
+      csr.ForEachNeighbor(v, [&](int64_t n, int64_t offset) {
+        auto found = lanes & wanted[n];
+        if (found.none()) {
+          return;
+        }
+        wanted[n] = wanted[n] & ~found;
+        for (idx_t lane = 0; lane < LANES; lane++) {
+          if (!found.test(lane)) {
+            continue;
+          }
+          auto &moved = next_heads[lane][v];
+          for (auto end : heads[lane][n]) {
+            paths[end].push_back(csr.edge_ids[offset]);
+            paths[end].push_back(v);
+            moved.push_back(end);
+          }
+        }
+      });
+    }
+    for (idx_t lane = 0; lane < LANES; lane++) {
+      heads[lane].clear();
+      std::swap(heads[lane], next_heads[lane]);
+    }
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,67 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_distance_index.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+
+namespace duckpgq {
+namespace core {
+
+class CSR;
+
+//! Exact hop distances between all pairs of vertices of a CSR, stored as a
+//! 2-hop labeling built with pruned landmark labeling (Akiba et al., SIGMOD
+//! 2013). Every vertex keeps the distances to and from a few hubs, such that
+//! every shortest path passes through a hub in both the out-labels of its
+//! source and the in-labels of its destination. A distance is then the
+//! smallest sum over the hubs the two labels share.
+class DistanceIndex {
+public:
+  //! Builds the labels of the vertices of a complete CSR. The hubs are taken
+  //! in the order of descending degree, and the search from every hub stops
+  //! at the vertices the labels of the earlier hubs already cover. The
+  //! adjacency lists are read on the threads, and the build stops when the
+  //! query is interrupted.
+  static unique_ptr<DistanceIndex> Build(ClientContext &context,
+                                         const CSR &csr);
+
+  //! Hops of the shortest path from source to destination, or -1 if there is
+  //! none
+  int64_t Query(int64_t source, int64_t destination) const;
+  idx_t VertexCount() const { return vertex_count; }
+  //! Number of label entries of all vertices
+  idx_t LabelCount() const;
+  //! Bytes the labels take
+  idx_t MemorySize() const;
+
+private:
+  struct LabelEntry {
+    //! Rank of the hub in the order the hubs were processed in
+    uint32_t hub;
+    uint32_t distance;
+  };
+  //! The labels of vertex i are entries[offsets[i]] up to
+  //! entries[offsets[i + 1]], sorted by hub
+  struct Labels {
+    vector<uint64_t> offsets;
+    vector<LabelEntry> entries;
+  };
+
+  static Labels Flatten(vector<vector<LabelEntry>> &labels);
+
+  idx_t vertex_count = 0;
+  //! Distances from every vertex to the hubs
+  Labels out_labels;
+  //! Distances from the hubs to every vertex, unused if symmetric
+  Labels in_labels;
+  //! Whether the CSR equals its reverse, so one label set serves both ways
+  bool symmetric = false;
+};
+
+} // namespace core
+} // namespace duckpgq
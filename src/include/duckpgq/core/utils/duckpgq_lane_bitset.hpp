@@ -0,0 +1,152 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_lane_bitset.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckdb/common/bit_utils.hpp"
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_utils.hpp"
+
+namespace duckpgq {
+namespace core {
+
+//! The word type of a LaneBitset: a single word of exactly LANES bits up to 64
+//! lanes, and 64-bit words beyond
+template <idx_t LANES> struct LaneBitsetWord {
+  typedef uint64_t type;
+};
+template <> struct LaneBitsetWord<8> {
+  typedef uint8_t type;
+};
+template <> struct LaneBitsetWord<16> {
+  typedef uint16_t type;
+};
+template <> struct LaneBitsetWord<32> {
+  typedef uint32_t type;
+};
+
+//! The lanes of a multi-source BFS that reached a vertex, one bit per search.
+//! A batch of searches uses the narrowest width that holds it, see
+//! LaneWidthDispatch. The operators work on whole words in loops of a fixed
+//! length, which the compiler unrolls and vectorizes for the baseline
+//! instruction set; the array-wide steps of a search use the LaneBitset*
+//! kernels below.
+template <idx_t LANES> struct alignas(LANES / 8) LaneBitset {
+  typedef typename LaneBitsetWord<LANES>::type word_t;
+  static constexpr idx_t WORD_BITS = sizeof(word_t) * 8;
+  static constexpr idx_t WORDS = LANES / WORD_BITS;
+
+  word_t words[WORDS];
+
+  LaneBitset() { reset(); }
+
+  void reset() {
+    for (idx_t w = 0; w < WORDS; w++) {
+      words[w] = 0;
+    }
+  }
+  void set(idx_t lane) {
+    words[lane / WORD_BITS] |= static_cast<word_t>(word_t(1)
+                                                   << (lane % WORD_BITS));
+  }
+  bool test(idx_t lane) const {
+    return ((words[lane / WORD_BITS] >> (lane % WORD_BITS)) & 1) != 0;
+  }
+  bool any() const {
+    word_t acc = 0;
+    for (idx_t w = 0; w < WORDS; w++) {
+      acc |= words[w];
+    }
+    return acc != 0;
+  }
+  bool none() const { return !any(); }
+  //! Calls func(lane) for every lane that is set, in ascending order
+  template <class FUNC> void ForEachLane(FUNC &&func) const {
+    for (idx_t w = 0; w < WORDS; w++) {
+      uint64_t word = words[w];
+      while (word) {
+        func(w * WORD_BITS + CountZeros<uint64_t>::Trailing(word));
+        word &= word - 1;
+      }
+    }
+  }
+
+  LaneBitset &operator|=(const LaneBitset &other) {
+    for (idx_t w = 0; w < WORDS; w++) {
+      words[w] |= other.words[w];
+    }
+    return *this;
+  }
+  LaneBitset &operator&=(const LaneBitset &other) {
+    for (idx_t w = 0; w < WORDS; w++) {
+      words[w] &= other.words[w];
+    }
+    return *this;
+  }
+  LaneBitset operator|(const LaneBitset &other) const {
+    LaneBitset result = *this;
+    return result |= other;
+  }
+  LaneBitset operator&(const LaneBitset &other) const {
+    LaneBitset result = *this;
+    return result &= other;
+  }
+  LaneBitset operator~() const {
+    LaneBitset result;
+    for (idx_t w = 0; w < WORDS; w++) {
+      result.words[w] = static_cast<word_t>(~words[w]);
+    }
+    return result;
+  }
+  bool operator==(const LaneBitset &other) const {
+    word_t diff = 0;
+    for (idx_t w = 0; w < WORDS; w++) {
+      diff |= words[w] ^ other.words[w];
+    }
+    return diff == 0;
+  }
+  bool operator!=(const LaneBitset &other) const { return !(*this == other); }
+};
+
+//! Ends a step of a search over count vertices: removes the lanes already
+//! seen from next, and adds the remaining ones to seen. Returns the number of
+//! vertices with a lane left in next.
+template <idx_t LANES>
+idx_t LaneBitsetMarkSeen(LaneBitset<LANES> *next, LaneBitset<LANES> *seen,
+                         idx_t count);
+
+//! The lanes set for the same vertex in both a and b
+template <idx_t LANES>
+LaneBitset<LANES> LaneBitsetIntersect(const LaneBitset<LANES> *a,
+                                      const LaneBitset<LANES> *b, idx_t count);
+
+//! Runs a batch of searches as OP::Operation<LANES>(args...), with the
+//! narrowest lane width of 8 up to LANE_LIMIT lanes that holds the given
+//! number of searches. Small batches then only clear, scan and combine a few
+//! bytes per vertex in every step.
+template <class OP, class... ARGS>
+void LaneWidthDispatch(idx_t searches, ARGS &&...args) {
+  static_assert(LANE_LIMIT == 512, "lane widths must end at LANE_LIMIT");
+  if (searches <= 8) {
+    OP::template Operation<8>(std::forward<ARGS>(args)...);
+  } else if (searches <= 16) {
+    OP::template Operation<16>(std::forward<ARGS>(args)...);
+  } else if (searches <= 32) {
+    OP::template Operation<32>(std::forward<ARGS>(args)...);
+  } else if (searches <= 64) {
+    OP::template Operation<64>(std::forward<ARGS>(args)...);
+  } else if (searches <= 128) {
+    OP::template Operation<128>(std::forward<ARGS>(args)...);
+  } else if (searches <= 256) {
+    OP::template Operation<256>(std::forward<ARGS>(args)...);
+  } else {
+    OP::template Operation<512>(std::forward<ARGS>(args)...);
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_parallel.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+
+namespace duckpgq {
+namespace core {
+
+//! Number of worker threads of the DuckDB task scheduler
+idx_t GetThreadCount(ClientContext &context);
+
+//! Calls morsel_function(morsel_idx) for every morsel_idx in
+//! [0, morsel_count) on the worker threads of the DuckDB task scheduler. The
+//! calling thread participates, and idle threads steal the next unprocessed
+//! morsel, so morsels may be of uneven cost. Returns once all morsels are
+//! processed and rethrows the first error raised by any of them.
+void ParallelFor(ClientContext &context, idx_t morsel_count,
+                 const std::function<void(idx_t morsel_idx)> &morsel_function);
+
+//! A computation over the whole graph whose result every thread evaluating a
+//! scalar function needs, e.g. the ranks of PageRank. Run lets the first
+//! thread compute it. The threads that arrive while it runs do not block
+//! idle, but take morsels of its current ParallelFor, and all of them return
+//! once it is done.
+class SharedComputation {
+public:
+  //! Calls compute on the first thread to arrive and returns once it has
+  //! finished. Rethrows the error of compute on every thread.
+  void Run(const std::function<void()> &compute);
+  //! Like ParallelFor, but the threads waiting in Run take morsels as well.
+  //! Only to be called from within compute.
+  void ParallelFor(
+      ClientContext &context, idx_t morsel_count,
+      const std::function<void(idx_t morsel_idx)> &morsel_function);
+
+private:
+  struct Phase {
+    Phase(idx_t morsel_count,
+          const std::function<void(idx_t)> &morsel_function)
+        : morsel_count(morsel_count), morsel_function(morsel_function) {}
+
+    idx_t morsel_count;
+    const std::function<void(idx_t)> &morsel_function;
+    atomic<idx_t> next_morsel{0};
+    atomic<idx_t> finished_morsels{0};
+    mutex error_lock;
+    std::exception_ptr error;
+  };
+
+  //! Processes unclaimed morsels of phase until none are left
+  void Work(Phase &phase);
+
+  mutex lock;
+  std::condition_variable changed;
+  bool started = false;
+  bool done = false;
+  std::exception_ptr error;
+  //! The ParallelFor compute is in, if any
+  shared_ptr<Phase> phase;
+};
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,67 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_path_searches.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+
+namespace duckpgq {
+namespace core {
+
+//! The rows of a chunk grouped into the searches of a path-finding function.
+//! Rows with the same source share one search, and with by_destination also
+//! the same destination, for searches that start from both ends.
+struct PathSearches {
+  vector<int64_t> sources;
+  //! Destination of every search, if grouped by destination as well
+  vector<int64_t> destinations;
+  //! Rows of every search, in ascending order
+  vector<vector<idx_t>> rows;
+  //! Rows whose source or destination is NULL, which have no result
+  vector<idx_t> null_rows;
+};
+
+PathSearches GroupPathSearches(idx_t count,
+                               const UnifiedVectorFormat &vdata_src,
+                               const int64_t *src_data,
+                               const UnifiedVectorFormat &vdata_dst,
+                               const int64_t *dst_data, bool by_destination);
+
+//! Gives the next searches one lane each, until LANES lanes are filled or no
+//! search is left. lane_search maps the lanes to their search, or -1, and
+//! lane_rows to the rows of the search. Rows whose destination is their
+//! source are passed to at_source(row) first, which returns whether the row
+//! is done without a search; a search left without rows takes no lane.
+template <idx_t LANES, class AT_SOURCE>
+void AssignPathSearchLanes(const PathSearches &searches,
+                           const UnifiedVectorFormat &vdata_dst,
+                           const int64_t *dst_data, idx_t &started_searches,
+                           int64_t *lane_search,
+                           vector<vector<idx_t>> &lane_rows,
+                           AT_SOURCE &&at_source) {
+  for (idx_t lane = 0; lane < LANES; lane++) {
+    lane_search[lane] = -1;
+    lane_rows[lane].clear();
+    while (lane_rows[lane].empty() &&
+           started_searches < searches.sources.size()) {
+      auto search = started_searches++;
+      auto source = searches.sources[search];
+      for (auto row : searches.rows[search]) {
+        if (dst_data[vdata_dst.sel->get_index(row)] != source ||
+            !at_source(row)) {
+          lane_rows[lane].push_back(row);
+        }
+      }
+      if (!lane_rows[lane].empty()) {
+        lane_search[lane] = search;
+      }
+    }
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_scratch.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckdb/storage/buffer/buffer_handle.hpp"
+#include "duckdb/storage/buffer_manager.hpp"
+#include "duckpgq/common.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace duckpgq {
+namespace core {
+
+//! Number of power-of-two size classes of scratch buffers
+#define SCRATCH_SIZE_CLASSES 64
+//! Smallest scratch buffer is 1 << SCRATCH_MIN_SIZE_CLASS bytes
+#define SCRATCH_MIN_SIZE_CLASS 12
+//! Scratch memory is aligned to a cache line
+#define SCRATCH_ALIGNMENT 64
+
+class ScratchPool;
+
+//! A buffer taken from a ScratchPool, which goes back to the pool when
+//! destroyed
+class ScratchBuffer {
+public:
+  ScratchBuffer(ScratchPool &pool, idx_t size_class, bool zeroed,
+                BufferHandle handle);
+  ScratchBuffer(ScratchBuffer &&other) noexcept;
+  ScratchBuffer(const ScratchBuffer &) = delete;
+  ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+  ~ScratchBuffer();
+
+  //! Start of the buffer, aligned to SCRATCH_ALIGNMENT
+  data_ptr_t Ptr() const { return data; }
+
+private:
+  ScratchPool *pool;
+  idx_t size_class;
+  //! Whether the buffer goes back to the zeroed buffers of the pool
+  bool zeroed;
+  BufferHandle handle;
+  data_ptr_t data;
+};
+
+//! Scratch memory for the state of path-finding searches, such as the lanes
+//! of every vertex, reused by the batches and chunks of a query. Buffers are
+//! kept in power-of-two size classes and allocated through the buffer
+//! manager, so they count against the memory limit. A buffer given back goes
+//! on top of the free list of its class, and the next search of the same
+//! size, usually on the same thread, takes it while it is still in the cache.
+//! The free buffers are released at the end of every query.
+class ScratchPool {
+public:
+  explicit ScratchPool(BufferManager &buffer_manager)
+      : buffer_manager(buffer_manager) {}
+
+  //! Takes a free buffer of at least size bytes, or allocates one
+  ScratchBuffer Acquire(idx_t size);
+  //! Like Acquire, but the buffer has all bytes set to zero. Only new buffers
+  //! are zeroed, so the buffer must be all zero again when it is destroyed.
+  ScratchBuffer AcquireZeroed(idx_t size);
+  //! Releases the free buffers
+  void Clear();
+
+private:
+  friend class ScratchBuffer;
+  void Release(idx_t size_class, bool zeroed, BufferHandle handle);
+
+  BufferManager &buffer_manager;
+  mutex pool_lock;
+  vector<BufferHandle> free_buffers[SCRATCH_SIZE_CLASSES];
+  vector<BufferHandle> zeroed_buffers[SCRATCH_SIZE_CLASSES];
+};
+
+//! count values of T in a buffer of a ScratchPool, all bytes set to zero. T
+//! must be trivially copyable, with all bytes zero as its empty value. With
+//! keep_zeroed, the user resets every value it set before the array is
+//! destroyed, and the array is taken from the zeroed buffers of the pool
+//! instead of being zeroed, see ScratchPool::AcquireZeroed.
+template <class T> class ScratchArray {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "scratch arrays hold trivially copyable values");
+
+public:
+  ScratchArray(ScratchPool &pool, idx_t count, bool keep_zeroed = false)
+      : buffer(keep_zeroed ? pool.AcquireZeroed(count * sizeof(T))
+                           : pool.Acquire(count * sizeof(T))),
+        values(reinterpret_cast<T *>(buffer.Ptr())), count(count) {
+    if (!keep_zeroed) {
+      std::memset(static_cast<void *>(values), 0, count * sizeof(T));
+    }
+  }
+
+  T &operator[](idx_t i) { return values[i]; }
+  const T &operator[](idx_t i) const { return values[i]; }
+  T *data() { return values; }
+  const T *data() const { return values; }
+  idx_t size() const { return count; }
+  T *begin() { return values; }
+  T *end() { return values + count; }
+  const T *begin() const { return values; }
+  const T *end() const { return values + count; }
+
+private:
+  ScratchBuffer buffer;
+  T *values;
+  idx_t count;
+};
+
+} // namespace core
+} // namespace duckpgq
@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_sorted_adjacency.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+
+#include <algorithm>
+
+namespace duckpgq {
+namespace core {
+
+class CSR;
+
+//! The neighbor lists of a CSR, each sorted by vertex id, so the common
+//! neighbors of two vertices are found by intersecting their lists instead of
+//! marking the neighbors of one in a bitmap of all vertices
+class SortedAdjacency {
+public:
+  //! Copies and sorts the lists of all vertices of a complete CSR. Only to be
+  //! called from within the compute function of computation, whose threads
+  //! sort the lists of vertex ranges in parallel. With oriented, every edge
+  //! of an undirected CSR is kept once, from the endpoint of lower degree to
+  //! the one of higher degree, without duplicates and self loops, so no list
+  //! is longer than the square root of twice the number of edges.
+  void Build(ClientContext &context, const CSR &csr,
+             SharedComputation &computation, bool oriented = false);
+
+  idx_t VertexCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+  int64_t Degree(int64_t vertex) const {
+    return static_cast<int64_t>(offsets[vertex + 1] - offsets[vertex]);
+  }
+  const int64_t *Begin(int64_t vertex) const {
+    return targets.data() + offsets[vertex];
+  }
+  const int64_t *End(int64_t vertex) const {
+    return targets.data() + offsets[vertex + 1];
+  }
+
+private:
+  vector<uint64_t> offsets;
+  vector<int64_t> targets;
+};
+
+//! Number of entries of the sorted list [a, a_end), counted with their
+//! multiplicity, that also occur in the sorted list [b, b_end). The shorter
+//! list is walked and the longer one searched by galloping, so intersecting
+//! with the list of a hub costs about the length of the other list.
+idx_t CountContained(const int64_t *a, const int64_t *a_end, const int64_t *b,
+                     const int64_t *b_end);
+
+//! First position in the sorted list [begin, end) whose value is not less
+//! than value, found by doubling the step from begin
+inline const int64_t *Gallop(const int64_t *begin, const int64_t *end,
+                             int64_t value) {
+  idx_t step = 1;
+  auto size = static_cast<idx_t>(end - begin);
+  while (step < size && begin[step] < value) {
+    step *= 2;
+  }
+  return std::lower_bound(begin + step / 2, begin + MinValue(step + 1, size),
+                          value);
+}
+
+//! Calls func(value) for every value in both of the sorted lists without
+//! duplicates [a, a_end) and [b, b_end), galloping through the longer one
+template <class FUNC>
+void ForEachCommon(const int64_t *a, const int64_t *a_end, const int64_t *b,
+                   const int64_t *b_end, FUNC &&func) {
+  if (a_end - a > b_end - b) {
+    std::swap(a, b);
+    std::swap(a_end, b_end);
+  }
+  for (; a < a_end && b < b_end; a++) {
+    b = Gallop(b, b_end, *a);
+    if (b != b_end && *b == *a) {
+      func(*a);
+      b++;
+    }
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
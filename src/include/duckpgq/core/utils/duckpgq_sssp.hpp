@@ -0,0 +1,248 @@
+//===----------------------------------------------------------------------===//
+//                         DuckPGQ
+//
+// duckpgq/core/utils/duckpgq_sssp.hpp
+//
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+#include "duckpgq/common.hpp"
+#include "duckpgq/core/utils/duckpgq_parallel.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace duckpgq {
+namespace core {
+
+//! Smallest number of vertices whose relaxations are split over the threads;
+//! below it the scheduling overhead outweighs the relaxations themselves
+#define SSSP_MIN_PARALLEL_VERTICES 4096
+
+//! Width of the buckets of delta-stepping over v_size vertices and
+//! edge_count edges: the heaviest weight divided by the mean degree, which
+//! leaves a vertex about one light edge per bucket
+template <typename T>
+T SsspBucketWidth(T max_weight, int64_t v_size, idx_t edge_count) {
+  if (edge_count == 0) {
+    return 1;
+  }
+  auto delta = static_cast<T>(static_cast<double>(max_weight) *
+                              static_cast<double>(v_size) /
+                              static_cast<double>(edge_count));
+  // All weights may be zero, and integer widths round down
+  return delta > 0 ? delta : 1;
+}
+
+//! Single-source cheapest paths over non-negative weights with delta-stepping.
+//! Vertices are kept in buckets of tentative distances delta wide, and every
+//! phase settles the lowest non-empty bucket: it relaxes the light edges, of
+//! at most delta, of the vertices in the bucket until no vertex is left in
+//! it, and then relaxes the heavy edges of all vertices it held once. The
+//! relaxations of a large phase are computed on the threads, and applied on
+//! the calling thread. Every vertex keeps the edge it was last improved over,
+//! which form a tree of cheapest paths from the source.
+template <typename T> class SsspDeltaStepping {
+public:
+  //! Tentative distance of the vertices not reached
+  static constexpr T INFINITE_DISTANCE = std::numeric_limits<T>::max();
+
+  //! max_weight is the heaviest of the weights. With parallel false, all
+  //! phases run on the calling thread, which lets several searches run at
+  //! once.
+  SsspDeltaStepping(ClientContext &context, int64_t v_size,
+                    const vector<T> &weights, T max_weight, T delta,
+                    bool parallel)
+      : context(context), v_size(v_size), weights(weights), delta(delta),
+        parallel(parallel && GetThreadCount(context) > 1) {
+    // The tentative distances lie within max_weight of the current bucket,
+    // so the buckets are reused cyclically. One more bucket absorbs the
+    // rounding of floating-point distances.
+    bucket_count = static_cast<int64_t>(max_weight / delta) + 3;
+  }
+
+  template <class CSR_VIEW> void Run(const CSR_VIEW &csr, int64_t source) {
+    dist.assign(v_size, INFINITE_DISTANCE);
+    parent.assign(v_size, -1);
+    parent_offset.assign(v_size, -1);
+    relaxed_dist.assign(v_size, INFINITE_DISTANCE);
+    settled_phase.assign(v_size, -1);
+    buckets.assign(bucket_count, vector<int64_t>());
+    queued = 0;
+    current = 0;
+    Improve({source, 0, -1, -1});
+
+    vector<int64_t> frontier, settled;
+    for (; queued > 0; current++) {
+      auto &bucket = buckets[current % bucket_count];
+      settled.clear();
+      while (!bucket.empty()) {
+        frontier.clear();
+        std::swap(frontier, bucket);
+        queued -= frontier.size();
+        // Skip vertices whose distance improved again after they were
+        // queued here, which were relaxed in a lower bucket or are queued
+        // here twice
+        idx_t kept = 0;
+        for (auto v : frontier) {
+          if (relaxed_dist[v] == dist[v]) {
+            continue;
+          }
+          relaxed_dist[v] = dist[v];
+          if (settled_phase[v] != current) {
+            settled_phase[v] = current;
+            settled.push_back(v);
+          }
+          frontier[kept++] = v;
+        }
+        frontier.resize(kept);
+        Relax(csr, frontier, true);
+      }
+      Relax(csr, settled, false);
+    }
+  }
+
+  bool Reached(int64_t v) const { return dist[v] != INFINITE_DISTANCE; }
+  T Distance(int64_t v) const { return dist[v]; }
+
+  //! The cheapest path to a reached target, as the alternating vertices and
+  //! edge row ids from the source to target
+  template <class CSR_VIEW>
+  vector<int64_t> Path(const CSR_VIEW &csr, int64_t target) const {
+    vector<int64_t> path = {target};
+    for (auto v = target; parent[v] >= 0; v = parent[v]) {
+      path.push_back(csr.edge_ids[parent_offset[v]]);
+      path.push_back(parent[v]);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+  }
+
+private:
+  struct Relaxation {
+    int64_t vertex;
+    T dist;
+    int64_t parent;
+    int64_t offset;
+  };
+
+  int64_t BucketOf(T distance) const {
+    return static_cast<int64_t>(distance / delta);
+  }
+
+  void Improve(const Relaxation &relaxation) {
+    auto v = relaxation.vertex;
+    dist[v] = relaxation.dist;
+    parent[v] = relaxation.parent;
+    parent_offset[v] = relaxation.offset;
+    // Rounding may place a floating-point distance below the current bucket
+    auto bucket = MaxValue<int64_t>(BucketOf(relaxation.dist), current);
+    buckets[bucket % bucket_count].push_back(v);
+    queued++;
+  }
+
+  //! Relaxes the light or heavy edges of vertices
+  template <class CSR_VIEW>
+  void Relax(const CSR_VIEW &csr, const vector<int64_t> &vertices,
+             bool light) {
+    auto collect = [&](idx_t begin, idx_t end, vector<Relaxation> &out) {
+      for (idx_t i = begin; i < end; i++) {
+        auto v = vertices[i];
+        csr.ForEachNeighbor(v, [&](int64_t n, int64_t offset) {
+          auto weight = weights[offset];
+          if ((weight <= delta) != light) {
+            return;
+          }
+          auto distance = dist[v] + weight;
+          if (distance < dist[n]) {
+            out.push_back({n, distance, v, offset});
+          }
+        });
+      }
+    };
+    auto count = vertices.size();
+    if (!parallel || count < 2 * SSSP_MIN_PARALLEL_VERTICES) {
+      relaxations.clear();
+      collect(0, count, relaxations);
+      Apply(relaxations);
+      return;
+    }
+    // The morsels only read the distances, which are updated once all of
+    // them are done
+    auto morsel_count =
+        MinValue<idx_t>(4 * GetThreadCount(context),
+                        count / SSSP_MIN_PARALLEL_VERTICES);
+    auto morsel_size = (count + morsel_count - 1) / morsel_count;
+    vector<vector<Relaxation>> morsel_relaxations(morsel_count);
+    ParallelFor(context, morsel_count, [&](idx_t morsel_idx) {
+      auto begin = MinValue<idx_t>(morsel_idx * morsel_size, count);
+      auto end = MinValue<idx_t>(begin + morsel_size, count);
+      collect(begin, end, morsel_relaxations[morsel_idx]);
+    });
+    for (auto &morsel : morsel_relaxations) {
+      Apply(morsel);
+    }
+  }
+
+  void Apply(const vector<Relaxation> &pending) {
+    for (auto &relaxation : pending) {
+      if (relaxation.dist < dist[relaxation.vertex]) {
+        Improve(relaxation);
+      }
+    }
+  }
+
+  ClientContext &context;
+  int64_t v_size;
+  const vector<T> &weights;
+  T delta;
+  bool parallel;
+  int64_t bucket_count;
+  //! Bucket of the current phase
+  int64_t current;
+
+  vector<T> dist;
+  //! Vertex and edge offset every vertex was last improved over, or -1
+  vector<int64_t> parent;
+  vector<int64_t> parent_offset;
+  //! Distance every vertex had when its light edges were last relaxed
+  vector<T> relaxed_dist;
+  //! Last phase every vertex was settled in, whose heavy edges it relaxes
+  vector<int64_t> settled_phase;
+  vector<vector<int64_t>> buckets;
+  //! Number of vertices queued in the buckets, including stale entries
+  idx_t queued;
+  vector<Relaxation> relaxations;
+};
+
+template <typename T> constexpr T SsspDeltaStepping<T>::INFINITE_DISTANCE;
+
+//! Runs delta-stepping from every source, and calls done(idx, sssp) once the
+//! search from sources[idx] finished. Several sources are searched at once on
+//! the threads, so done may run concurrently for different sources. A single
+//! source splits the phases of its search over the threads instead.
+//! max_weight is the heaviest of the weights.
+template <typename T, class CSR_VIEW, class DONE>
+void SsspForEachSource(ClientContext &context, const CSR_VIEW &csr,
+                       int64_t v_size, const vector<T> &weights, T max_weight,
+                       const vector<int64_t> &sources, DONE &&done) {
+  auto delta = SsspBucketWidth(max_weight, v_size, weights.size());
+  auto search = [&](idx_t idx, bool parallel) {
+    SsspDeltaStepping<T> sssp(context, v_size, weights, max_weight, delta,
+                              parallel);
+    sssp.Run(csr, sources[idx]);
+    done(idx, sssp);
+  };
+  if (sources.size() > 1 && GetThreadCount(context) > 1) {
+    ParallelFor(context, sources.size(),
+                [&](idx_t idx) { search(idx, false); });
+    return;
+  }
+  for (idx_t idx = 0; idx < sources.size(); idx++) {
+    search(idx, true);
+  }
+}
+
+} // namespace core
+} // namespace duckpgq
@@ -17,9 +17,11 @@ shared_ptr<PropertyGraphTable>
 ValidateSourceNodeAndEdgeTable(CreatePropertyGraphInfo *pg_info,
                                const std::string &node_table,
                                const std::string &edge_table);
+//! extra_arguments follow the CSR id and the rowid in the function call
 unique_ptr<SelectNode>
 CreateSelectNode(const shared_ptr<PropertyGraphTable> &edge_pg_entry,
-                 const string &function_name, const string &function_alias);
+                 const string &function_name, const string &function_alias,
+                 vector<unique_ptr<ParsedExpression>> extra_arguments = {});
 unique_ptr<BaseTableRef> CreateBaseTableRef(const string &table_name,
                                             const string &alias = "");
 unique_ptr<ColumnRefExpression>
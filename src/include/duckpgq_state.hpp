@@ -4,6 +4,8 @@
 #include "duckdb/common/case_insensitive_map.hpp"
 
 #include <duckpgq/core/utils/compressed_sparse_row.hpp>
+#include <duckpgq/core/utils/csr_cache.hpp>
+#include <duckpgq/core/utils/duckpgq_scratch.hpp>
 
 namespace duckdb {
 
@@ -12,10 +14,29 @@ public:
   explicit DuckPGQState(shared_ptr<ClientContext> context);
 
   void QueryEnd() override;
+  void TransactionBegin(MetaTransaction &transaction,
+                        ClientContext &context) override;
+  void TransactionCommit(MetaTransaction &transaction,
+                         ClientContext &context) override;
+  void TransactionRollback(MetaTransaction &transaction,
+                           ClientContext &context) override;
   CreatePropertyGraphInfo *GetPropertyGraph(const string &pg_name);
   duckpgq::core::CSR *GetCSR(int32_t id);
+  //! Called by CreateCSRCTE when the statement is bound. Returns true if the
+  //! CSR for cache_key is in the cache, in which case it is kept until the
+  //! end of the query and the CTE only installs it.
+  bool BindCachedCSR(ClientContext &context, const string &cache_key);
+  //! Called by create_csr_edge when the query runs. Installs the cached CSR
+  //! for cache_key under csr_id and returns true. Returns false if it has to
+  //! be built, in which case the CSR built under csr_id is published to the
+  //! cache at the end of the query.
+  bool UseCachedCSR(const string &cache_key, int32_t csr_id);
+  //! Whether path lengths over CSR csr_id of the current query are looked up
+  //! in its distance index, which requires the CSR to be in the CSR cache
+  bool UseDistanceIndex(int32_t csr_id);
 
   void RetrievePropertyGraphs(const shared_ptr<ClientContext> &context);
+  void RetrieveDistanceIndexes(const shared_ptr<ClientContext> &context);
   void ProcessPropertyGraphs(unique_ptr<QueryResult> &property_graphs,
                              bool is_vertex);
   void PopulateEdgeSpecificFields(unique_ptr<DataChunk> &chunk, idx_t row_idx,
@@ -25,6 +46,18 @@ public:
   void RegisterPropertyGraph(const shared_ptr<PropertyGraphTable> &table,
                              const string &graph_name, bool is_vertex);
 
+private:
+  //! The tables the CSR with cache_key is built from, empty if its property
+  //! graph no longer exists
+  case_insensitive_set_t GetCSRTables(const string &cache_key);
+  void InvalidateCSRCache();
+  //! Whether the current transaction may take CSRs from the cache, i.e. it
+  //! has no uncommitted changes the cached CSRs would miss
+  bool CanUseCSRCache() const;
+  //! The duckpgq_csr_cache_limit setting in bytes, a quarter of memory_limit
+  //! if it is not set
+  static idx_t GetCSRCacheLimit(ClientContext &context);
+
 public:
   unique_ptr<ParserExtensionParseData> parse_data;
 
@@ -35,9 +68,53 @@ public:
   case_insensitive_map_t<unique_ptr<CreateInfo>> registered_property_graphs;
 
   //! Used to build the CSR data structures required for path-finding queries
-  std::unordered_map<int32_t, unique_ptr<duckpgq::core::CSR>> csr_list;
+  std::unordered_map<int32_t, shared_ptr<duckpgq::core::CSR>> csr_list;
   std::mutex csr_lock;
   std::unordered_set<int32_t> csr_to_delete;
+
+  //! Database-wide cache of CSRs, shared with the other connections
+  shared_ptr<duckpgq::core::CSRCache> csr_cache;
+  //! Keys of the CSRs of the current query that are taken from the cache or
+  //! are to be cached at the end of the query
+  std::unordered_map<int32_t, string> csr_keys;
+  //! Whether the CSRs of the current query come from the cache
+  std::unordered_map<int32_t, bool> csr_from_cache;
+  //! The cached CSRs found when the current query was bound, by key
+  std::unordered_map<string, shared_ptr<duckpgq::core::CSR>> bound_csrs;
+  //! CSR cache version at the start of the current transaction
+  idx_t csr_cache_version = 0;
+  //! Bytes the CSR cache may take, see GetCSRCacheLimit
+  idx_t csr_cache_limit = 0;
+  optional_ptr<MetaTransaction> current_transaction;
+  //! Tables the current transaction writes to, see DuckPGQModifiedTables
+  case_insensitive_set_t modified_tables;
+  //! Set when the current transaction may have written to other tables,
+  //! e.g. by a statement whose plan was not seen by DuckPGQModifiedTables
+  bool modified_unknown_tables = false;
+  //! Whether DuckPGQModifiedTables saw the plan of the current query
+  bool plan_checked = false;
+  //! Number of queries the current transaction has run to completion
+  idx_t transaction_queries = 0;
+  //! Set when the last committed transaction modified the database
+  bool invalidate_csr_cache = false;
+  //! The tables it modified, empty if unknown
+  case_insensitive_set_t invalidated_tables;
+
+  //! A distance index created or dropped by PRAGMA create_distance_index or
+  //! drop_distance_index
+  struct DistanceIndexChange {
+    string pg_name;
+    string edge_table;
+    bool exists;
+  };
+  //! The changes whose statements have not committed yet. They are applied
+  //! to the CSR cache by the commit that writes __duckpgq_distance_indexes,
+  //! and dropped on rollback.
+  vector<DistanceIndexChange> distance_index_changes;
+
+  //! Scratch memory of the path-finding searches, released at the end of
+  //! every query
+  unique_ptr<duckpgq::core::ScratchPool> scratch_pool;
 };
 
 } // namespace duckdb